@@ -62,8 +62,27 @@ namespace gtl
   enum class CgpuImageFormat
   {
     Undefined = 0,
+    R8Unorm = 9,
+    R8G8Unorm = 16,
     R8G8B8A8Unorm = 37,
-    R32Sfloat = 100
+    R16G16B16A16Sfloat = 97,
+    R32Sfloat = 100,
+    R32G32B32A32Sfloat = 109,
+    Bc1RgbaUnormBlock = 133,
+    Bc3UnormBlock = 137,
+    Bc4UnormBlock = 139,
+    Bc5UnormBlock = 141
+  };
+
+  enum class CgpuComponentSwizzle
+  {
+    Identity = 0,
+    Zero = 1,
+    One = 2,
+    R = 3,
+    G = 4,
+    B = 5,
+    A = 6
   };
 
   enum class CgpuMemoryAccess
@@ -122,14 +141,24 @@ namespace gtl
   struct CgpuTlas          { uint64_t handle = 0; };
   struct CgpuBindSet       { uint64_t handle = 0; };
 
+  struct CgpuComponentMapping
+  {
+    CgpuComponentSwizzle r = CgpuComponentSwizzle::Identity;
+    CgpuComponentSwizzle g = CgpuComponentSwizzle::Identity;
+    CgpuComponentSwizzle b = CgpuComponentSwizzle::Identity;
+    CgpuComponentSwizzle a = CgpuComponentSwizzle::Identity;
+  };
+
   struct CgpuImageCreateInfo
   {
     uint32_t width;
     uint32_t height;
     bool is3d = false;
     uint32_t depth = 1;
+    uint32_t mipLevels = 1;
     CgpuImageFormat format = CgpuImageFormat::R8G8B8A8Unorm;
     CgpuImageUsage usage = CgpuImageUsage::TransferDst | CgpuImageUsage::Sampled;
+    CgpuComponentMapping components = {}; // sampled images only
     const char* debugName = nullptr;
   };
 
@@ -157,6 +186,7 @@ namespace gtl
     CgpuSamplerAddressMode addressModeU;
     CgpuSamplerAddressMode addressModeV;
     CgpuSamplerAddressMode addressModeW;
+    float maxAnisotropy = 1.0f; // clamped to device limit; 1 disables
   };
 
   struct CgpuComputePipelineCreateInfo
@@ -171,6 +201,7 @@ namespace gtl
     uint32_t hitGroupIndex;
     uint32_t instanceCustomIndex;
     float transform[3][4];
+    uint8_t mask = 0xFF;
   };
 
   struct CgpuRtHitGroup
@@ -198,6 +229,8 @@ namespace gtl
     uint32_t maxVertex;
     uint32_t triangleCount;
     bool isOpaque;
+    bool allowCompaction = false;
+    bool allowUpdate = false;
     const char* debugName = nullptr;
   };
 
@@ -205,9 +238,24 @@ namespace gtl
   {
     uint32_t instanceCount;
     const CgpuBlasInstance* instances;
+    bool allowUpdate = false;
     const char* debugName = nullptr;
   };
 
+  struct CgpuTlasInstanceUpdate
+  {
+    uint32_t instanceIndex;
+    float transform[3][4];
+    uint8_t mask = 0xFF;
+  };
+
+  struct CgpuTlasUpdateInfo
+  {
+    uint32_t updateCount;
+    const CgpuTlasInstanceUpdate* updates;
+    bool rebuild = false; // refit otherwise
+  };
+
   struct CgpuBufferBinding
   {
     uint32_t binding;
@@ -300,9 +348,12 @@ namespace gtl
   struct CgpuDeviceProperties
   {
     uint32_t maxComputeSharedMemorySize;
+    uint32_t maxImageDimension2D;
+    uint32_t maxImageDimension3D;
     uint32_t maxPushConstantsSize;
     uint32_t maxRayHitAttributeSize;
     uint32_t subgroupSize;
+    float    timestampPeriod; // nanoseconds per tick
   };
 
   struct CgpuWaitSemaphoreInfo
@@ -326,6 +377,13 @@ namespace gtl
     uint32_t texelExtentX;
     uint32_t texelExtentY;
     uint32_t texelExtentZ;
+    uint32_t mipLevel = 0;
+  };
+
+  struct CgpuDeviceCreateInfo
+  {
+    const char* pipelineCacheDir = nullptr; // no persistent cache if null
+    uint64_t maxPipelineCacheSize = 256 * 1024 * 1024;
   };
 
   bool cgpuInitialize(
@@ -338,7 +396,8 @@ namespace gtl
   void cgpuTerminate();
 
   bool cgpuCreateDevice(
-    CgpuDevice* device
+    CgpuDevice* device,
+    CgpuDeviceCreateInfo createInfo = {}
   );
 
   void cgpuDestroyDevice(
@@ -435,12 +494,45 @@ namespace gtl
     CgpuBlas* blas
   );
 
+  bool cgpuCreateBlases(
+    CgpuDevice device,
+    uint32_t blasCount,
+    const CgpuBlasCreateInfo* createInfos,
+    CgpuBlas* blases
+  );
+
+  bool cgpuCompactBlases(
+    CgpuDevice device,
+    uint32_t blasCount,
+    const CgpuBlas* blases,
+    CgpuBlas* compactedBlases
+  );
+
+  bool cgpuUpdateBlases(
+    CgpuDevice device,
+    uint32_t blasCount,
+    const CgpuBlas* blases,
+    const CgpuBlasCreateInfo* createInfos,
+    bool rebuild = false // refit otherwise
+  );
+
+  uint64_t cgpuGetBlasSize(
+    CgpuDevice device,
+    CgpuBlas blas
+  );
+
   bool cgpuCreateTlas(
     CgpuDevice device,
     CgpuTlasCreateInfo createInfo,
     CgpuTlas* tlas
   );
 
+  bool cgpuUpdateTlas(
+    CgpuDevice device,
+    CgpuTlas tlas,
+    CgpuTlasUpdateInfo updateInfo
+  );
+
   void cgpuDestroyBlas(
     CgpuDevice device,
     CgpuBlas blas
@@ -598,6 +690,12 @@ namespace gtl
     uint64_t timeoutNs = UINT64_MAX
   );
 
+  bool cgpuGetSemaphoreValue(
+    CgpuDevice device,
+    CgpuSemaphore semaphore,
+    uint64_t* value
+  );
+
   void cgpuSubmitCommandBuffer(
     CgpuDevice device,
     CgpuCommandBuffer commandBuffer,
@@ -24,12 +24,18 @@
 #include <stdio.h>
 #include <string.h>
 #include <assert.h>
+#include <algorithm>
 #include <array>
 #include <memory>
 #include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
 
 #include <volk.h>
 
+#include <gtl/gb/File.h>
 #include <gtl/gb/Fmt.h>
 #include <gtl/gb/Log.h>
 #include <gtl/gb/LinearDataStore.h>
@@ -72,6 +78,10 @@ namespace gtl
 
   constexpr static const char* CGPU_SHADER_ENTRY_POINT = "main";
 
+  constexpr static const uint64_t CGPU_MAX_BLAS_BATCH_SCRATCH_SIZE = 256 * 1024 * 1024;
+
+  namespace fs = std::filesystem;
+
   static const std::array<const char*, 14> CGPU_REQUIRED_EXTENSIONS = {
     VK_KHR_ACCELERATION_STRUCTURE_EXTENSION_NAME,
     VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME, // required by VK_KHR_acceleration_structure
@@ -93,6 +103,7 @@ namespace gtl
 
   struct CgpuIDeviceProperties
   {
+    float    maxSamplerAnisotropy;
     uint32_t minAccelerationStructureScratchOffsetAlignment;
     size_t   minMemoryMapAlignment;
     uint64_t minStorageBufferOffsetAlignment;
@@ -123,6 +134,8 @@ namespace gtl
     VkDevice                   logicalDevice;
     VkPhysicalDevice           physicalDevice;
     VkPipelineCache            pipelineCache;
+    std::string                pipelineCachePath; // empty if not persistent
+    uint64_t                   maxPipelineCacheSize;
     CgpuDeviceProperties       properties;
     VolkDeviceTable            table;
     VkQueryPool                timestampPool;
@@ -197,7 +210,9 @@ namespace gtl
     VkAccelerationStructureKHR as;
     uint64_t address;
     CgpuIBuffer buffer;
+    VkBuildAccelerationStructureFlagsKHR buildFlags;
     bool isOpaque;
+    std::string debugName; // carried over to the compacted AS
   };
 
   struct CgpuITlas
@@ -205,6 +220,10 @@ namespace gtl
     VkAccelerationStructureKHR as;
     CgpuIBuffer buffer;
     CgpuIBuffer instances;
+    VkAccelerationStructureInstanceKHR* mappedInstances;
+    uint32_t instanceCount;
+    VkBuildAccelerationStructureFlagsKHR buildFlags;
+    bool areAllBlasOpaque;
   };
 
   struct CgpuISampler
@@ -315,9 +334,12 @@ namespace gtl
   {
     return CgpuDeviceProperties {
       .maxComputeSharedMemorySize = vkLimits.maxComputeSharedMemorySize,
+      .maxImageDimension2D = vkLimits.maxImageDimension2D,
+      .maxImageDimension3D = vkLimits.maxImageDimension3D,
       .maxPushConstantsSize = vkLimits.maxPushConstantsSize,
       .maxRayHitAttributeSize = vkRtPipelineProps.maxRayHitAttributeSize,
-      .subgroupSize = vkSubgroupProps.subgroupSize
+      .subgroupSize = vkSubgroupProps.subgroupSize,
+      .timestampPeriod = vkLimits.timestampPeriod
     };
   }
 
@@ -326,6 +348,7 @@ namespace gtl
                                                                      const VkPhysicalDeviceRayTracingPipelinePropertiesKHR& vkRtPipelineProps)
   {
     return CgpuIDeviceProperties {
+      .maxSamplerAnisotropy = vkLimits.maxSamplerAnisotropy,
       .minAccelerationStructureScratchOffsetAlignment = vkAsProps.minAccelerationStructureScratchOffsetAlignment,
       .minMemoryMapAlignment = vkLimits.minMemoryMapAlignment,
       .minStorageBufferOffsetAlignment = vkLimits.minStorageBufferOffsetAlignment,
@@ -678,7 +701,98 @@ namespace gtl
     return vmaCreatePool(allocator, &poolCreateInfo, &pool);
   }
 
-  bool cgpuCreateDevice(CgpuDevice* device)
+  static std::string cgpuGetPipelineCachePath(const char* dir, const VkPhysicalDeviceProperties& properties)
+  {
+    // The cache UUID changes with the driver build, so stale caches are never looked up
+    std::string uuid;
+    for (uint32_t i = 0; i < VK_UUID_SIZE; i++)
+    {
+      uuid += GB_FMT("{:02x}", properties.pipelineCacheUUID[i]);
+    }
+
+    fs::path path = fs::path(dir) / GB_FMT("pipeline_cache_{:04x}_{:04x}_{}.bin", properties.vendorID, properties.deviceID, uuid);
+    return path.string();
+  }
+
+  static std::vector<uint8_t> cgpuReadPipelineCacheFile(const std::string& path,
+                                                        const VkPhysicalDeviceProperties& properties,
+                                                        uint64_t maxSize)
+  {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.is_open())
+    {
+      return {};
+    }
+
+    uint64_t size = uint64_t(file.tellg());
+    if (size < sizeof(VkPipelineCacheHeaderVersionOne) || size > maxSize)
+    {
+      GB_WARN("ignoring pipeline cache {} of invalid size {}", path, size);
+      return {};
+    }
+
+    std::vector<uint8_t> data(size);
+    file.seekg(0);
+    if (!file.read((char*) data.data(), size))
+    {
+      GB_WARN("failed to read pipeline cache {}", path);
+      return {};
+    }
+
+    // Validate the header ourselves since not all drivers handle foreign data gracefully
+    VkPipelineCacheHeaderVersionOne header;
+    memcpy(&header, data.data(), sizeof(header));
+
+    if (header.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE ||
+        header.vendorID != properties.vendorID ||
+        header.deviceID != properties.deviceID ||
+        memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) != 0)
+    {
+      GB_WARN("ignoring incompatible pipeline cache {}", path);
+      return {};
+    }
+
+    return data;
+  }
+
+  static void cgpuWritePipelineCacheFile(CgpuIDevice* idevice)
+  {
+    const std::string& path = idevice->pipelineCachePath;
+
+    size_t size = 0;
+    if (idevice->table.vkGetPipelineCacheData(idevice->logicalDevice, idevice->pipelineCache, &size, nullptr) != VK_SUCCESS)
+    {
+      GB_ERROR("failed to get pipeline cache size");
+      return;
+    }
+
+    if (size > idevice->maxPipelineCacheSize)
+    {
+      GB_WARN("pipeline cache size of {} bytes exceeds limit; not persisting", size);
+      return;
+    }
+
+    std::vector<uint8_t> data(size);
+    if (idevice->table.vkGetPipelineCacheData(idevice->logicalDevice, idevice->pipelineCache, &size, data.data()) != VK_SUCCESS)
+    {
+      GB_ERROR("failed to get pipeline cache data");
+      return;
+    }
+    data.resize(size);
+
+    std::error_code ec;
+    fs::create_directories(fs::path(path).parent_path(), ec);
+
+    if (!gbWriteFileAtomic(path, data.data(), data.size()))
+    {
+      GB_ERROR("failed to write pipeline cache {}", path);
+      return;
+    }
+
+    GB_LOG("wrote {} bytes to pipeline cache {}", size, path);
+  }
+
+  bool cgpuCreateDevice(CgpuDevice* device, CgpuDeviceCreateInfo createInfo)
   {
     uint64_t handle = s_iinstance->ideviceStore.allocate();
 
@@ -1043,7 +1157,7 @@ namespace gtl
         .samplerAnisotropy = VK_TRUE,
         .textureCompressionETC2 = VK_FALSE,
         .textureCompressionASTC_LDR = VK_FALSE,
-        .textureCompressionBC = VK_FALSE,
+        .textureCompressionBC = idevice->features.textureCompressionBC,
         .occlusionQueryPrecise = VK_FALSE,
         .pipelineStatisticsQuery = VK_FALSE,
         .vertexPipelineStoresAndAtomics = VK_FALSE,
@@ -1243,12 +1357,29 @@ namespace gtl
 
     vmaSetPoolName(idevice->allocator, idevice->asScratchMemoryPool, "[AS scratch memory pool]");
 
+    idevice->pipelineCachePath.clear();
+    idevice->maxPipelineCacheSize = createInfo.maxPipelineCacheSize;
+
+    std::vector<uint8_t> pipelineCacheData;
+    if (createInfo.pipelineCacheDir && *createInfo.pipelineCacheDir)
+    {
+      idevice->pipelineCachePath = cgpuGetPipelineCachePath(createInfo.pipelineCacheDir, deviceProperties.properties);
+
+      pipelineCacheData = cgpuReadPipelineCacheFile(idevice->pipelineCachePath, deviceProperties.properties,
+                                                    createInfo.maxPipelineCacheSize);
+
+      if (!pipelineCacheData.empty())
+      {
+        GB_LOG("loaded {} bytes from pipeline cache {}", pipelineCacheData.size(), idevice->pipelineCachePath);
+      }
+    }
+
     VkPipelineCacheCreateInfo cacheCreateInfo = {
       .sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
       .pNext = nullptr,
       .flags = 0,
-      .initialDataSize = 0,
-      .pInitialData = nullptr
+      .initialDataSize = pipelineCacheData.size(),
+      .pInitialData = pipelineCacheData.data()
     };
 
     result = idevice->table.vkCreatePipelineCache(
@@ -1277,6 +1408,11 @@ namespace gtl
 
     if (idevice->pipelineCache != VK_NULL_HANDLE)
     {
+      if (!idevice->pipelineCachePath.empty())
+      {
+        cgpuWritePipelineCacheFile(idevice);
+      }
+
       idevice->table.vkDestroyPipelineCache(idevice->logicalDevice, idevice->pipelineCache, nullptr);
     }
 
@@ -1754,7 +1890,7 @@ namespace gtl
 
     // FIXME: check device support
     VkImageTiling vkImageTiling = VK_IMAGE_TILING_OPTIMAL;
-    if (!createInfo.is3d && bool((createInfo.usage & CgpuImageUsage::TransferSrc) | (createInfo.usage & CgpuImageUsage::TransferDst)))
+    if (!createInfo.is3d && createInfo.mipLevels == 1 && bool((createInfo.usage & CgpuImageUsage::TransferSrc) | (createInfo.usage & CgpuImageUsage::TransferDst)))
     {
       vkImageTiling = VK_IMAGE_TILING_LINEAR;
     }
@@ -1770,7 +1906,7 @@ namespace gtl
         .height = createInfo.height,
         .depth = createInfo.is3d ? createInfo.depth : 1,
       },
-      .mipLevels = 1,
+      .mipLevels = createInfo.mipLevels,
       .arrayLayers = 1,
       .samples = VK_SAMPLE_COUNT_1_BIT,
       .tiling = vkImageTiling,
@@ -1816,15 +1952,15 @@ namespace gtl
       .viewType = createInfo.is3d ? VK_IMAGE_VIEW_TYPE_3D : VK_IMAGE_VIEW_TYPE_2D,
       .format = (VkFormat) createInfo.format,
       .components = {
-        .r = VK_COMPONENT_SWIZZLE_IDENTITY,
-        .g = VK_COMPONENT_SWIZZLE_IDENTITY,
-        .b = VK_COMPONENT_SWIZZLE_IDENTITY,
-        .a = VK_COMPONENT_SWIZZLE_IDENTITY,
+        .r = (VkComponentSwizzle) createInfo.components.r,
+        .g = (VkComponentSwizzle) createInfo.components.g,
+        .b = (VkComponentSwizzle) createInfo.components.b,
+        .a = (VkComponentSwizzle) createInfo.components.a,
       },
       .subresourceRange = {
       .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
         .baseMipLevel = 0,
-        .levelCount = 1,
+        .levelCount = createInfo.mipLevels,
         .baseArrayLayer = 0,
         .layerCount = 1,
       },
@@ -1889,6 +2025,8 @@ namespace gtl
                         (createInfo.addressModeV == CgpuSamplerAddressMode::ClampToBlack) ||
                         (createInfo.addressModeW == CgpuSamplerAddressMode::ClampToBlack);
 
+    float maxAnisotropy = std::clamp(createInfo.maxAnisotropy, 1.0f, idevice->internalProperties.maxSamplerAnisotropy);
+
     VkSamplerCreateInfo samplerCreateInfo = {
       .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
       .pNext = nullptr,
@@ -1900,8 +2038,8 @@ namespace gtl
       .addressModeV = cgpuTranslateAddressMode(createInfo.addressModeV),
       .addressModeW = cgpuTranslateAddressMode(createInfo.addressModeW),
       .mipLodBias = 0.0f,
-      .anisotropyEnable = VK_FALSE,
-      .maxAnisotropy = 1.0f,
+      .anisotropyEnable = (maxAnisotropy > 1.0f) ? VK_TRUE : VK_FALSE,
+      .maxAnisotropy = maxAnisotropy,
       .compareEnable = VK_FALSE,
       .compareOp = VK_COMPARE_OP_NEVER,
       .minLod = 0.0f,
@@ -2410,10 +2548,80 @@ namespace gtl
     s_iinstance->ipipelineStore.free(pipeline.handle);
   }
 
+  static bool cgpuBuildAsAndWait(CgpuDevice device,
+                                 VkAccelerationStructureBuildGeometryInfoKHR* asBuildGeomInfo,
+                                 uint32_t primitiveCount,
+                                 uint64_t scratchSize)
+  {
+    CgpuIDevice* idevice;
+    cgpuResolveDevice(device, &idevice);
+
+    // Set up device-local scratch buffer
+    CgpuIBuffer iscratchBuffer;
+    if (!cgpuCreateIBuffer(idevice,
+                           CgpuBufferUsage::Storage | CgpuBufferUsage::ShaderDeviceAddress,
+                           CgpuMemoryProperties::DeviceLocal,
+                           scratchSize,
+                           idevice->internalProperties.minAccelerationStructureScratchOffsetAlignment,
+                           &iscratchBuffer, "[AS scratch buffer]",
+                           idevice->asScratchMemoryPool))
+    {
+      CGPU_RETURN_ERROR("failed to create AS scratch buffer");
+    }
+
+    asBuildGeomInfo->scratchData.hostAddress = 0;
+    asBuildGeomInfo->scratchData.deviceAddress = cgpuGetBufferDeviceAddress(idevice, &iscratchBuffer);
+
+    VkAccelerationStructureBuildRangeInfoKHR asBuildRangeInfo = {
+      .primitiveCount = primitiveCount,
+      .primitiveOffset = 0,
+      .firstVertex = 0,
+      .transformOffset = 0,
+    };
+
+    const VkAccelerationStructureBuildRangeInfoKHR* asBuildRangeInfoPtr = &asBuildRangeInfo;
+
+    CgpuCommandBuffer commandBuffer;
+    if (!cgpuCreateCommandBuffer(device, &commandBuffer))
+    {
+      cgpuDestroyIBuffer(idevice, &iscratchBuffer);
+      CGPU_RETURN_ERROR("failed to create AS build command buffer");
+    }
+
+    CgpuICommandBuffer* icommandBuffer;
+    cgpuResolveCommandBuffer(commandBuffer, &icommandBuffer);
+
+    // Build AS on device
+    cgpuBeginCommandBuffer(commandBuffer);
+    idevice->table.vkCmdBuildAccelerationStructuresKHR(icommandBuffer->commandBuffer, 1, asBuildGeomInfo, &asBuildRangeInfoPtr);
+    cgpuEndCommandBuffer(commandBuffer);
+
+    CgpuSemaphore semaphore;
+    if (!cgpuCreateSemaphore(device, &semaphore))
+    {
+      cgpuDestroyCommandBuffer(device, commandBuffer);
+      cgpuDestroyIBuffer(idevice, &iscratchBuffer);
+      CGPU_RETURN_ERROR("failed to create AS build semaphore");
+    }
+
+    CgpuSignalSemaphoreInfo signalSemaphoreInfo{ .semaphore = semaphore, .value = 1 };
+    cgpuSubmitCommandBuffer(device, commandBuffer, 1, &signalSemaphoreInfo);
+    CgpuWaitSemaphoreInfo waitSemaphoreInfo{ .semaphore = semaphore, .value = 1 };
+    cgpuWaitSemaphores(device, 1, &waitSemaphoreInfo);
+
+    // Dispose resources
+    cgpuDestroySemaphore(device, semaphore);
+    cgpuDestroyCommandBuffer(device, commandBuffer);
+    cgpuDestroyIBuffer(idevice, &iscratchBuffer);
+
+    return true;
+  }
+
   static bool cgpuCreateTopOrBottomAs(CgpuDevice device,
                                       VkAccelerationStructureTypeKHR asType,
                                       VkAccelerationStructureGeometryKHR* asGeom,
                                       uint32_t primitiveCount,
+                                      VkBuildAccelerationStructureFlagsKHR buildFlags,
                                       CgpuIBuffer* iasBuffer,
                                       VkAccelerationStructureKHR* as)
   {
@@ -2425,7 +2633,7 @@ namespace gtl
       .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR,
       .pNext = nullptr,
       .type = asType,
-      .flags = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR,
+      .flags = buildFlags,
       .mode = VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR,
       .srcAccelerationStructure = VK_NULL_HANDLE,
       .dstAccelerationStructure = VK_NULL_HANDLE, // set in second round
@@ -2478,70 +2686,15 @@ namespace gtl
       CGPU_RETURN_ERROR("failed to create Vulkan AS object");
     }
 
-    // Set up device-local scratch buffer
-    CgpuIBuffer iscratchBuffer;
-    if (!cgpuCreateIBuffer(idevice,
-                           CgpuBufferUsage::Storage | CgpuBufferUsage::ShaderDeviceAddress,
-                           CgpuMemoryProperties::DeviceLocal,
-                           asBuildSizesInfo.buildScratchSize,
-                           idevice->internalProperties.minAccelerationStructureScratchOffsetAlignment,
-                           &iscratchBuffer, "[AS scratch buffer]",
-                           idevice->asScratchMemoryPool))
-    {
-      cgpuDestroyIBuffer(idevice, iasBuffer);
-      idevice->table.vkDestroyAccelerationStructureKHR(idevice->logicalDevice, *as, nullptr);
-      CGPU_RETURN_ERROR("failed to create AS scratch buffer");
-    }
-
     asBuildGeomInfo.dstAccelerationStructure = *as;
-    asBuildGeomInfo.scratchData.hostAddress = 0;
-    asBuildGeomInfo.scratchData.deviceAddress = cgpuGetBufferDeviceAddress(idevice, &iscratchBuffer);
-
-    VkAccelerationStructureBuildRangeInfoKHR asBuildRangeInfo = {
-      .primitiveCount = primitiveCount,
-      .primitiveOffset = 0,
-      .firstVertex = 0,
-      .transformOffset = 0,
-    };
-
-    const VkAccelerationStructureBuildRangeInfoKHR* asBuildRangeInfoPtr = &asBuildRangeInfo;
 
-    CgpuCommandBuffer commandBuffer;
-    if (!cgpuCreateCommandBuffer(device, &commandBuffer))
+    if (!cgpuBuildAsAndWait(device, &asBuildGeomInfo, primitiveCount, asBuildSizesInfo.buildScratchSize))
     {
-      cgpuDestroyIBuffer(idevice, iasBuffer);
-      cgpuDestroyIBuffer(idevice, &iscratchBuffer);
       idevice->table.vkDestroyAccelerationStructureKHR(idevice->logicalDevice, *as, nullptr);
-      CGPU_RETURN_ERROR("failed to create AS build command buffer");
-    }
-
-    CgpuICommandBuffer* icommandBuffer;
-    cgpuResolveCommandBuffer(commandBuffer, &icommandBuffer);
-
-    // Build AS on device
-    cgpuBeginCommandBuffer(commandBuffer);
-    idevice->table.vkCmdBuildAccelerationStructuresKHR(icommandBuffer->commandBuffer, 1, &asBuildGeomInfo, &asBuildRangeInfoPtr);
-    cgpuEndCommandBuffer(commandBuffer);
-
-    CgpuSemaphore semaphore;
-    if (!cgpuCreateSemaphore(device, &semaphore))
-    {
       cgpuDestroyIBuffer(idevice, iasBuffer);
-      cgpuDestroyIBuffer(idevice, &iscratchBuffer);
-      idevice->table.vkDestroyAccelerationStructureKHR(idevice->logicalDevice, *as, nullptr);
-      CGPU_RETURN_ERROR("failed to create AS build semaphore");
+      CGPU_RETURN_ERROR("failed to build AS");
     }
 
-    CgpuSignalSemaphoreInfo signalSemaphoreInfo{ .semaphore = semaphore, .value = 1 };
-    cgpuSubmitCommandBuffer(device, commandBuffer, 1, &signalSemaphoreInfo);
-    CgpuWaitSemaphoreInfo waitSemaphoreInfo{ .semaphore = semaphore, .value = 1 };
-    cgpuWaitSemaphores(device, 1, &waitSemaphoreInfo);
-
-    // Dispose resources
-    cgpuDestroySemaphore(device, semaphore);
-    cgpuDestroyCommandBuffer(device, commandBuffer);
-    cgpuDestroyIBuffer(idevice, &iscratchBuffer);
-
     return true;
   }
 
@@ -2549,14 +2702,14 @@ namespace gtl
                       CgpuBlasCreateInfo createInfo,
                       CgpuBlas* blas)
   {
-    CGPU_RESOLVE_DEVICE(device, idevice);
+    return cgpuCreateBlases(device, 1, &createInfo, blas);
+  }
+
+  static VkAccelerationStructureGeometryKHR cgpuMakeBlasGeometry(CgpuIDevice* idevice, const CgpuBlasCreateInfo& createInfo)
+  {
     CGPU_RESOLVE_BUFFER(createInfo.vertexPosBuffer, ivertexBuffer);
     CGPU_RESOLVE_BUFFER(createInfo.indexBuffer, iindexBuffer);
 
-    uint64_t handle = s_iinstance->iblasStore.allocate();
-
-    CGPU_RESOLVE_BLAS({ handle }, iblas);
-
     VkAccelerationStructureGeometryTrianglesDataKHR asTriangleData = {
       .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_TRIANGLES_DATA_KHR,
       .pNext = nullptr,
@@ -2575,109 +2728,669 @@ namespace gtl
       },
     };
 
-    VkAccelerationStructureGeometryDataKHR asGeomData = {
-      .triangles = asTriangleData,
-    };
-
-    VkAccelerationStructureGeometryKHR asGeom = {
+    return VkAccelerationStructureGeometryKHR {
       .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR,
       .pNext = nullptr,
       .geometryType = VK_GEOMETRY_TYPE_TRIANGLES_KHR,
-      .geometry = asGeomData,
+      .geometry = {
+        .triangles = asTriangleData,
+      },
       .flags = VkGeometryFlagsKHR(createInfo.isOpaque ? VK_GEOMETRY_OPAQUE_BIT_KHR : 0)
     };
+  }
 
-    bool creationSuccessul = cgpuCreateTopOrBottomAs(device, VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR,
-        &asGeom, createInfo.triangleCount, &iblas->buffer, &iblas->as);
+  bool cgpuCreateBlases(CgpuDevice device,
+                        uint32_t blasCount,
+                        const CgpuBlasCreateInfo* createInfos,
+                        CgpuBlas* blases)
+  {
+    CGPU_RESOLVE_DEVICE(device, idevice);
 
-    if (!creationSuccessul)
+    if (blasCount == 0)
     {
-      s_iinstance->iblasStore.free(handle);
-      CGPU_RETURN_ERROR("failed to build BLAS");
+      return true;
     }
 
-    if (s_iinstance->debugUtilsEnabled && createInfo.debugName)
+    // Validate inputs before creating anything, so that no partially created batch has to be
+    // torn down because of an invalid handle
+    for (uint32_t i = 0; i < blasCount; i++)
     {
-      cgpuSetObjectName(idevice->logicalDevice, VK_OBJECT_TYPE_ACCELERATION_STRUCTURE_KHR, (uint64_t) iblas->as, createInfo.debugName);
+      CgpuIBuffer* ibuffer;
+      if (!cgpuResolveBuffer(createInfos[i].vertexPosBuffer, &ibuffer) ||
+          !cgpuResolveBuffer(createInfos[i].indexBuffer, &ibuffer))
+      {
+        CGPU_RETURN_ERROR_INVALID_HANDLE;
+      }
     }
 
-    VkAccelerationStructureDeviceAddressInfoKHR asAddressInfo = {
-      .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_DEVICE_ADDRESS_INFO_KHR,
-      .pNext = nullptr,
-      .accelerationStructure = iblas->as,
-    };
-    iblas->address = idevice->table.vkGetAccelerationStructureDeviceAddressKHR(idevice->logicalDevice, &asAddressInfo);
+    // Allocate handles upfront because store growth invalidates resolved pointers
+    std::vector<uint64_t> handles(blasCount);
+    for (uint32_t i = 0; i < blasCount; i++)
+    {
+      handles[i] = s_iinstance->iblasStore.allocate();
+    }
 
-    iblas->isOpaque = createInfo.isOpaque;
+    uint32_t createdCount = 0;
 
-    blas->handle = handle;
-    return true;
-  }
+    const auto freeBlases = [&]()
+    {
+      for (uint32_t i = 0; i < createdCount; i++)
+      {
+        CGPU_RESOLVE_BLAS({ handles[i] }, iblas);
 
-  bool cgpuCreateTlas(CgpuDevice device,
-                      CgpuTlasCreateInfo createInfo,
-                      CgpuTlas* tlas)
-  {
-    CGPU_RESOLVE_DEVICE(device, idevice);
+        idevice->table.vkDestroyAccelerationStructureKHR(idevice->logicalDevice, iblas->as, nullptr);
+        cgpuDestroyIBuffer(idevice, &iblas->buffer);
+      }
+      for (uint64_t handle : handles)
+      {
+        s_iinstance->iblasStore.free(handle);
+      }
+    };
 
-    uint64_t handle = s_iinstance->itlasStore.allocate();
+    std::vector<VkAccelerationStructureGeometryKHR> asGeoms(blasCount);
+    std::vector<VkAccelerationStructureBuildGeometryInfoKHR> asBuildGeomInfos(blasCount);
+    std::vector<VkAccelerationStructureBuildRangeInfoKHR> asBuildRangeInfos(blasCount);
+    std::vector<const VkAccelerationStructureBuildRangeInfoKHR*> asBuildRangeInfoPtrs(blasCount);
+    std::vector<uint64_t> scratchSizes(blasCount);
 
-    CGPU_RESOLVE_TLAS({ handle }, itlas);
+    uint64_t scratchAlignment = idevice->internalProperties.minAccelerationStructureScratchOffsetAlignment;
 
-    // Create instance buffer & copy into it
-    if (!cgpuCreateIBuffer(idevice,
-                           CgpuBufferUsage::ShaderDeviceAddress | CgpuBufferUsage::AccelerationStructureBuild,
-                           CgpuMemoryProperties::HostVisible | CgpuMemoryProperties::HostCoherent,
-                           (createInfo.instanceCount ? createInfo.instanceCount : 1) * sizeof(VkAccelerationStructureInstanceKHR),
-                           16/*required by spec*/, &itlas->instances, createInfo.debugName))
+    // Get AS sizes and create AS objects
+    for (uint32_t i = 0; i < blasCount; i++)
     {
-      s_iinstance->itlasStore.free(handle);
-      CGPU_RETURN_ERROR("failed to create TLAS instances buffer");
-    }
+      const CgpuBlasCreateInfo& createInfo = createInfos[i];
 
-    bool areAllBlasOpaque = true;
-    {
-      uint8_t* mapped_mem;
-      if (vmaMapMemory(idevice->allocator, itlas->instances.allocation, (void**) &mapped_mem) != VK_SUCCESS)
+      CGPU_RESOLVE_BLAS({ handles[i] }, iblas);
+
+      asGeoms[i] = cgpuMakeBlasGeometry(idevice, createInfo);
+
+      VkBuildAccelerationStructureFlagsKHR buildFlags = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR;
+      if (createInfo.allowCompaction)
       {
-        CGPU_FATAL("failed to map buffer memory");
+        buildFlags |= VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_COMPACTION_BIT_KHR;
       }
-
-      for (uint32_t i = 0; i < createInfo.instanceCount; i++)
+      if (createInfo.allowUpdate)
       {
-        const CgpuBlasInstance& instanceDesc = createInfo.instances[i];
+        buildFlags |= VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_UPDATE_BIT_KHR;
+      }
 
-        CgpuIBlas* iblas;
-        if (!cgpuResolveBlas(instanceDesc.as, &iblas)) {
-          s_iinstance->itlasStore.free(handle);
-          cgpuDestroyIBuffer(idevice, &itlas->instances);
-          CGPU_RETURN_ERROR_INVALID_HANDLE;
+      VkAccelerationStructureBuildGeometryInfoKHR& asBuildGeomInfo = asBuildGeomInfos[i];
+      asBuildGeomInfo = VkAccelerationStructureBuildGeometryInfoKHR {
+        .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR,
+        .pNext = nullptr,
+        .type = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR,
+        .flags = buildFlags,
+        .mode = VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR,
+        .srcAccelerationStructure = VK_NULL_HANDLE,
+        .dstAccelerationStructure = VK_NULL_HANDLE, // set below
+        .geometryCount = 1,
+        .pGeometries = &asGeoms[i],
+        .ppGeometries = nullptr,
+        .scratchData = {
+          .deviceAddress = 0, // set after scratch allocation
         }
+      };
 
-        uint32_t instanceCustomIndex = instanceDesc.instanceCustomIndex;
-        if ((instanceCustomIndex & 0xFF000000u) != 0u)
+      VkAccelerationStructureBuildSizesInfoKHR asBuildSizesInfo = {
+        .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_SIZES_INFO_KHR,
+        .pNext = nullptr,
+        .accelerationStructureSize = 0, // output
+        .updateScratchSize = 0, // output
+        .buildScratchSize = 0, // output
+      };
+
+      idevice->table.vkGetAccelerationStructureBuildSizesKHR(idevice->logicalDevice,
+                                                             VK_ACCELERATION_STRUCTURE_BUILD_TYPE_DEVICE_KHR,
+                                                             &asBuildGeomInfo,
+                                                             &createInfo.triangleCount,
+                                                             &asBuildSizesInfo);
+
+      if (!cgpuCreateIBuffer(idevice,
+                             CgpuBufferUsage::ShaderDeviceAddress | CgpuBufferUsage::AccelerationStructureStorage,
+                             CgpuMemoryProperties::DeviceLocal,
+                             asBuildSizesInfo.accelerationStructureSize, 0,
+                             &iblas->buffer, "[AS buffer]"))
+      {
+        freeBlases();
+        CGPU_RETURN_ERROR("failed to create AS buffer");
+      }
+
+      VkAccelerationStructureCreateInfoKHR asCreateInfo = {
+        .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_CREATE_INFO_KHR,
+        .pNext = nullptr,
+        .createFlags = 0,
+        .buffer = iblas->buffer.buffer,
+        .offset = 0,
+        .size = asBuildSizesInfo.accelerationStructureSize,
+        .type = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR,
+        .deviceAddress = 0, // used for capture-replay feature
+      };
+
+      if (idevice->table.vkCreateAccelerationStructureKHR(idevice->logicalDevice, &asCreateInfo, nullptr, &iblas->as) != VK_SUCCESS)
+      {
+        cgpuDestroyIBuffer(idevice, &iblas->buffer);
+        freeBlases();
+        CGPU_RETURN_ERROR("failed to create Vulkan AS object");
+      }
+      createdCount++;
+
+      if (s_iinstance->debugUtilsEnabled && createInfo.debugName)
+      {
+        cgpuSetObjectName(idevice->logicalDevice, VK_OBJECT_TYPE_ACCELERATION_STRUCTURE_KHR, (uint64_t) iblas->as, createInfo.debugName);
+      }
+
+      VkAccelerationStructureDeviceAddressInfoKHR asAddressInfo = {
+        .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_DEVICE_ADDRESS_INFO_KHR,
+        .pNext = nullptr,
+        .accelerationStructure = iblas->as,
+      };
+      iblas->address = idevice->table.vkGetAccelerationStructureDeviceAddressKHR(idevice->logicalDevice, &asAddressInfo);
+      iblas->buildFlags = buildFlags;
+      iblas->isOpaque = createInfo.isOpaque;
+      iblas->debugName = createInfo.debugName ? createInfo.debugName : "";
+
+      asBuildGeomInfo.dstAccelerationStructure = iblas->as;
+
+      asBuildRangeInfos[i] = VkAccelerationStructureBuildRangeInfoKHR {
+        .primitiveCount = createInfo.triangleCount,
+        .primitiveOffset = 0,
+        .firstVertex = 0,
+        .transformOffset = 0,
+      };
+      asBuildRangeInfoPtrs[i] = &asBuildRangeInfos[i];
+
+      scratchSizes[i] = cgpuPadToAlignment(asBuildSizesInfo.buildScratchSize, scratchAlignment);
+    }
+
+    // Builds within one vkCmdBuildAccelerationStructuresKHR call may execute in parallel and
+    // require disjoint scratch ranges. To bound scratch memory, we split the builds into batches
+    // which alias the same scratch buffer and are separated by barriers.
+    struct BuildBatch
+    {
+      uint32_t firstIndex;
+      uint32_t count;
+    };
+
+    GbSmallVector<BuildBatch, 16> batches;
+    std::vector<uint64_t> scratchOffsets(blasCount);
+    uint64_t scratchBufferSize = 0;
+    {
+      uint64_t batchScratchSize = 0;
+
+      for (uint32_t i = 0; i < blasCount; i++)
+      {
+        bool exceedsBudget = (batchScratchSize + scratchSizes[i]) > CGPU_MAX_BLAS_BATCH_SCRATCH_SIZE;
+
+        if (batches.empty() || (exceedsBudget && batches.back().count > 0))
         {
-          s_iinstance->itlasStore.free(handle);
-          cgpuDestroyIBuffer(idevice, &itlas->instances);
-          CGPU_RETURN_ERROR("instanceCustomIndex must be equal to or smaller than 2^24");
+          batches.push_back(BuildBatch{ .firstIndex = i, .count = 0 });
+          batchScratchSize = 0;
         }
 
-        VkAccelerationStructureInstanceKHR* asInstance = (VkAccelerationStructureInstanceKHR*) &mapped_mem[i * sizeof(VkAccelerationStructureInstanceKHR)];
-        memcpy(&asInstance->transform, &instanceDesc.transform, sizeof(VkTransformMatrixKHR));
-        asInstance->instanceCustomIndex = instanceCustomIndex;
-        asInstance->mask = 0xFF;
-        asInstance->instanceShaderBindingTableRecordOffset = instanceDesc.hitGroupIndex;
-        asInstance->flags = VK_GEOMETRY_INSTANCE_TRIANGLE_FACING_CULL_DISABLE_BIT_KHR;
-        asInstance->accelerationStructureReference = iblas->address;
+        scratchOffsets[i] = batchScratchSize;
+        batchScratchSize += scratchSizes[i];
+        batches.back().count++;
 
-        areAllBlasOpaque &= iblas->isOpaque;
+        scratchBufferSize = std::max(scratchBufferSize, batchScratchSize);
       }
-
-      vmaUnmapMemory(idevice->allocator, itlas->instances.allocation);
     }
 
-    // Create TLAS
-    VkAccelerationStructureGeometryKHR asGeom = {
+    CgpuIBuffer iscratchBuffer;
+    if (!cgpuCreateIBuffer(idevice,
+                           CgpuBufferUsage::Storage | CgpuBufferUsage::ShaderDeviceAddress,
+                           CgpuMemoryProperties::DeviceLocal,
+                           scratchBufferSize,
+                           scratchAlignment,
+                           &iscratchBuffer, "[AS scratch buffer]",
+                           idevice->asScratchMemoryPool))
+    {
+      freeBlases();
+      CGPU_RETURN_ERROR("failed to create AS scratch buffer");
+    }
+
+    uint64_t scratchAddress = cgpuGetBufferDeviceAddress(idevice, &iscratchBuffer);
+    for (uint32_t i = 0; i < blasCount; i++)
+    {
+      asBuildGeomInfos[i].scratchData.deviceAddress = scratchAddress + scratchOffsets[i];
+    }
+
+    CgpuCommandBuffer commandBuffer;
+    if (!cgpuCreateCommandBuffer(device, &commandBuffer))
+    {
+      cgpuDestroyIBuffer(idevice, &iscratchBuffer);
+      freeBlases();
+      CGPU_RETURN_ERROR("failed to create AS build command buffer");
+    }
+
+    CGPU_RESOLVE_COMMAND_BUFFER(commandBuffer, icommandBuffer);
+
+    // Build all ASes on device in a single submission
+    cgpuBeginCommandBuffer(commandBuffer);
+
+    for (uint32_t b = 0; b < batches.size(); b++)
+    {
+      const BuildBatch& batch = batches[b];
+
+      if (b > 0)
+      {
+        VkMemoryBarrier2KHR scratchBarrier = {
+          .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2_KHR,
+          .pNext = nullptr,
+          .srcStageMask = VK_PIPELINE_STAGE_2_ACCELERATION_STRUCTURE_BUILD_BIT_KHR,
+          .srcAccessMask = VK_ACCESS_2_ACCELERATION_STRUCTURE_WRITE_BIT_KHR,
+          .dstStageMask = VK_PIPELINE_STAGE_2_ACCELERATION_STRUCTURE_BUILD_BIT_KHR,
+          .dstAccessMask = VK_ACCESS_2_ACCELERATION_STRUCTURE_READ_BIT_KHR | VK_ACCESS_2_ACCELERATION_STRUCTURE_WRITE_BIT_KHR
+        };
+
+        VkDependencyInfoKHR dependencyInfo = {
+          .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO_KHR,
+          .pNext = nullptr,
+          .dependencyFlags = 0,
+          .memoryBarrierCount = 1,
+          .pMemoryBarriers = &scratchBarrier,
+          .bufferMemoryBarrierCount = 0,
+          .pBufferMemoryBarriers = nullptr,
+          .imageMemoryBarrierCount = 0,
+          .pImageMemoryBarriers = nullptr
+        };
+
+        idevice->table.vkCmdPipelineBarrier2KHR(icommandBuffer->commandBuffer, &dependencyInfo);
+      }
+
+      idevice->table.vkCmdBuildAccelerationStructuresKHR(icommandBuffer->commandBuffer,
+                                                         batch.count,
+                                                         &asBuildGeomInfos[batch.firstIndex],
+                                                         &asBuildRangeInfoPtrs[batch.firstIndex]);
+    }
+
+    cgpuEndCommandBuffer(commandBuffer);
+
+    CgpuSemaphore semaphore;
+    if (!cgpuCreateSemaphore(device, &semaphore))
+    {
+      cgpuDestroyCommandBuffer(device, commandBuffer);
+      cgpuDestroyIBuffer(idevice, &iscratchBuffer);
+      freeBlases();
+      CGPU_RETURN_ERROR("failed to create AS build semaphore");
+    }
+
+    CgpuSignalSemaphoreInfo signalSemaphoreInfo{ .semaphore = semaphore, .value = 1 };
+    cgpuSubmitCommandBuffer(device, commandBuffer, 1, &signalSemaphoreInfo);
+    CgpuWaitSemaphoreInfo waitSemaphoreInfo{ .semaphore = semaphore, .value = 1 };
+    cgpuWaitSemaphores(device, 1, &waitSemaphoreInfo);
+
+    // Dispose resources
+    cgpuDestroySemaphore(device, semaphore);
+    cgpuDestroyCommandBuffer(device, commandBuffer);
+    cgpuDestroyIBuffer(idevice, &iscratchBuffer);
+
+    for (uint32_t i = 0; i < blasCount; i++)
+    {
+      blases[i].handle = handles[i];
+    }
+    return true;
+  }
+
+  bool cgpuCompactBlases(CgpuDevice device,
+                         uint32_t blasCount,
+                         const CgpuBlas* blases,
+                         CgpuBlas* compactedBlases)
+  {
+    CGPU_RESOLVE_DEVICE(device, idevice);
+
+    if (blasCount == 0)
+    {
+      return true;
+    }
+
+    std::vector<VkAccelerationStructureKHR> srcAses(blasCount);
+    for (uint32_t i = 0; i < blasCount; i++)
+    {
+      CGPU_RESOLVE_BLAS(blases[i], iblas);
+      srcAses[i] = iblas->as;
+    }
+
+    VkQueryPoolCreateInfo queryPoolCreateInfo = {
+      .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+      .pNext = nullptr,
+      .flags = 0,
+      .queryType = VK_QUERY_TYPE_ACCELERATION_STRUCTURE_COMPACTED_SIZE_KHR,
+      .queryCount = blasCount,
+      .pipelineStatistics = 0,
+    };
+
+    VkQueryPool queryPool;
+    if (idevice->table.vkCreateQueryPool(idevice->logicalDevice, &queryPoolCreateInfo, nullptr, &queryPool) != VK_SUCCESS)
+    {
+      CGPU_RETURN_ERROR("failed to create AS compaction query pool");
+    }
+
+    CgpuCommandBuffer commandBuffer;
+    if (!cgpuCreateCommandBuffer(device, &commandBuffer))
+    {
+      idevice->table.vkDestroyQueryPool(idevice->logicalDevice, queryPool, nullptr);
+      CGPU_RETURN_ERROR("failed to create AS compaction command buffer");
+    }
+
+    CgpuSemaphore semaphore;
+    if (!cgpuCreateSemaphore(device, &semaphore))
+    {
+      cgpuDestroyCommandBuffer(device, commandBuffer);
+      idevice->table.vkDestroyQueryPool(idevice->logicalDevice, queryPool, nullptr);
+      CGPU_RETURN_ERROR("failed to create AS compaction semaphore");
+    }
+
+    const auto submitAndWait = [&](uint64_t semaphoreValue)
+    {
+      CgpuSignalSemaphoreInfo signalSemaphoreInfo{ .semaphore = semaphore, .value = semaphoreValue };
+      cgpuSubmitCommandBuffer(device, commandBuffer, 1, &signalSemaphoreInfo);
+      CgpuWaitSemaphoreInfo waitSemaphoreInfo{ .semaphore = semaphore, .value = semaphoreValue };
+      return cgpuWaitSemaphores(device, 1, &waitSemaphoreInfo);
+    };
+
+    const auto disposeResources = [&]()
+    {
+      cgpuDestroySemaphore(device, semaphore);
+      cgpuDestroyCommandBuffer(device, commandBuffer);
+      idevice->table.vkDestroyQueryPool(idevice->logicalDevice, queryPool, nullptr);
+    };
+
+    // Query compacted sizes
+    {
+      CGPU_RESOLVE_COMMAND_BUFFER(commandBuffer, icommandBuffer);
+
+      cgpuBeginCommandBuffer(commandBuffer);
+      idevice->table.vkCmdResetQueryPool(icommandBuffer->commandBuffer, queryPool, 0, blasCount);
+      idevice->table.vkCmdWriteAccelerationStructuresPropertiesKHR(icommandBuffer->commandBuffer,
+                                                                   blasCount,
+                                                                   srcAses.data(),
+                                                                   VK_QUERY_TYPE_ACCELERATION_STRUCTURE_COMPACTED_SIZE_KHR,
+                                                                   queryPool,
+                                                                   0);
+      cgpuEndCommandBuffer(commandBuffer);
+    }
+
+    if (!submitAndWait(1))
+    {
+      disposeResources();
+      CGPU_RETURN_ERROR("failed to query compacted AS sizes");
+    }
+
+    std::vector<VkDeviceSize> compactedSizes(blasCount);
+    VkResult result = idevice->table.vkGetQueryPoolResults(idevice->logicalDevice,
+                                                           queryPool,
+                                                           0,
+                                                           blasCount,
+                                                           compactedSizes.size() * sizeof(VkDeviceSize),
+                                                           compactedSizes.data(),
+                                                           sizeof(VkDeviceSize),
+                                                           VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
+
+    if (result != VK_SUCCESS)
+    {
+      disposeResources();
+      CGPU_RETURN_ERROR("failed to get compacted AS sizes");
+    }
+
+    // Allocate handles upfront because store growth invalidates resolved pointers
+    std::vector<uint64_t> handles(blasCount);
+    for (uint32_t i = 0; i < blasCount; i++)
+    {
+      handles[i] = s_iinstance->iblasStore.allocate();
+    }
+
+    uint32_t createdCount = 0;
+
+    const auto freeBlases = [&]()
+    {
+      for (uint32_t i = 0; i < createdCount; i++)
+      {
+        CGPU_RESOLVE_BLAS({ handles[i] }, iblas);
+
+        idevice->table.vkDestroyAccelerationStructureKHR(idevice->logicalDevice, iblas->as, nullptr);
+        cgpuDestroyIBuffer(idevice, &iblas->buffer);
+      }
+      for (uint64_t handle : handles)
+      {
+        s_iinstance->iblasStore.free(handle);
+      }
+    };
+
+    // Create right-sized ASes and record compacting copies
+    CGPU_RESOLVE_COMMAND_BUFFER(commandBuffer, icommandBuffer);
+
+    cgpuBeginCommandBuffer(commandBuffer);
+
+    for (uint32_t i = 0; i < blasCount; i++)
+    {
+      CGPU_RESOLVE_BLAS(blases[i], isrcBlas);
+      CGPU_RESOLVE_BLAS({ handles[i] }, iblas);
+
+      if (!cgpuCreateIBuffer(idevice,
+                             CgpuBufferUsage::ShaderDeviceAddress | CgpuBufferUsage::AccelerationStructureStorage,
+                             CgpuMemoryProperties::DeviceLocal,
+                             compactedSizes[i], 0,
+                             &iblas->buffer, "[AS buffer]"))
+      {
+        cgpuEndCommandBuffer(commandBuffer);
+        freeBlases();
+        disposeResources();
+        CGPU_RETURN_ERROR("failed to create compacted AS buffer");
+      }
+
+      VkAccelerationStructureCreateInfoKHR asCreateInfo = {
+        .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_CREATE_INFO_KHR,
+        .pNext = nullptr,
+        .createFlags = 0,
+        .buffer = iblas->buffer.buffer,
+        .offset = 0,
+        .size = compactedSizes[i],
+        .type = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR,
+        .deviceAddress = 0, // used for capture-replay feature
+      };
+
+      if (idevice->table.vkCreateAccelerationStructureKHR(idevice->logicalDevice, &asCreateInfo, nullptr, &iblas->as) != VK_SUCCESS)
+      {
+        cgpuDestroyIBuffer(idevice, &iblas->buffer);
+        cgpuEndCommandBuffer(commandBuffer);
+        freeBlases();
+        disposeResources();
+        CGPU_RETURN_ERROR("failed to create compacted Vulkan AS object");
+      }
+      createdCount++;
+
+      VkAccelerationStructureDeviceAddressInfoKHR asAddressInfo = {
+        .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_DEVICE_ADDRESS_INFO_KHR,
+        .pNext = nullptr,
+        .accelerationStructure = iblas->as,
+      };
+      iblas->address = idevice->table.vkGetAccelerationStructureDeviceAddressKHR(idevice->logicalDevice, &asAddressInfo);
+      iblas->buildFlags = isrcBlas->buildFlags;
+      iblas->isOpaque = isrcBlas->isOpaque;
+      iblas->debugName = isrcBlas->debugName;
+
+      if (s_iinstance->debugUtilsEnabled && !iblas->debugName.empty())
+      {
+        cgpuSetObjectName(idevice->logicalDevice, VK_OBJECT_TYPE_ACCELERATION_STRUCTURE_KHR, (uint64_t) iblas->as, iblas->debugName.c_str());
+      }
+
+      VkCopyAccelerationStructureInfoKHR copyInfo = {
+        .sType = VK_STRUCTURE_TYPE_COPY_ACCELERATION_STRUCTURE_INFO_KHR,
+        .pNext = nullptr,
+        .src = isrcBlas->as,
+        .dst = iblas->as,
+        .mode = VK_COPY_ACCELERATION_STRUCTURE_MODE_COMPACT_KHR
+      };
+
+      idevice->table.vkCmdCopyAccelerationStructureKHR(icommandBuffer->commandBuffer, &copyInfo);
+    }
+
+    cgpuEndCommandBuffer(commandBuffer);
+
+    if (!submitAndWait(2))
+    {
+      freeBlases();
+      disposeResources();
+      CGPU_RETURN_ERROR("failed to compact ASes");
+    }
+
+    disposeResources();
+
+    for (uint32_t i = 0; i < blasCount; i++)
+    {
+      compactedBlases[i].handle = handles[i];
+    }
+    return true;
+  }
+
+  bool cgpuUpdateBlases(CgpuDevice device,
+                        uint32_t blasCount,
+                        const CgpuBlas* blases,
+                        const CgpuBlasCreateInfo* createInfos,
+                        bool rebuild)
+  {
+    CGPU_RESOLVE_DEVICE(device, idevice);
+
+    if (blasCount == 0)
+    {
+      return true;
+    }
+
+    std::vector<VkAccelerationStructureGeometryKHR> asGeoms(blasCount);
+    std::vector<VkAccelerationStructureBuildGeometryInfoKHR> asBuildGeomInfos(blasCount);
+    std::vector<VkAccelerationStructureBuildRangeInfoKHR> asBuildRangeInfos(blasCount);
+    std::vector<const VkAccelerationStructureBuildRangeInfoKHR*> asBuildRangeInfoPtrs(blasCount);
+    std::vector<uint64_t> scratchOffsets(blasCount);
+    uint64_t scratchBufferSize = 0;
+
+    uint64_t scratchAlignment = idevice->internalProperties.minAccelerationStructureScratchOffsetAlignment;
+
+    // Refits and rebuilds are in-place updates of the vertex positions; the topology must match the
+    // initial build, so that the existing AS storage stays large enough
+    for (uint32_t i = 0; i < blasCount; i++)
+    {
+      const CgpuBlasCreateInfo& createInfo = createInfos[i];
+
+      CGPU_RESOLVE_BLAS(blases[i], iblas);
+
+      if (!(iblas->buildFlags & VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_UPDATE_BIT_KHR))
+      {
+        CGPU_RETURN_ERROR("BLAS was not created with update support");
+      }
+
+      asGeoms[i] = cgpuMakeBlasGeometry(idevice, createInfo);
+
+      VkAccelerationStructureBuildGeometryInfoKHR& asBuildGeomInfo = asBuildGeomInfos[i];
+      asBuildGeomInfo = VkAccelerationStructureBuildGeometryInfoKHR {
+        .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR,
+        .pNext = nullptr,
+        .type = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR,
+        .flags = iblas->buildFlags,
+        .mode = rebuild ? VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR : VK_BUILD_ACCELERATION_STRUCTURE_MODE_UPDATE_KHR,
+        .srcAccelerationStructure = rebuild ? VK_NULL_HANDLE : iblas->as,
+        .dstAccelerationStructure = iblas->as,
+        .geometryCount = 1,
+        .pGeometries = &asGeoms[i],
+        .ppGeometries = nullptr,
+        .scratchData = {
+          .deviceAddress = 0, // set after scratch allocation
+        }
+      };
+
+      VkAccelerationStructureBuildSizesInfoKHR asBuildSizesInfo = {
+        .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_SIZES_INFO_KHR,
+        .pNext = nullptr,
+        .accelerationStructureSize = 0, // output
+        .updateScratchSize = 0, // output
+        .buildScratchSize = 0, // output
+      };
+
+      idevice->table.vkGetAccelerationStructureBuildSizesKHR(idevice->logicalDevice,
+                                                             VK_ACCELERATION_STRUCTURE_BUILD_TYPE_DEVICE_KHR,
+                                                             &asBuildGeomInfo,
+                                                             &createInfo.triangleCount,
+                                                             &asBuildSizesInfo);
+
+      asBuildRangeInfos[i] = VkAccelerationStructureBuildRangeInfoKHR {
+        .primitiveCount = createInfo.triangleCount,
+        .primitiveOffset = 0,
+        .firstVertex = 0,
+        .transformOffset = 0,
+      };
+      asBuildRangeInfoPtrs[i] = &asBuildRangeInfos[i];
+
+      // Only deforming meshes are updated, so all of them share a single build call
+      uint64_t scratchSize = rebuild ? asBuildSizesInfo.buildScratchSize : asBuildSizesInfo.updateScratchSize;
+      scratchOffsets[i] = scratchBufferSize;
+      scratchBufferSize += cgpuPadToAlignment(scratchSize, scratchAlignment);
+    }
+
+    CgpuIBuffer iscratchBuffer;
+    if (!cgpuCreateIBuffer(idevice,
+                           CgpuBufferUsage::Storage | CgpuBufferUsage::ShaderDeviceAddress,
+                           CgpuMemoryProperties::DeviceLocal,
+                           scratchBufferSize,
+                           scratchAlignment,
+                           &iscratchBuffer, "[AS scratch buffer]",
+                           idevice->asScratchMemoryPool))
+    {
+      CGPU_RETURN_ERROR("failed to create AS scratch buffer");
+    }
+
+    uint64_t scratchAddress = cgpuGetBufferDeviceAddress(idevice, &iscratchBuffer);
+    for (uint32_t i = 0; i < blasCount; i++)
+    {
+      asBuildGeomInfos[i].scratchData.deviceAddress = scratchAddress + scratchOffsets[i];
+    }
+
+    CgpuCommandBuffer commandBuffer;
+    if (!cgpuCreateCommandBuffer(device, &commandBuffer))
+    {
+      cgpuDestroyIBuffer(idevice, &iscratchBuffer);
+      CGPU_RETURN_ERROR("failed to create AS update command buffer");
+    }
+
+    CGPU_RESOLVE_COMMAND_BUFFER(commandBuffer, icommandBuffer);
+
+    cgpuBeginCommandBuffer(commandBuffer);
+    idevice->table.vkCmdBuildAccelerationStructuresKHR(icommandBuffer->commandBuffer,
+                                                       blasCount,
+                                                       asBuildGeomInfos.data(),
+                                                       asBuildRangeInfoPtrs.data());
+    cgpuEndCommandBuffer(commandBuffer);
+
+    CgpuSemaphore semaphore;
+    if (!cgpuCreateSemaphore(device, &semaphore))
+    {
+      cgpuDestroyCommandBuffer(device, commandBuffer);
+      cgpuDestroyIBuffer(idevice, &iscratchBuffer);
+      CGPU_RETURN_ERROR("failed to create AS update semaphore");
+    }
+
+    CgpuSignalSemaphoreInfo signalSemaphoreInfo{ .semaphore = semaphore, .value = 1 };
+    cgpuSubmitCommandBuffer(device, commandBuffer, 1, &signalSemaphoreInfo);
+    CgpuWaitSemaphoreInfo waitSemaphoreInfo{ .semaphore = semaphore, .value = 1 };
+    cgpuWaitSemaphores(device, 1, &waitSemaphoreInfo);
+
+    // Dispose resources
+    cgpuDestroySemaphore(device, semaphore);
+    cgpuDestroyCommandBuffer(device, commandBuffer);
+    cgpuDestroyIBuffer(idevice, &iscratchBuffer);
+
+    return true;
+  }
+
+  uint64_t cgpuGetBlasSize(CgpuDevice device, CgpuBlas blas)
+  {
+    CGPU_RESOLVE_DEVICE(device, idevice);
+    CGPU_RESOLVE_BLAS(blas, iblas);
+
+    return iblas->buffer.size;
+  }
+
+  static VkAccelerationStructureGeometryKHR cgpuMakeTlasGeometry(CgpuIDevice* idevice, CgpuITlas* itlas)
+  {
+    return VkAccelerationStructureGeometryKHR {
       .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR,
       .pNext = nullptr,
       .geometryType = VK_GEOMETRY_TYPE_INSTANCES_KHR,
@@ -2691,13 +3404,87 @@ namespace gtl
           }
         },
       },
-      .flags = VkGeometryFlagsKHR(areAllBlasOpaque ? VK_GEOMETRY_OPAQUE_BIT_KHR : 0)
+      .flags = VkGeometryFlagsKHR(itlas->areAllBlasOpaque ? VK_GEOMETRY_OPAQUE_BIT_KHR : 0)
     };
+  }
 
-    if (!cgpuCreateTopOrBottomAs(device, VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR, &asGeom, createInfo.instanceCount, &itlas->buffer, &itlas->as))
+  bool cgpuCreateTlas(CgpuDevice device,
+                      CgpuTlasCreateInfo createInfo,
+                      CgpuTlas* tlas)
+  {
+    CGPU_RESOLVE_DEVICE(device, idevice);
+
+    uint64_t handle = s_iinstance->itlasStore.allocate();
+
+    CGPU_RESOLVE_TLAS({ handle }, itlas);
+
+    // Create instance buffer & copy into it
+    if (!cgpuCreateIBuffer(idevice,
+                           CgpuBufferUsage::ShaderDeviceAddress | CgpuBufferUsage::AccelerationStructureBuild,
+                           CgpuMemoryProperties::HostVisible | CgpuMemoryProperties::HostCoherent,
+                           (createInfo.instanceCount ? createInfo.instanceCount : 1) * sizeof(VkAccelerationStructureInstanceKHR),
+                           16/*required by spec*/, &itlas->instances, createInfo.debugName))
     {
       s_iinstance->itlasStore.free(handle);
+      CGPU_RETURN_ERROR("failed to create TLAS instances buffer");
+    }
+
+    // Instances stay mapped for the lifetime of the TLAS so that updates can patch them in-place
+    if (vmaMapMemory(idevice->allocator, itlas->instances.allocation, (void**) &itlas->mappedInstances) != VK_SUCCESS)
+    {
+      CGPU_FATAL("failed to map buffer memory");
+    }
+
+    auto freeTlas = [&]() {
+      vmaUnmapMemory(idevice->allocator, itlas->instances.allocation);
       cgpuDestroyIBuffer(idevice, &itlas->instances);
+      s_iinstance->itlasStore.free(handle);
+    };
+
+    bool areAllBlasOpaque = true;
+    for (uint32_t i = 0; i < createInfo.instanceCount; i++)
+    {
+      const CgpuBlasInstance& instanceDesc = createInfo.instances[i];
+
+      CgpuIBlas* iblas;
+      if (!cgpuResolveBlas(instanceDesc.as, &iblas)) {
+        freeTlas();
+        CGPU_RETURN_ERROR_INVALID_HANDLE;
+      }
+
+      uint32_t instanceCustomIndex = instanceDesc.instanceCustomIndex;
+      if ((instanceCustomIndex & 0xFF000000u) != 0u)
+      {
+        freeTlas();
+        CGPU_RETURN_ERROR("instanceCustomIndex must be equal to or smaller than 2^24");
+      }
+
+      VkAccelerationStructureInstanceKHR* asInstance = &itlas->mappedInstances[i];
+      memcpy(&asInstance->transform, &instanceDesc.transform, sizeof(VkTransformMatrixKHR));
+      asInstance->instanceCustomIndex = instanceCustomIndex;
+      asInstance->mask = instanceDesc.mask;
+      asInstance->instanceShaderBindingTableRecordOffset = instanceDesc.hitGroupIndex;
+      asInstance->flags = VK_GEOMETRY_INSTANCE_TRIANGLE_FACING_CULL_DISABLE_BIT_KHR;
+      asInstance->accelerationStructureReference = iblas->address;
+
+      areAllBlasOpaque &= iblas->isOpaque;
+    }
+
+    itlas->instanceCount = createInfo.instanceCount;
+    itlas->areAllBlasOpaque = areAllBlasOpaque;
+    itlas->buildFlags = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR;
+    if (createInfo.allowUpdate)
+    {
+      itlas->buildFlags |= VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_UPDATE_BIT_KHR;
+    }
+
+    // Create TLAS
+    VkAccelerationStructureGeometryKHR asGeom = cgpuMakeTlasGeometry(idevice, itlas);
+
+    if (!cgpuCreateTopOrBottomAs(device, VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR, &asGeom, createInfo.instanceCount,
+                                 itlas->buildFlags, &itlas->buffer, &itlas->as))
+    {
+      freeTlas();
       CGPU_RETURN_ERROR("failed to build TLAS");
     }
 
@@ -2710,6 +3497,77 @@ namespace gtl
     return true;
   }
 
+  bool cgpuUpdateTlas(CgpuDevice device,
+                      CgpuTlas tlas,
+                      CgpuTlasUpdateInfo updateInfo)
+  {
+    CGPU_RESOLVE_DEVICE(device, idevice);
+    CGPU_RESOLVE_TLAS(tlas, itlas);
+
+    if (!(itlas->buildFlags & VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_UPDATE_BIT_KHR))
+    {
+      CGPU_RETURN_ERROR("TLAS was not created with update support");
+    }
+
+    // Patch instances in-place; everything but transform and mask stays untouched
+    for (uint32_t i = 0; i < updateInfo.updateCount; i++)
+    {
+      const CgpuTlasInstanceUpdate& update = updateInfo.updates[i];
+
+      if (update.instanceIndex >= itlas->instanceCount)
+      {
+        CGPU_RETURN_ERROR("TLAS instance index out of range");
+      }
+
+      VkAccelerationStructureInstanceKHR* asInstance = &itlas->mappedInstances[update.instanceIndex];
+      memcpy(&asInstance->transform, &update.transform, sizeof(VkTransformMatrixKHR));
+      asInstance->mask = update.mask;
+    }
+
+    VkAccelerationStructureGeometryKHR asGeom = cgpuMakeTlasGeometry(idevice, itlas);
+
+    // A refit keeps the topology of the previous build; a rebuild restores trace performance
+    // after many refits or large transform changes at the cost of a full build.
+    VkAccelerationStructureBuildGeometryInfoKHR asBuildGeomInfo = {
+      .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR,
+      .pNext = nullptr,
+      .type = VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR,
+      .flags = itlas->buildFlags,
+      .mode = updateInfo.rebuild ? VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR : VK_BUILD_ACCELERATION_STRUCTURE_MODE_UPDATE_KHR,
+      .srcAccelerationStructure = updateInfo.rebuild ? VK_NULL_HANDLE : itlas->as,
+      .dstAccelerationStructure = itlas->as,
+      .geometryCount = 1,
+      .pGeometries = &asGeom,
+      .ppGeometries = nullptr,
+      .scratchData = {
+        .deviceAddress = 0, // set by build
+      }
+    };
+
+    VkAccelerationStructureBuildSizesInfoKHR asBuildSizesInfo = {
+      .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_SIZES_INFO_KHR,
+      .pNext = nullptr,
+      .accelerationStructureSize = 0, // output
+      .updateScratchSize = 0, // output
+      .buildScratchSize = 0, // output
+    };
+
+    idevice->table.vkGetAccelerationStructureBuildSizesKHR(idevice->logicalDevice,
+                                                           VK_ACCELERATION_STRUCTURE_BUILD_TYPE_DEVICE_KHR,
+                                                           &asBuildGeomInfo,
+                                                           &itlas->instanceCount,
+                                                           &asBuildSizesInfo);
+
+    uint64_t scratchSize = updateInfo.rebuild ? asBuildSizesInfo.buildScratchSize : asBuildSizesInfo.updateScratchSize;
+
+    if (!cgpuBuildAsAndWait(device, &asBuildGeomInfo, itlas->instanceCount, scratchSize))
+    {
+      CGPU_RETURN_ERROR("failed to update TLAS");
+    }
+
+    return true;
+  }
+
   void cgpuDestroyBlas(CgpuDevice device, CgpuBlas blas)
   {
     CGPU_RESOLVE_DEVICE(device, idevice);
@@ -2727,6 +3585,7 @@ namespace gtl
     CGPU_RESOLVE_TLAS(tlas, itlas);
 
     idevice->table.vkDestroyAccelerationStructureKHR(idevice->logicalDevice, itlas->as, nullptr);
+    vmaUnmapMemory(idevice->allocator, itlas->instances.allocation);
     cgpuDestroyIBuffer(idevice, &itlas->instances);
     cgpuDestroyIBuffer(idevice, &itlas->buffer);
 
@@ -2868,6 +3727,11 @@ namespace gtl
       ipipeline->pipeline
     );
 
+    if (ipipeline->descriptorSetCount == 0)
+    {
+      return;
+    }
+
     std::array<VkDescriptorSet, CGPU_MAX_DESCRIPTOR_SET_COUNT> descriptorSets;
     for (uint32_t i = 0; i < bindSetCount; i++)
     {
@@ -2970,7 +3834,7 @@ namespace gtl
         VkImageSubresourceRange range = {
           .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
           .baseMipLevel = 0,
-          .levelCount = 1,
+          .levelCount = VK_REMAINING_MIP_LEVELS,
           .baseArrayLayer = 0,
           .layerCount = 1
         };
@@ -3254,7 +4118,7 @@ namespace gtl
       VkImageSubresourceRange range = {
         .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
         .baseMipLevel = 0,
-        .levelCount = 1,
+        .levelCount = VK_REMAINING_MIP_LEVELS,
         .baseArrayLayer = 0,
         .layerCount = 1
       };
@@ -3294,7 +4158,7 @@ namespace gtl
 
     VkImageSubresourceLayers layers = {
       .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-      .mipLevel = 0,
+      .mipLevel = desc->mipLevel,
       .baseArrayLayer = 0,
       .layerCount = 1,
     };
@@ -3443,7 +4307,7 @@ namespace gtl
       VkImageSubresourceRange range = {
         .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
         .baseMipLevel = 0,
-        .levelCount = 1,
+        .levelCount = VK_REMAINING_MIP_LEVELS,
         .baseArrayLayer = 0,
         .layerCount = 1
       };
@@ -3502,10 +4366,10 @@ namespace gtl
     CGPU_RESOLVE_COMMAND_BUFFER(commandBuffer, icommandBuffer);
     CGPU_RESOLVE_DEVICE(icommandBuffer->device, idevice);
 
+    // Waits for all previous commands, including ray tracing and transfers.
     idevice->table.vkCmdWriteTimestamp2KHR(
       icommandBuffer->commandBuffer,
-      // FIXME: use correct pipeline flag bits
-      VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT_KHR,
+      VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT_KHR,
       idevice->timestampPool,
       timestampIndex
     );
@@ -3667,6 +4531,26 @@ namespace gtl
     return true;
   }
 
+  bool cgpuGetSemaphoreValue(CgpuDevice device,
+                             CgpuSemaphore semaphore,
+                             uint64_t* value)
+  {
+    CGPU_RESOLVE_DEVICE(device, idevice);
+    CGPU_RESOLVE_SEMAPHORE(semaphore, isemaphore);
+
+    VkResult result = idevice->table.vkGetSemaphoreCounterValueKHR(
+      idevice->logicalDevice,
+      isemaphore->semaphore,
+      value
+    );
+
+    if (result != VK_SUCCESS)
+    {
+      CGPU_RETURN_ERROR("failed to get semaphore value");
+    }
+    return true;
+  }
+
   void cgpuSubmitCommandBuffer(CgpuDevice device,
                                CgpuCommandBuffer commandBuffer,
                                uint32_t signalSemaphoreInfoCount,
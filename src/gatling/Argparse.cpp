@@ -26,6 +26,7 @@ constexpr static int DEFAULT_IMAGE_WIDTH = 800;
 constexpr static int DEFAULT_IMAGE_HEIGHT = 800;
 constexpr static const char* DEFAULT_CAMERA_PATH = "";
 constexpr static bool DEFAULT_GAMMA_CORRECTION = true;
+constexpr static float DEFAULT_TIME_LIMIT = 0.0f;
 
 TF_DEFINE_PRIVATE_TOKENS(
   _AppSettingsTokens,
@@ -34,6 +35,7 @@ TF_DEFINE_PRIVATE_TOKENS(
   ((image_height, "image-height"))         \
   ((camera_path, "camera-path"))           \
   ((gamma_correction, "gamma-correction")) \
+  ((time_limit, "time-limit"))             \
   ((help, "help"))
 );
 
@@ -156,6 +158,7 @@ bool ParseArgs(int argc, const char* argv[], HdRenderDelegate& renderDelegate, A
   renderSettingDescs.push_back(HdRenderSettingDescriptor{"Output image height", _AppSettingsTokens->image_height, VtValue(DEFAULT_IMAGE_HEIGHT)});
   renderSettingDescs.push_back(HdRenderSettingDescriptor{"Camera path", _AppSettingsTokens->camera_path, VtValue(DEFAULT_CAMERA_PATH)});
   renderSettingDescs.push_back(HdRenderSettingDescriptor{"Gamma correction", _AppSettingsTokens->gamma_correction, VtValue(DEFAULT_GAMMA_CORRECTION)});
+  renderSettingDescs.push_back(HdRenderSettingDescriptor{"Time limit in seconds (unlimited if 0)", _AppSettingsTokens->time_limit, VtValue(DEFAULT_TIME_LIMIT)});
   renderSettingDescs.push_back(HdRenderSettingDescriptor{"Display usage", _AppSettingsTokens->help, VtValue()});
 
   // We always want to display the options in the same (sorted) order.
@@ -180,6 +183,7 @@ bool ParseArgs(int argc, const char* argv[], HdRenderDelegate& renderDelegate, A
   settings.imageHeight = DEFAULT_IMAGE_HEIGHT;
   settings.cameraPath = DEFAULT_CAMERA_PATH;
   settings.gammaCorrection = DEFAULT_GAMMA_CORRECTION;
+  settings.timeLimit = DEFAULT_TIME_LIMIT;
   settings.help = false;
 
   for (int i = 3; i < argc; i++)
@@ -245,6 +249,14 @@ bool ParseArgs(int argc, const char* argv[], HdRenderDelegate& renderDelegate, A
         return false;
       }
     }
+    else if (arg == _AppSettingsTokens->time_limit)
+    {
+      if (i + 1 >= argc || !_ParseFloat(&settings.timeLimit, argv[++i]))
+      {
+        _PrintValueParseFailed(arg, renderSettingDescs);
+        return false;
+      }
+    }
     // Handle delegate settings.
     else
     {
@@ -302,6 +314,11 @@ bool ParseArgs(int argc, const char* argv[], HdRenderDelegate& renderDelegate, A
         renderDelegate.SetRenderSetting(settingKey, VtValue{std::string(cStr)});
         continue;
       }
+      if (settingValue.IsHolding<TfToken>())
+      {
+        renderDelegate.SetRenderSetting(settingKey, VtValue{TfToken(cStr)});
+        continue;
+      }
       if (settingValue.IsHolding<SdfPath>())
       {
         renderDelegate.SetRenderSetting(settingKey, VtValue{SdfPath(cStr)});
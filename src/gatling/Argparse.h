@@ -34,6 +34,7 @@ struct AppSettings
   int imageHeight;
   std::string cameraPath;
   bool gammaCorrection;
+  float timeLimit;
   bool help;
 };
 
@@ -16,8 +16,8 @@
 //
 
 #include <pxr/pxr.h>
-#include <pxr/base/gf/gamma.h>
 #include <pxr/base/tf/stopwatch.h>
+#include <pxr/base/vt/dictionary.h>
 #include <pxr/imaging/hd/camera.h>
 #include <pxr/imaging/hd/engine.h>
 #include <pxr/imaging/hd/rendererPluginRegistry.h>
@@ -41,6 +41,8 @@
 #include <pxr/usdImaging/usdImaging/delegate.h>
 
 #include <algorithm>
+#include <chrono>
+#include <csignal>
 
 #include "Argparse.h"
 #include "SimpleRenderTask.h"
@@ -50,10 +52,24 @@ PXR_NAMESPACE_USING_DIRECTIVE
 TF_DEFINE_PRIVATE_TOKENS(
   _AppTokens,
   (HdGatlingRendererPlugin)
+  ((displayTransform, "display-transform"))
+  (srgb)
+  (percentDone)
+  (sampleCount)
 );
 
 namespace
 {
+  volatile sig_atomic_t _interrupted = 0;
+
+  void _HandleInterrupt(int signal)
+  {
+    _interrupted = 1;
+
+    // A second interrupt terminates the process immediately.
+    std::signal(signal, SIG_DFL);
+  }
+
   HdCamera* _FindCamera(UsdStageRefPtr& stage, HdRenderIndex* renderIndex, std::string& settingsCameraPath)
   {
     SdfPath cameraPath;
@@ -81,14 +97,6 @@ namespace
     return camera;
   }
 
-  float _AccurateLinearToSrgb(float linearValue)
-  {
-    // Moving Frostbite to Physically Based Rendering 3.0, Section 5.1.5:
-    // https://seblagarde.files.wordpress.com/2015/07/course_notes_moving_frostbite_to_pbr_v32.pdf
-    float sRgbLo = linearValue * 12.92f;
-    float sRgbHi = (std::pow(std::abs(linearValue), 1.0f / 2.4f) * 1.055f) - 0.055f;
-    return (linearValue <= 0.0031308f) ? sRgbLo : sRgbHi;
-  }
 }
 
 int main(int argc, const char* argv[])
@@ -125,6 +133,12 @@ int main(int argc, const char* argv[])
     return EXIT_SUCCESS;
   }
 
+  // Gamma correction is applied on the GPU, before readback.
+  if (settings.gammaCorrection)
+  {
+    renderDelegate->SetRenderSetting(_AppTokens->displayTransform, VtValue(_AppTokens->srgb));
+  }
+
   // Load scene.
   TfStopwatch loadTimer;
   loadTimer.Start();
@@ -197,30 +211,77 @@ int main(int argc, const char* argv[])
   TfStopwatch renderTimer;
   renderTimer.Start();
 
+  // Samples are traced in chunks that fit the frame time budget, so that
+  // rendering can be stopped early and still produce an image.
+  std::signal(SIGINT, _HandleInterrupt);
+
+  using Clock = std::chrono::steady_clock;
+  Clock::time_point startTime = Clock::now();
+  Clock::time_point lastProgressTime = startTime;
+  bool stoppedEarly = false;
+
+  int sampleCount = 0;
+
   HdEngine engine;
-  engine.Execute(renderIndex, &tasks);
+  while (true)
+  {
+    engine.Execute(renderIndex, &tasks);
+
+    if (renderBuffer->IsConverged())
+    {
+      break;
+    }
+
+    // A pass that adds no samples has failed; repeating it would not make progress either.
+    VtDictionary stats = renderDelegate->GetRenderStats();
+    int prevSampleCount = sampleCount;
+    sampleCount = VtDictionaryGet<int>(stats, _AppTokens->sampleCount.GetString(), VtDefault = 0);
+
+    if (sampleCount == prevSampleCount)
+    {
+      std::signal(SIGINT, SIG_DFL);
+      fprintf(stderr, "Rendering failed\n");
+      return EXIT_FAILURE;
+    }
+
+    Clock::time_point now = Clock::now();
+    float elapsedSeconds = std::chrono::duration<float>(now - startTime).count();
+
+    if (_interrupted || (settings.timeLimit > 0.0f && elapsedSeconds >= settings.timeLimit))
+    {
+      stoppedEarly = true;
+      break;
+    }
+
+    if (now - lastProgressTime >= std::chrono::seconds(1))
+    {
+      double percentDone = VtDictionaryGet<double>(stats, _AppTokens->percentDone.GetString(), VtDefault = 0.0);
+
+      printf("Rendering... %.1f%% (%.0fs)\n", percentDone, elapsedSeconds);
+      fflush(stdout);
+
+      lastProgressTime = now;
+    }
+  }
   renderBuffer->Resolve();
 
+  std::signal(SIGINT, SIG_DFL);
+
   renderTimer.Stop();
 
-  printf("Rendering finished (%.3fs)\n", renderTimer.GetSeconds());
+  if (stoppedEarly)
+  {
+    printf("Rendering stopped early, writing partially converged image (%.3fs)\n", renderTimer.GetSeconds());
+  }
+  else
+  {
+    printf("Rendering finished (%.3fs)\n", renderTimer.GetSeconds());
+  }
   fflush(stdout);
 
-  // Gamma correction.
   float* mappedMem = (float*) renderBuffer->Map();
   TF_AXIOM(mappedMem);
 
-  if (settings.gammaCorrection)
-  {
-    int pixelCount = renderBuffer->GetWidth() * renderBuffer->GetHeight();
-    for (int i = 0; i < pixelCount; i++)
-    {
-      mappedMem[i * 4 + 0] = _AccurateLinearToSrgb(mappedMem[i * 4 + 0]);
-      mappedMem[i * 4 + 1] = _AccurateLinearToSrgb(mappedMem[i * 4 + 1]);
-      mappedMem[i * 4 + 2] = _AccurateLinearToSrgb(mappedMem[i * 4 + 2]);
-    }
-  }
-
   // Write image to file.
   TfStopwatch writeTimer;
   writeTimer.Start();
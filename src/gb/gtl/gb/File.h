@@ -0,0 +1,39 @@
+//
+// Copyright (C) 2025 Pablo Delgado Krämer
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <span>
+#include <string>
+#include <string_view>
+
+namespace gtl
+{
+  // Writes the concatenated chunks to a unique temporary file and renames it to the
+  // target path, so that concurrent readers and writers never observe partial data.
+  bool gbWriteFileAtomic(const std::string& path, std::span<const std::span<const uint8_t>> chunks);
+
+  bool gbWriteFileAtomic(const std::string& path, const void* data, size_t size);
+
+  // Deletes the least recently modified files with the given extension until their total size
+  // fits into maxSize. Caches mark entries as used by updating their modification time.
+  void gbTrimDirectory(const std::string& dirPath, std::string_view extension, uint64_t maxSize);
+
+  void gbTouchFile(const std::string& path);
+}
@@ -0,0 +1,129 @@
+//
+// Copyright (C) 2025 Pablo Delgado Krämer
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "File.h"
+#include "Fmt.h"
+#include "Log.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace gtl
+{
+  bool gbWriteFileAtomic(const std::string& path, std::span<const std::span<const uint8_t>> chunks)
+  {
+    std::string tmpPath = GB_FMT("{}.{:08x}.tmp", path, std::random_device{}());
+    std::error_code ec;
+
+    {
+      std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+
+      bool writeSuccessful = file.is_open();
+      for (size_t i = 0; i < chunks.size() && writeSuccessful; i++)
+      {
+        writeSuccessful = bool(file.write((const char*) chunks[i].data(), chunks[i].size()));
+      }
+
+      if (!writeSuccessful)
+      {
+        GB_ERROR("failed to write file {}", tmpPath);
+        file.close();
+        fs::remove(tmpPath, ec);
+        return false;
+      }
+    }
+
+    fs::rename(tmpPath, path, ec);
+    if (ec)
+    {
+      GB_ERROR("failed to move file to {}: {}", path, ec.message());
+      fs::remove(tmpPath, ec);
+      return false;
+    }
+
+    return true;
+  }
+
+  bool gbWriteFileAtomic(const std::string& path, const void* data, size_t size)
+  {
+    std::span<const uint8_t> chunk((const uint8_t*) data, size);
+
+    return gbWriteFileAtomic(path, std::span(&chunk, 1));
+  }
+
+  void gbTrimDirectory(const std::string& dirPath, std::string_view extension, uint64_t maxSize)
+  {
+    struct FileInfo
+    {
+      fs::path path;
+      fs::file_time_type lastWriteTime;
+      uint64_t size;
+    };
+
+    std::vector<FileInfo> files;
+    uint64_t totalSize = 0;
+
+    std::error_code ec;
+    for (auto it = fs::directory_iterator(dirPath, ec); !ec && it != fs::directory_iterator(); it.increment(ec))
+    {
+      if (!it->is_regular_file(ec) || it->path().extension() != extension)
+      {
+        continue;
+      }
+
+      FileInfo info{ .path = it->path(), .lastWriteTime = it->last_write_time(ec), .size = it->file_size(ec) };
+      if (ec)
+      {
+        continue; // removed concurrently
+      }
+
+      totalSize += info.size;
+      files.push_back(std::move(info));
+    }
+
+    if (totalSize <= maxSize)
+    {
+      return;
+    }
+
+    std::sort(files.begin(), files.end(), [](const FileInfo& a, const FileInfo& b) {
+      return a.lastWriteTime < b.lastWriteTime;
+    });
+
+    uint32_t removedCount = 0;
+    for (size_t i = 0; i < files.size() && totalSize > maxSize; i++)
+    {
+      // Other processes may have removed the file already; its size is freed either way
+      fs::remove(files[i].path, ec);
+      totalSize -= files[i].size;
+      removedCount++;
+    }
+
+    GB_DEBUG("removed {} files from {}", removedCount, dirPath);
+  }
+
+  void gbTouchFile(const std::string& path)
+  {
+    std::error_code ec;
+    fs::last_write_time(path, fs::file_time_type::clock::now(), ec);
+  }
+}
@@ -19,25 +19,24 @@
 
 #include <gtl/cgpu/Cgpu.h>
 
+#include <deque>
 #include <functional>
-#include <vector>
-#include <list>
 
 namespace gtl
 {
+  // Resources are destroyed once the GPU timeline has reached the value
+  // that was current at the time of their enqueueing.
   class GgpuDelayedResourceDestroyer
   {
-  private:
-    constexpr static uint32_t FrameCount = 4;
-
   public:
     GgpuDelayedResourceDestroyer(CgpuDevice device);
 
     ~GgpuDelayedResourceDestroyer();
 
   public:
-    void nextFrame();
-    void housekeep();
+    // Resources enqueued from now on are destroyed after this value has been reached.
+    void nextFrame(uint64_t timelineValue);
+    void housekeep(uint64_t completedTimelineValue);
 
     void destroyAll();
 
@@ -59,11 +58,17 @@ namespace gtl
   private:
     using DestroyFunc = std::function<void()>;
 
+    struct PendingDestruction
+    {
+      uint64_t timelineValue;
+      DestroyFunc fun;
+    };
+
     void enqueueDestroyFunc(DestroyFunc fun);
 
   private:
     CgpuDevice m_device;
-    uint32_t m_frameIndex = 0;
-    std::vector<DestroyFunc> m_pendingDestructions[FrameCount];
+    uint64_t m_timelineValue = 0;
+    std::deque<PendingDestruction> m_pendingDestructions;
   };
 }
@@ -24,6 +24,9 @@
 
 namespace gtl
 {
+  // Staging memory is a ring of segments. Each segment records its copies into its own command
+  // buffer and is submitted when full; it is reused once its timeline semaphore value has been
+  // signaled, so the CPU only blocks if the GPU falls behind by a whole ring.
   class GgpuStager
   {
   public:
@@ -34,28 +37,75 @@ namespace gtl
     void free();
 
   public:
+    // Submits all staged copies without waiting for them. fenceValue is signaled
+    // on semaphore() once they have completed.
+    bool submit(uint64_t& fenceValue);
+
     bool flush();
 
+    CgpuSemaphore semaphore() const;
+
     bool stageToBuffer(const uint8_t* src, uint64_t size, CgpuBuffer dst, uint64_t dstOffset = 0);
 
-    bool stageToImage(const uint8_t* src, uint64_t size, CgpuImage dst, uint32_t width, uint32_t height, uint32_t depth = 1);
+    // For block-compressed formats, blockDim is the height of a block in texels.
+    bool stageToImage(const uint8_t* src, uint64_t size, CgpuImage dst, uint32_t width, uint32_t height, uint32_t depth = 1,
+                      uint32_t mipLevel = 0, uint32_t blockDim = 1);
+
+    // Returns writable staging memory for an image of the given size so that data can be produced
+    // in place, or nullptr if it does not fit into the staging buffer. The region must be filled and
+    // committed or cancelled before any other staging call.
+    uint8_t* reserveImage(uint64_t size);
+
+    bool commitImage(CgpuImage dst, uint32_t width, uint32_t height, uint32_t depth = 1, uint32_t mipLevel = 0);
+
+    // Releases the reserved region without copying it, e.g. if producing the data failed.
+    void cancelImage();
 
   private:
     using CopyFunc = std::function<void(uint64_t srcOffset, uint64_t dstOffset, uint64_t size)>;
 
     bool stage(const uint8_t* src, uint64_t size, CopyFunc copyFunc);
 
+    bool allocateRegion(uint64_t size, uint64_t alignment, uint64_t& offset);
+
+    void addBufferCopy(CgpuBuffer dst, uint64_t srcOffset, uint64_t dstOffset, uint64_t size);
+
+    void recordPendingBufferCopy();
+
+    bool beginSegment();
+
+    bool nextSegment();
+
+    bool grow(uint64_t minSegmentSize);
+
+    bool createStagingBuffer(uint64_t segmentSize, CgpuBuffer& buffer, uint8_t*& mappedMem);
+
   private:
+    constexpr static uint32_t SEGMENT_COUNT = 4;
+
+    struct BufferCopy
+    {
+      CgpuBuffer dst;
+      uint64_t srcOffset;
+      uint64_t dstOffset;
+      uint64_t size = 0;
+    };
+
     CgpuDevice m_device;
 
-    uint32_t m_writeableHalf = 0;
     CgpuBuffer m_stagingBuffer;
-    CgpuCommandBuffer m_commandBuffers[2];
+    uint8_t* m_mappedMem = nullptr;
+    uint64_t m_segmentSize = 0;
+
+    uint32_t m_segment = 0;
+    CgpuCommandBuffer m_commandBuffers[SEGMENT_COUNT];
+    uint64_t m_segmentFenceValues[SEGMENT_COUNT] = {};
     CgpuSemaphore m_semaphore;
-    uint32_t m_semaphoreCounter = 0;
+    uint64_t m_semaphoreCounter = 0;
 
     bool m_commandsPending = false;
     uint64_t m_stagedBytes = 0;
-    uint8_t* m_mappedMem = nullptr;
+    uint64_t m_reservedBytes = 0;
+    BufferCopy m_pendingBufferCopy;
   };
 }
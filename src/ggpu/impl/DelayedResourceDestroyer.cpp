@@ -28,35 +28,29 @@ namespace gtl
 
   GgpuDelayedResourceDestroyer::~GgpuDelayedResourceDestroyer()
   {
-    for (uint32_t i = 0; i < FrameCount; i++)
-    {
-      assert(m_pendingDestructions[i].empty());
-    }
+    assert(m_pendingDestructions.empty());
   }
 
-  void GgpuDelayedResourceDestroyer::housekeep()
+  void GgpuDelayedResourceDestroyer::housekeep(uint64_t completedTimelineValue)
   {
-    auto& oldestFrameDestructions = m_pendingDestructions[m_frameIndex];
-    for (const DestroyFunc& fun : oldestFrameDestructions)
+    // Values are enqueued in ascending order.
+    while (!m_pendingDestructions.empty() &&
+           m_pendingDestructions.front().timelineValue <= completedTimelineValue)
     {
-      fun();
+      m_pendingDestructions.front().fun();
+      m_pendingDestructions.pop_front();
     }
-
-    oldestFrameDestructions.clear();
   }
 
-  void GgpuDelayedResourceDestroyer::nextFrame()
+  void GgpuDelayedResourceDestroyer::nextFrame(uint64_t timelineValue)
   {
-    m_frameIndex = (m_frameIndex + 1) % FrameCount;
+    assert(timelineValue >= m_timelineValue);
+    m_timelineValue = timelineValue;
   }
 
   void GgpuDelayedResourceDestroyer::destroyAll()
   {
-    for (uint32_t i = 0; i < FrameCount; i++)
-    {
-      nextFrame();
-      housekeep();
-    }
+    housekeep(UINT64_MAX);
   }
 
   void GgpuDelayedResourceDestroyer::enqueueDestruction(CgpuBuffer handle)
@@ -103,6 +97,6 @@ namespace gtl
 
   void GgpuDelayedResourceDestroyer::enqueueDestroyFunc(DestroyFunc fun)
   {
-    m_pendingDestructions[m_frameIndex].push_back(fun);
+    m_pendingDestructions.push_back({ m_timelineValue, fun });
   }
 }
@@ -21,8 +21,9 @@
 #include <string.h>
 #include <algorithm>
 
-const static uint64_t BUFFER_SIZE = 64 * 1024 * 1024;
-const static uint64_t BUFFER_HALF_SIZE = BUFFER_SIZE / 2;
+const static uint64_t INITIAL_SEGMENT_SIZE = 16 * 1024 * 1024;
+const static uint64_t MAX_SEGMENT_SIZE = 256 * 1024 * 1024;
+const static uint64_t IMAGE_COPY_ALIGNMENT = 16; // largest texel size
 
 namespace gtl
 {
@@ -34,40 +35,26 @@ namespace gtl
   GgpuStager::~GgpuStager()
   {
     // Ensure data has been flushed.
-    assert(m_stagedBytes == 0);
+    assert(!m_commandsPending);
   }
 
   bool GgpuStager::allocate()
   {
-    CgpuBufferCreateInfo createInfo = {
-      .usage = CgpuBufferUsage::TransferSrc,
-      .memoryProperties = CgpuMemoryProperties::DeviceLocal | CgpuMemoryProperties::HostVisible,
-      .size = BUFFER_SIZE,
-      .debugName = "Staging"
-    };
+    if (!createStagingBuffer(INITIAL_SEGMENT_SIZE, m_stagingBuffer, m_mappedMem))
+      goto fail;
 
-    bool bufferCreated = cgpuCreateBuffer(m_device, createInfo, &m_stagingBuffer);
+    m_segmentSize = INITIAL_SEGMENT_SIZE;
 
-    if (!bufferCreated)
+    for (uint32_t i = 0; i < SEGMENT_COUNT; i++)
     {
-      createInfo.memoryProperties = CgpuMemoryProperties::HostVisible | CgpuMemoryProperties::HostCached;
-
-      bufferCreated = cgpuCreateBuffer(m_device, createInfo, &m_stagingBuffer);
+      if (!cgpuCreateCommandBuffer(m_device, &m_commandBuffers[i]))
+        goto fail;
     }
 
-    if (!bufferCreated)
-      goto fail;
-
-    if (!cgpuCreateCommandBuffer(m_device, &m_commandBuffers[0]) ||
-        !cgpuCreateCommandBuffer(m_device, &m_commandBuffers[1]))
-      goto fail;
-
     if (!cgpuCreateSemaphore(m_device, &m_semaphore))
       goto fail;
 
-    cgpuMapBuffer(m_device, m_stagingBuffer, (void**) &m_mappedMem);
-
-    if (!cgpuBeginCommandBuffer(m_commandBuffers[m_writeableHalf]))
+    if (!beginSegment())
       goto fail;
 
     return true;
@@ -84,81 +71,264 @@ fail:
     if (m_mappedMem)
     {
       cgpuUnmapBuffer(m_device, m_stagingBuffer);
+      m_mappedMem = nullptr;
     }
-    cgpuEndCommandBuffer(m_commandBuffers[m_writeableHalf]);
+    cgpuEndCommandBuffer(m_commandBuffers[m_segment]);
     cgpuDestroySemaphore(m_device, m_semaphore);
-    cgpuDestroyCommandBuffer(m_device, m_commandBuffers[0]);
-    cgpuDestroyCommandBuffer(m_device, m_commandBuffers[1]);
+    for (uint32_t i = 0; i < SEGMENT_COUNT; i++)
+    {
+      cgpuDestroyCommandBuffer(m_device, m_commandBuffers[i]);
+    }
     cgpuDestroyBuffer(m_device, m_stagingBuffer);
   }
 
+  bool GgpuStager::createStagingBuffer(uint64_t segmentSize, CgpuBuffer& buffer, uint8_t*& mappedMem)
+  {
+    CgpuBufferCreateInfo createInfo = {
+      .usage = CgpuBufferUsage::TransferSrc,
+      .memoryProperties = CgpuMemoryProperties::DeviceLocal | CgpuMemoryProperties::HostVisible,
+      .size = segmentSize * SEGMENT_COUNT,
+      .debugName = "Staging"
+    };
+
+    bool bufferCreated = cgpuCreateBuffer(m_device, createInfo, &buffer);
+
+    if (!bufferCreated)
+    {
+      createInfo.memoryProperties = CgpuMemoryProperties::HostVisible | CgpuMemoryProperties::HostCached;
+
+      bufferCreated = cgpuCreateBuffer(m_device, createInfo, &buffer);
+    }
+
+    if (!bufferCreated)
+    {
+      return false;
+    }
+
+    cgpuMapBuffer(m_device, buffer, (void**) &mappedMem);
+
+    return true;
+  }
+
+  CgpuSemaphore GgpuStager::semaphore() const
+  {
+    return m_semaphore;
+  }
+
+  bool GgpuStager::submit(uint64_t& fenceValue)
+  {
+    if (m_commandsPending || m_pendingBufferCopy.size > 0)
+    {
+      if (!nextSegment())
+        return false;
+    }
+
+    fenceValue = m_semaphoreCounter;
+
+    return true;
+  }
+
   bool GgpuStager::flush()
   {
-    if (m_stagedBytes == 0 && !m_commandsPending)
-      return true;
+    uint64_t fenceValue;
+    return submit(fenceValue);
+  }
 
-    // Wait until previous submit is finished.
-    CgpuWaitSemaphoreInfo waitSemaphoreInfo{ .semaphore = m_semaphore, .value = m_semaphoreCounter };
-    if (!cgpuWaitSemaphores(m_device, 1, &waitSemaphoreInfo))
+  bool GgpuStager::beginSegment()
+  {
+    CgpuCommandBuffer commandBuffer = m_commandBuffers[m_segment];
+
+    if (!cgpuBeginCommandBuffer(commandBuffer))
       return false;
 
-    m_semaphoreCounter++;
+    // Destinations are updated in place, so the copies must not overtake
+    // earlier submissions (like frames in flight) that still access them.
+    CgpuMemoryBarrier barrier = {
+      .srcStageMask = CgpuPipelineStage::ComputeShader | CgpuPipelineStage::RayTracingShader |
+                      CgpuPipelineStage::Transfer | CgpuPipelineStage::AccelerationStructureBuild,
+      .srcAccessMask = CgpuMemoryAccess::ShaderWrite | CgpuMemoryAccess::TransferWrite |
+                       CgpuMemoryAccess::AccelerationStructureWrite,
+      .dstStageMask = CgpuPipelineStage::Transfer,
+      .dstAccessMask = CgpuMemoryAccess::TransferRead | CgpuMemoryAccess::TransferWrite
+    };
+
+    CgpuPipelineBarrier pipelineBarrier = {
+      .memoryBarrierCount = 1,
+      .memoryBarriers = &barrier
+    };
+
+    cgpuCmdPipelineBarrier(commandBuffer, &pipelineBarrier);
+
+    return true;
+  }
 
-    cgpuEndCommandBuffer(m_commandBuffers[m_writeableHalf]);
+  // Submits the current segment and makes the next one writable.
+  bool GgpuStager::nextSegment()
+  {
+    recordPendingBufferCopy();
+
+    cgpuEndCommandBuffer(m_commandBuffers[m_segment]);
 
-    uint32_t halfOffset = m_writeableHalf * BUFFER_HALF_SIZE;
-    cgpuFlushMappedMemory(m_device, m_stagingBuffer, halfOffset, halfOffset + m_stagedBytes);
+    cgpuFlushMappedMemory(m_device, m_stagingBuffer, m_segment * m_segmentSize, m_stagedBytes);
+
+    m_semaphoreCounter++;
+    m_segmentFenceValues[m_segment] = m_semaphoreCounter;
 
     CgpuSignalSemaphoreInfo signalSemaphoreInfo{ .semaphore = m_semaphore, .value = m_semaphoreCounter };
-    cgpuSubmitCommandBuffer(m_device, m_commandBuffers[m_writeableHalf], 1, &signalSemaphoreInfo);
+    cgpuSubmitCommandBuffer(m_device, m_commandBuffers[m_segment], 1, &signalSemaphoreInfo);
 
+    m_segment = (m_segment + 1) % SEGMENT_COUNT;
     m_stagedBytes = 0;
+    m_reservedBytes = 0;
     m_commandsPending = false;
-    m_writeableHalf = (m_writeableHalf == 0) ? 1 : 0;
 
-    if (!cgpuBeginCommandBuffer(m_commandBuffers[m_writeableHalf]))
+    // Wait until the GPU is done with the copies last recorded into this segment.
+    CgpuWaitSemaphoreInfo waitSemaphoreInfo{ .semaphore = m_semaphore, .value = m_segmentFenceValues[m_segment] };
+    if (!cgpuWaitSemaphores(m_device, 1, &waitSemaphoreInfo))
+      return false;
+
+    return beginSegment();
+  }
+
+  // Reallocates the ring for data that has to be contiguous, like image rows.
+  bool GgpuStager::grow(uint64_t minSegmentSize)
+  {
+    if (minSegmentSize > MAX_SEGMENT_SIZE)
+    {
       return false;
+    }
+
+    uint64_t segmentSize = m_segmentSize;
+    while (segmentSize < minSegmentSize)
+    {
+      segmentSize *= 2;
+    }
+    segmentSize = std::min(segmentSize, MAX_SEGMENT_SIZE);
+
+    // The old buffer is kept if the new one can't be created, so that smaller uploads still work.
+    CgpuBuffer stagingBuffer;
+    uint8_t* mappedMem;
+    if (!createStagingBuffer(segmentSize, stagingBuffer, mappedMem))
+    {
+      return false;
+    }
+
+    // In-flight copies read from the old buffer.
+    bool idle = nextSegment();
+    if (idle)
+    {
+      CgpuWaitSemaphoreInfo waitSemaphoreInfo{ .semaphore = m_semaphore, .value = m_semaphoreCounter };
+      idle = cgpuWaitSemaphores(m_device, 1, &waitSemaphoreInfo);
+    }
+
+    if (!idle)
+    {
+      cgpuUnmapBuffer(m_device, stagingBuffer);
+      cgpuDestroyBuffer(m_device, stagingBuffer);
+      return false;
+    }
+
+    cgpuUnmapBuffer(m_device, m_stagingBuffer);
+    cgpuDestroyBuffer(m_device, m_stagingBuffer);
+
+    m_stagingBuffer = stagingBuffer;
+    m_mappedMem = mappedMem;
+    m_segmentSize = segmentSize;
 
     return true;
   }
 
-  bool GgpuStager::stageToBuffer(const uint8_t* src, uint64_t size, CgpuBuffer dst, uint64_t dstBaseOffset)
+  // Returns the buffer offset of a region in the current segment, moving on
+  // to the next segment if it does not fit.
+  bool GgpuStager::allocateRegion(uint64_t size, uint64_t alignment, uint64_t& offset)
   {
-    if (size == 0)
+    if (size > m_segmentSize && !grow(size))
     {
-      assert(false);
-      return true;
+      return false;
+    }
+
+    uint64_t alignedStagedBytes = (m_stagedBytes + alignment - 1) & ~(alignment - 1);
+
+    if (alignedStagedBytes + size > m_segmentSize)
+    {
+      if (!nextSegment())
+      {
+        return false;
+      }
+
+      alignedStagedBytes = 0;
     }
 
-    if (size <= 65535)
+    m_stagedBytes = alignedStagedBytes;
+    offset = m_segment * m_segmentSize + m_stagedBytes;
+
+    return true;
+  }
+
+  // Copies to adjacent destination ranges are merged into a single command.
+  void GgpuStager::addBufferCopy(CgpuBuffer dst, uint64_t srcOffset, uint64_t dstOffset, uint64_t size)
+  {
+    BufferCopy& pending = m_pendingBufferCopy;
+
+    if (pending.size > 0 && pending.dst.handle == dst.handle &&
+        pending.srcOffset + pending.size == srcOffset &&
+        pending.dstOffset + pending.size == dstOffset)
     {
-      m_commandsPending = true;
+      pending.size += size;
+      return;
+    }
+
+    recordPendingBufferCopy();
+
+    pending = BufferCopy{ .dst = dst, .srcOffset = srcOffset, .dstOffset = dstOffset, .size = size };
+  }
+
+  void GgpuStager::recordPendingBufferCopy()
+  {
+    BufferCopy& pending = m_pendingBufferCopy;
 
-      cgpuCmdUpdateBuffer(m_commandBuffers[m_writeableHalf], src, size, dst, dstBaseOffset);
+    if (pending.size == 0)
+    {
+      return;
+    }
 
+    cgpuCmdCopyBuffer(
+      m_commandBuffers[m_segment],
+      m_stagingBuffer,
+      pending.srcOffset,
+      pending.dst,
+      pending.dstOffset,
+      pending.size
+    );
+
+    m_commandsPending = true;
+    pending.size = 0;
+  }
+
+  bool GgpuStager::stageToBuffer(const uint8_t* src, uint64_t size, CgpuBuffer dst, uint64_t dstBaseOffset)
+  {
+    if (size == 0)
+    {
+      assert(false);
       return true;
     }
 
+    // Small uploads go through the ring as well, where they can be coalesced,
+    // instead of being embedded into the command buffer.
     auto copyFunc = [this, dst, dstBaseOffset](uint64_t srcOffset, uint64_t dstOffset, uint64_t size) {
-      cgpuCmdCopyBuffer(
-        m_commandBuffers[m_writeableHalf],
-        m_stagingBuffer,
-        srcOffset,
-        dst,
-        dstBaseOffset + dstOffset,
-        size
-      );
+      addBufferCopy(dst, srcOffset, dstBaseOffset + dstOffset, size);
     };
 
     return stage(src, size, copyFunc);
   }
 
-  bool GgpuStager::stageToImage(const uint8_t* src, uint64_t size, CgpuImage dst, uint32_t width, uint32_t height, uint32_t depth)
+  bool GgpuStager::stageToImage(const uint8_t* src, uint64_t size, CgpuImage dst, uint32_t width, uint32_t height, uint32_t depth,
+                                uint32_t mipLevel, uint32_t blockDim)
   {
-    uint32_t rowCount = height;
+    uint32_t rowCount = (height + blockDim - 1) / blockDim;
     uint64_t rowSize = size / rowCount;
 
-    if (rowSize > BUFFER_HALF_SIZE)
+    if (rowSize > m_segmentSize && !grow(rowSize))
     {
       return false;
     }
@@ -167,34 +337,39 @@ fail:
 
     while (rowsStaged < rowCount)
     {
-      uint64_t remainingSpace = BUFFER_HALF_SIZE - m_stagedBytes;
+      // Buffer offsets of image copies must be a multiple of the texel size.
+      uint64_t alignedStagedBytes = (m_stagedBytes + IMAGE_COPY_ALIGNMENT - 1) & ~(IMAGE_COPY_ALIGNMENT - 1);
+      m_stagedBytes = std::min(alignedStagedBytes, m_segmentSize);
+
+      uint64_t remainingSpace = m_segmentSize - m_stagedBytes;
       uint32_t maxCopyRowCount = uint32_t(remainingSpace / rowSize); // truncate
 
       if (maxCopyRowCount == 0)
       {
-        if (!flush())
+        if (!nextSegment())
         {
           return false;
         }
 
-        maxCopyRowCount = uint32_t(BUFFER_HALF_SIZE / rowSize); // truncate
+        maxCopyRowCount = uint32_t(m_segmentSize / rowSize); // truncate
       }
 
       uint32_t remainingRowCount = rowCount - rowsStaged;
       uint32_t copyRowCount = std::min(remainingRowCount, maxCopyRowCount);
 
-      auto copyFunc = [this, dst, rowsStaged, width, depth, copyRowCount](uint64_t srcOffset, [[maybe_unused]] uint64_t dstOffset, [[maybe_unused]] uint64_t size) {
+      auto copyFunc = [this, dst, rowsStaged, width, height, depth, mipLevel, blockDim, copyRowCount](uint64_t srcOffset, [[maybe_unused]] uint64_t dstOffset, [[maybe_unused]] uint64_t size) {
         CgpuBufferImageCopyDesc desc;
         desc.bufferOffset = srcOffset;
         desc.texelOffsetX = 0;
         desc.texelExtentX = width;
-        desc.texelOffsetY = rowsStaged;
-        desc.texelExtentY = copyRowCount;
+        desc.texelOffsetY = rowsStaged * blockDim;
+        desc.texelExtentY = std::min(copyRowCount * blockDim, height - desc.texelOffsetY);
         desc.texelOffsetZ = 0;
         desc.texelExtentZ = depth;
+        desc.mipLevel = mipLevel;
 
         cgpuCmdCopyBufferToImage(
-          m_commandBuffers[m_writeableHalf],
+          m_commandBuffers[m_segment],
           m_stagingBuffer,
           dst,
           &desc
@@ -214,37 +389,75 @@ fail:
     return true;
   }
 
-  bool GgpuStager::stage(const uint8_t* src, uint64_t size, CopyFunc copyFunc)
+  uint8_t* GgpuStager::reserveImage(uint64_t size)
   {
-    uint64_t bytesToStage = size;
+    assert(m_reservedBytes == 0);
 
-    while (bytesToStage > 0)
+    uint64_t offset;
+    if (size == 0 || !allocateRegion(size, IMAGE_COPY_ALIGNMENT, offset))
     {
-      uint64_t bytesAlreadyCopied = size - bytesToStage;
+      return nullptr;
+    }
 
-      uint64_t availableSpace = BUFFER_HALF_SIZE - m_stagedBytes;
-      uint64_t memcpyByteCount = std::min(bytesToStage, availableSpace);
-      bytesToStage -= memcpyByteCount;
+    m_reservedBytes = size;
 
-      uint64_t dstOffset = m_writeableHalf * BUFFER_HALF_SIZE + m_stagedBytes;
-      memcpy(&m_mappedMem[dstOffset], &src[bytesAlreadyCopied], memcpyByteCount);
+    return &m_mappedMem[offset];
+  }
 
-      copyFunc(dstOffset, bytesAlreadyCopied, memcpyByteCount);
+  bool GgpuStager::commitImage(CgpuImage dst, uint32_t width, uint32_t height, uint32_t depth, uint32_t mipLevel)
+  {
+    if (m_reservedBytes == 0)
+    {
+      assert(false);
+      return false;
+    }
 
-      m_commandsPending = true;
-      m_stagedBytes += memcpyByteCount;
+    CgpuBufferImageCopyDesc desc;
+    desc.bufferOffset = m_segment * m_segmentSize + m_stagedBytes;
+    desc.texelExtentX = width;
+    desc.texelExtentY = height;
+    desc.texelExtentZ = depth;
+    desc.mipLevel = mipLevel;
 
-      if (m_stagedBytes != BUFFER_HALF_SIZE)
-      {
-        continue;
-      }
+    cgpuCmdCopyBufferToImage(m_commandBuffers[m_segment], m_stagingBuffer, dst, &desc);
+
+    m_commandsPending = true;
+    m_stagedBytes += m_reservedBytes;
+    m_reservedBytes = 0;
+
+    return true;
+  }
+
+  void GgpuStager::cancelImage()
+  {
+    assert(m_reservedBytes > 0);
+
+    m_reservedBytes = 0;
+  }
+
+  bool GgpuStager::stage(const uint8_t* src, uint64_t size, CopyFunc copyFunc)
+  {
+    assert(m_reservedBytes == 0);
+
+    uint64_t bytesStaged = 0;
 
-      if (flush())
+    while (bytesStaged < size)
+    {
+      if (m_stagedBytes == m_segmentSize && !nextSegment())
       {
-        continue;
+        return false;
       }
 
-      return false;
+      uint64_t chunkSize = std::min(size - bytesStaged, m_segmentSize - m_stagedBytes);
+      uint64_t srcOffset = m_segment * m_segmentSize + m_stagedBytes;
+
+      memcpy(&m_mappedMem[srcOffset], &src[bytesStaged], chunkSize);
+
+      copyFunc(srcOffset, bytesStaged, chunkSize);
+
+      m_commandsPending = true;
+      m_stagedBytes += chunkSize;
+      bytesStaged += chunkSize;
     }
 
     return true;
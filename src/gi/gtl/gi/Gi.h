@@ -70,7 +70,10 @@ namespace gtl
   {
     Int32,
     Float32,
-    Float32Vec4
+    Float32Vec4,
+    Float16Vec4,  // color and normals
+    UNorm8Vec4,   // color
+    PackedNormal  // octahedral, 2x16 bit UNorm
   };
 
   enum class GiPrimvarType
@@ -137,6 +140,7 @@ namespace gtl
 
   struct GiRenderSettings
   {
+    bool     bvhCompaction;
     bool     clippingPlanes;
     bool     depthOfField;
     bool     domeLightCameraVisible;
@@ -153,6 +157,30 @@ namespace gtl
     uint32_t rrBounceOffset;
     float    rrInvMinTermProb;
     uint32_t spp;
+    // Members below can change without resetting accumulation.
+    float    frameTimeBudget; // GPU time in ms that limits the samples traced per frame; unlimited if 0
+    uint32_t sampleLimit; // accumulated samples after which frames only trace a single sample; unlimited if 0
+  };
+
+  enum class GiToneMapping
+  {
+    None,
+    Reinhard,
+    AcesFilmic
+  };
+
+  enum class GiDisplayTransform
+  {
+    Linear,
+    Srgb
+  };
+
+  // Applied on the GPU to the color AOV before it is read back.
+  struct GiPostProcessSettings
+  {
+    GiDisplayTransform displayTransform = GiDisplayTransform::Linear;
+    float              exposure = 0.0f; // in stops
+    GiToneMapping      toneMapping = GiToneMapping::None;
   };
 
   struct GiAovBinding
@@ -167,10 +195,18 @@ namespace gtl
     std::vector<GiAovBinding> aovBindings;
     GiCameraDesc              camera;
     GiDomeLight*              domeLight;
+    GiPostProcessSettings     postProcess;
     GiRenderSettings          renderSettings;
     GiScene*                  scene;
   };
 
+  enum class GiTextureCompression
+  {
+    None,
+    Fast,
+    HighQuality // slower encoding
+  };
+
   struct GiInitParams
   {
     std::string_view shaderPath;
@@ -178,6 +214,10 @@ namespace gtl
     const std::vector<std::string>& mdlSearchPaths;
     const std::shared_ptr<void/*MaterialX::Document*/> mtlxStdLib;
     std::string mtlxCustomNodesPath;
+    std::string pipelineCacheDir; // disabled if empty
+    GiTextureCompression textureCompression = GiTextureCompression::None;
+    uint32_t maxTextureResolution = 0; // unlimited if 0
+    uint32_t framesInFlight = 1; // frames giRender may queue before blocking
   };
 
   class GiAssetReader
@@ -210,9 +250,13 @@ namespace gtl
   void giSetMeshInstanceIds(GiMesh* mesh, uint32_t count, int* ids);
   void giSetMeshMaterial(GiMesh* mesh, GiMaterial* mat);
   void giSetMeshVisibility(GiMesh* mesh, bool visible);
+  bool giUpdateMeshVertices(GiMesh* mesh, const std::vector<GiVertex>& vertices);
   void giDestroyMesh(GiMesh* mesh);
 
+  // Traces up to spp samples, fewer if they exceed the frame time budget.
   GiStatus giRender(const GiRenderParams& params);
+  // Returns the number of samples accumulated since the last reset.
+  uint32_t giGetSampleCount(const GiScene* scene);
 
   GiScene* giCreateScene();
   void giDestroyScene(GiScene* scene);
@@ -255,5 +299,7 @@ namespace gtl
 
   GiRenderBuffer* giCreateRenderBuffer(uint32_t width, uint32_t height, GiRenderBufferFormat format);
   void giDestroyRenderBuffer(GiRenderBuffer* renderBuffer);
+  // Returns the most recently completed frame; valid until the next giRender call.
+  // Render buffers are only read back by frames following a call to this function.
   void* giGetRenderBufferMem(GiRenderBuffer* renderBuffer);
 }
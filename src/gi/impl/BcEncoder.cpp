@@ -0,0 +1,119 @@
+//
+// Copyright (C) 2025 Pablo Delgado Krämer
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "BcEncoder.h"
+
+#define STB_DXT_IMPLEMENTATION
+#define STB_DXT_STATIC
+#include <stb_dxt.h>
+
+#include <algorithm>
+
+#include <string.h>
+
+namespace
+{
+  using namespace gtl;
+
+  bool _HasTransparency(const ImgioImage& image)
+  {
+    for (size_t i = 3; i < image.size; i += 4)
+    {
+      if (image.data[i] != 255)
+      {
+        return true;
+      }
+    }
+    return false;
+  }
+}
+
+namespace gtl
+{
+  uint32_t giBcGetBlockSize(CgpuImageFormat format)
+  {
+    return (format == CgpuImageFormat::Bc1RgbaUnormBlock || format == CgpuImageFormat::Bc4UnormBlock) ? 8 : 16;
+  }
+
+  bool giBcSelectFormat(const ImgioImage& image, CgpuImageFormat& format)
+  {
+    switch (image.format)
+    {
+    case ImgioFormat::R8:
+      format = CgpuImageFormat::Bc4UnormBlock;
+      return true;
+    case ImgioFormat::RG8:
+      format = CgpuImageFormat::Bc5UnormBlock;
+      return true;
+    case ImgioFormat::RGBA8:
+      format = _HasTransparency(image) ? CgpuImageFormat::Bc3UnormBlock : CgpuImageFormat::Bc1RgbaUnormBlock;
+      return true;
+    default:
+      return false;
+    }
+  }
+
+  void giBcEncodeImage(const ImgioImage& image, CgpuImageFormat format, bool highQuality, std::vector<uint8_t>& blocks)
+  {
+    uint32_t blockCountX = (image.width + GI_BC_BLOCK_DIM - 1) / GI_BC_BLOCK_DIM;
+    uint32_t blockCountY = (image.height + GI_BC_BLOCK_DIM - 1) / GI_BC_BLOCK_DIM;
+    uint32_t blockSize = giBcGetBlockSize(format);
+    uint32_t pixelSize = ImgioGetFormatPixelSize(image.format);
+
+    blocks.resize(size_t(blockCountX) * blockCountY * blockSize);
+
+    int mode = highQuality ? STB_DXT_HIGHQUAL : STB_DXT_NORMAL;
+
+#pragma omp parallel for
+    for (int by = 0; by < int(blockCountY); by++)
+    {
+      uint8_t texels[GI_BC_BLOCK_DIM * GI_BC_BLOCK_DIM * 4];
+
+      for (uint32_t bx = 0; bx < blockCountX; bx++)
+      {
+        // Replicate edge texels into partial blocks.
+        for (uint32_t y = 0; y < GI_BC_BLOCK_DIM; y++)
+        {
+          uint32_t srcY = std::min(by * GI_BC_BLOCK_DIM + y, image.height - 1);
+
+          for (uint32_t x = 0; x < GI_BC_BLOCK_DIM; x++)
+          {
+            uint32_t srcX = std::min(bx * GI_BC_BLOCK_DIM + x, image.width - 1);
+
+            const uint8_t* src = &image.data[(size_t(srcY) * image.width + srcX) * pixelSize];
+            memcpy(&texels[(y * GI_BC_BLOCK_DIM + x) * pixelSize], src, pixelSize);
+          }
+        }
+
+        uint8_t* dst = &blocks[(size_t(by) * blockCountX + bx) * blockSize];
+
+        switch (format)
+        {
+        case CgpuImageFormat::Bc4UnormBlock:
+          stb_compress_bc4_block(dst, texels);
+          break;
+        case CgpuImageFormat::Bc5UnormBlock:
+          stb_compress_bc5_block(dst, texels);
+          break;
+        default:
+          stb_compress_dxt_block(dst, texels, format == CgpuImageFormat::Bc3UnormBlock, mode);
+          break;
+        }
+      }
+    }
+  }
+}
@@ -0,0 +1,37 @@
+//
+// Copyright (C) 2025 Pablo Delgado Krämer
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#pragma once
+
+#include <gtl/cgpu/Cgpu.h>
+#include <gtl/imgio/Image.h>
+
+#include <vector>
+
+namespace gtl
+{
+  constexpr static const uint32_t GI_BC_BLOCK_DIM = 4;
+
+  // Picks BC1 or BC3 for RGBA8 (depending on alpha), BC4 for R8 and BC5 for RG8.
+  // Returns false for formats that are not block-compressed, such as HDR images.
+  bool giBcSelectFormat(const ImgioImage& image, CgpuImageFormat& format);
+
+  // Bytes per 4x4 block of a BC format.
+  uint32_t giBcGetBlockSize(CgpuImageFormat format);
+
+  void giBcEncodeImage(const ImgioImage& image, CgpuImageFormat format, bool highQuality, std::vector<uint8_t>& blocks);
+}
@@ -21,11 +21,11 @@
 
 #include "Gi.h"
 #include "TextureManager.h"
-#include "Turbo.h"
 #include "AssetReader.h"
 #include "GlslShaderGen.h"
 #include "MeshProcessing.h"
 #include "interface/rp_main.h"
+#include "interface/pp_main.h"
 
 #include <stdlib.h>
 #include <string.h>
@@ -39,6 +39,7 @@
 #include <atomic>
 #include <optional>
 #include <mutex>
+#include <thread>
 #include <assert.h>
 
 #include <gtl/ggpu/Stager.h>
@@ -76,8 +77,16 @@ namespace mx = MaterialX;
 namespace gtl
 {
   constexpr static const float BYTES_TO_MIB = 1.0f / (1024.0f * 1024.0f);
+  constexpr static const uint32_t GI_MAX_TLAS_REFIT_COUNT = 16;
+  constexpr static const uint32_t GI_MAX_BLAS_REFIT_COUNT = 16;
+  constexpr static const uint32_t GI_MAX_FRAMES_IN_FLIGHT = 4;
+  constexpr static const uint32_t GI_MESH_PAYLOAD_WINDOW_SIZE_PER_THREAD = 4;
 
   namespace rp = shader_interface::rp_main;
+  namespace pp = shader_interface::pp_main;
+
+  // AOV bits share the aovMaskAndFlags push constant with the PC_FLAG_* bits
+  static_assert((1u << uint32_t(GiAovId::COUNT)) <= rp::PC_FLAG_NEXT_EVENT_ESTIMATION, "AOV mask overlaps push constant flags");
 
   class McRuntime;
 
@@ -92,6 +101,9 @@ namespace gtl
     CgpuBlas blas;
     CgpuBuffer payloadBuffer;
     rp::BlasPayload payload;
+    uint64_t vertexBufferOffset;
+    std::optional<CgpuBlasCreateInfo> refitInfo; // BLAS build inputs kept alive for deforming meshes
+    uint32_t refitCount = 0; // since the last BLAS build
   };
 
   struct GiBvh
@@ -100,6 +112,8 @@ namespace gtl
     CgpuBuffer instanceIdsBuffer;
     GiScene*   scene;
     CgpuTlas   tlas;
+    uint32_t   instanceCount;
+    uint32_t   refitCount = 0;
   };
 
   struct GiImageBinding
@@ -154,6 +168,8 @@ namespace gtl
     bool visible = true;
     std::string name;
     uint32_t maxFaceId;
+    uint32_t tlasInstanceOffset = UINT32_MAX; // UINT32_MAX if not part of the TLAS
+    bool isDeforming = false;
   };
 
   struct GiSphereLight
@@ -203,6 +219,8 @@ namespace gtl
     DirtyAovBindingDefaults = (1 << 7),
     DirtySceneParams        = (1 << 8),
     DirtyBindSets           = (1 << 9),
+    DirtyTlasInstances      = (1 << 10),
+    DirtyBlasVertices       = (1 << 11),
     All                     = ~0u
   };
   GB_DECLARE_ENUM_BITOPS(GiSceneDirtyFlags)
@@ -219,6 +237,8 @@ namespace gtl
     glm::vec4 backgroundColor = glm::vec4(-1.0f); // used to initialize fallback dome light
     CgpuImage fallbackDomeLightTexture;
     std::unordered_set<GiMesh*> meshes;
+    std::unordered_set<GiMesh*> dirtyTlasMeshes;
+    std::unordered_set<GiMesh*> deformedMeshes;
     std::unordered_set<GiMaterial*> materials;
     std::mutex mutex;
     GiSceneDirtyFlags dirtyFlags = GiSceneDirtyFlags::All;
@@ -231,16 +251,46 @@ namespace gtl
     OffsetAllocator::Allocator texAllocator{rp::MAX_TEXTURE_COUNT};
   };
 
+  struct GiReadbackBuffer
+  {
+    CgpuBuffer buffer;
+    void* mappedMem = nullptr;
+    uint64_t frame = 0; // timeline value of the frame that writes it
+  };
+
+  enum class GiPostProcessMode
+  {
+    None,
+    Color,
+    Heatmap
+  };
+
   struct GiRenderBuffer
   {
     CgpuBuffer deviceMem;
-    CgpuBuffer hostMem;
-    void* mappedHostMem;
+    CgpuBuffer accumulationMem; // Float32Vec4 trace target if post-processed
+    std::vector<GiReadbackBuffer> readbackBuffers; // one per frame in flight
+    uint64_t resolvedFrame = 0;
+    uint64_t renderedFrame = 0;
+    uint64_t lastUnreadFrame = 0; // rendered without readback
+    bool readbackRequested = false; // mapped since the last frame
+    GiPostProcessMode postProcessMode = GiPostProcessMode::None;
+    GiPostProcessSettings postProcessSettings;
+    GiRenderBufferFormat format;
     uint32_t width = 0;
     uint32_t height = 0;
     uint32_t size = 0;
   };
 
+  struct GiFrame
+  {
+    CgpuCommandBuffer commandBuffer;
+    uint64_t timelineValue = 0;
+    CgpuBuffer timestampBuffer; // start and end of the trace
+    void* timestamps = nullptr;
+    uint64_t tracedPixelSamples = 0; // 0 once the timestamps have been read
+  };
+
   bool s_cgpuInitialized = false;
   CgpuDevice s_device;
   CgpuDeviceFeatures s_deviceFeatures;
@@ -257,6 +307,14 @@ namespace gtl
   std::unique_ptr<GiTextureManager> s_texSys;
   std::atomic_bool s_forceShaderCacheInvalid = false;
   std::atomic_bool s_resetSampleOffset = false;
+  std::vector<GiFrame> s_frames;
+  CgpuSemaphore s_frameSemaphore;
+  CgpuCommandBuffer s_readbackCommandBuffer;
+  CgpuShader s_postProcessShader;
+  CgpuPipeline s_postProcessPipeline;
+  CgpuBuffer s_postProcessMaxValue;
+  uint64_t s_frameCounter = 0; // timeline value of the last submitted frame
+  double s_traceNsPerPixelSample = 0.0; // measured by previous frames; 0 if unknown
 
 #ifdef GI_SHADER_HOTLOADING
   class ShaderFileListener : public efsw::FileWatchListener
@@ -309,12 +367,92 @@ namespace gtl
       return 4;
     case GiRenderBufferFormat::Float32Vec4:
       return 4 * 4;
+    case GiRenderBufferFormat::Float16Vec4:
+      return 2 * 4;
+    case GiRenderBufferFormat::UNorm8Vec4:
+      return 4;
+    case GiRenderBufferFormat::PackedNormal:
+      return 4;
     default:
       assert(false);
       return 0;
     }
   }
 
+  // Compact formats are converted to in the shaders, which is only implemented for some AOVs.
+  // Color and clock cycles are converted to them by the post-processing pass.
+  bool _GiIsAovFormatSupported(GiAovId aovId, GiRenderBufferFormat format)
+  {
+    switch (format)
+    {
+    case GiRenderBufferFormat::Float16Vec4:
+      return aovId == GiAovId::Color || aovId == GiAovId::Normal || aovId == GiAovId::ClockCycles;
+    case GiRenderBufferFormat::UNorm8Vec4:
+      return aovId == GiAovId::Color || aovId == GiAovId::ClockCycles;
+    case GiRenderBufferFormat::PackedNormal:
+      return aovId == GiAovId::Normal;
+    default:
+      return true;
+    }
+  }
+
+  // Returns the format that the trace writes, which differs for post-processed render buffers.
+  GiRenderBufferFormat _GiGetAovFormat(const GiRenderParams& params, GiAovId aovId)
+  {
+    for (const GiAovBinding& binding : params.aovBindings)
+    {
+      if (binding.aovId != aovId)
+      {
+        continue;
+      }
+      if (binding.renderBuffer->accumulationMem.handle)
+      {
+        return GiRenderBufferFormat::Float32Vec4;
+      }
+      return binding.renderBuffer->format;
+    }
+    return GiRenderBufferFormat::Float32Vec4;
+  }
+
+  // Color in these formats can't be accumulated into and is resolved by the post-processing pass.
+  bool _GiIsCompactColorFormat(GiRenderBufferFormat format)
+  {
+    return format == GiRenderBufferFormat::Float16Vec4 || format == GiRenderBufferFormat::UNorm8Vec4;
+  }
+
+  GiPostProcessMode _GiGetPostProcessMode(GiAovId aovId, GiRenderBufferFormat format, const GiPostProcessSettings& settings)
+  {
+    if (aovId == GiAovId::ClockCycles)
+    {
+      return GiPostProcessMode::Heatmap;
+    }
+
+    bool isIdentity = settings.displayTransform == GiDisplayTransform::Linear &&
+                      settings.exposure == 0.0f &&
+                      settings.toneMapping == GiToneMapping::None;
+
+    // Accumulating in a compact format would clamp and stall the running mean.
+    if (aovId == GiAovId::Color && (!isIdentity || _GiIsCompactColorFormat(format)))
+    {
+      return GiPostProcessMode::Color;
+    }
+
+    return GiPostProcessMode::None;
+  }
+
+  uint32_t _GiGetPostProcessOutputFormat(GiRenderBufferFormat format)
+  {
+    switch (format)
+    {
+    case GiRenderBufferFormat::Float16Vec4:
+      return pp::OUTPUT_FORMAT_FLOAT16;
+    case GiRenderBufferFormat::UNorm8Vec4:
+      return pp::OUTPUT_FORMAT_UNORM8;
+    default:
+      return pp::OUTPUT_FORMAT_FLOAT32;
+    }
+  }
+
   void _PrintInitInfo(const GiInitParams& params)
   {
     GB_LOG("gatling {}.{}.{} built against MaterialX {}.{}.{}", GI_VERSION_MAJOR, GI_VERSION_MINOR, GI_VERSION_PATCH,
@@ -322,24 +460,282 @@ namespace gtl
     GB_LOG("> shader path: \"{}\"", params.shaderPath);
     GB_LOG("> MDL runtime path: \"{}\"", params.mdlRuntimePath);
     GB_LOG("> MDL search paths: {}", params.mdlSearchPaths);
+    GB_LOG("> pipeline cache dir: \"{}\"", params.pipelineCacheDir);
+    GB_LOG("> texture compression: {}", int(params.textureCompression));
+    GB_LOG("> max texture resolution: {}", params.maxTextureResolution);
+    GB_LOG("> frames in flight: {}", params.framesInFlight);
+  }
+
+  uint64_t _giGetCompletedFrame()
+  {
+    uint64_t value = 0;
+    if (!cgpuGetSemaphoreValue(s_device, s_frameSemaphore, &value))
+    {
+      GB_ERROR("{}:{}: failed to query frame semaphore", __FILE__, __LINE__);
+    }
+    return value;
+  }
+
+  bool _giWaitForFrame(uint64_t timelineValue)
+  {
+    CgpuWaitSemaphoreInfo waitSemaphoreInfo = { .semaphore = s_frameSemaphore, .value = timelineValue };
+    return cgpuWaitSemaphores(s_device, 1, &waitSemaphoreInfo);
+  }
+
+  // Needed before resources that frames in flight access are modified or destroyed.
+  bool _giWaitForFrames()
+  {
+    return _giWaitForFrame(s_frameCounter);
+  }
+
+  // Updates the trace cost estimate with the timestamps of completed frames.
+  void _giCollectFrameTimings()
+  {
+    uint64_t completedFrame = _giGetCompletedFrame();
+
+    for (GiFrame& frame : s_frames)
+    {
+      if (frame.tracedPixelSamples == 0 || frame.timelineValue > completedFrame)
+      {
+        continue;
+      }
+
+      cgpuInvalidateMappedMemory(s_device, frame.timestampBuffer, 0, CGPU_WHOLE_SIZE);
+
+      const uint64_t* timestamps = (const uint64_t*) frame.timestamps;
+      double traceNs = double(timestamps[1] - timestamps[0]) * s_deviceProperties.timestampPeriod;
+      double nsPerPixelSample = traceNs / double(frame.tracedPixelSamples);
+
+      // Smooth out noise from varying sample costs.
+      s_traceNsPerPixelSample = (s_traceNsPerPixelSample > 0.0) ? (s_traceNsPerPixelSample + nsPerPixelSample) * 0.5 : nsPerPixelSample;
+
+      frame.tracedPixelSamples = 0;
+    }
+  }
+
+  uint32_t _giGetFrameSampleCount(const GiRenderSettings& renderSettings, uint32_t sampleOffset, uint32_t pixelCount)
+  {
+    uint32_t sampleCount = renderSettings.spp;
+
+    // Chunks only add up to the same image if they are accumulated.
+    if (!renderSettings.progressiveAccumulation)
+    {
+      return sampleCount;
+    }
+
+    // Only trace the samples still missing, counted from after a potential accumulation reset.
+    if (renderSettings.sampleLimit > 0)
+    {
+      uint32_t remainingSampleCount = renderSettings.sampleLimit - std::min(sampleOffset, renderSettings.sampleLimit);
+      sampleCount = std::clamp(remainingSampleCount, 1u, std::max(sampleCount, 1u));
+    }
+
+    if (renderSettings.frameTimeBudget <= 0.0f)
+    {
+      return sampleCount;
+    }
+
+    _giCollectFrameTimings();
+
+    // Start with a single sample until the first frame has been timed.
+    uint32_t budgetSampleCount = 1;
+    if (s_traceNsPerPixelSample > 0.0)
+    {
+      double budgetNs = double(renderSettings.frameTimeBudget) * 1000000.0;
+      double sampleNs = s_traceNsPerPixelSample * pixelCount;
+      budgetSampleCount = uint32_t(std::min(budgetNs / sampleNs, double(UINT32_MAX)));
+    }
+
+    return std::clamp(budgetSampleCount, 1u, std::max(sampleCount, 1u));
+  }
+
+  void _giCmdMemoryBarrier(CgpuCommandBuffer commandBuffer,
+                           CgpuPipelineStage srcStageMask, CgpuMemoryAccess srcAccessMask,
+                           CgpuPipelineStage dstStageMask, CgpuMemoryAccess dstAccessMask)
+  {
+    CgpuMemoryBarrier barrier = {
+      .srcStageMask = srcStageMask,
+      .srcAccessMask = srcAccessMask,
+      .dstStageMask = dstStageMask,
+      .dstAccessMask = dstAccessMask
+    };
+
+    CgpuPipelineBarrier pipelineBarrier = {
+      .memoryBarrierCount = 1,
+      .memoryBarriers = &barrier
+    };
+
+    cgpuCmdPipelineBarrier(commandBuffer, &pipelineBarrier);
+  }
+
+  // Resolves the accumulation buffers of post-processed render buffers into their device memory.
+  void _giRecordPostProcess(CgpuCommandBuffer commandBuffer, const std::vector<GiRenderBuffer*>& renderBuffers)
+  {
+    bool hasPostProcessing = std::any_of(renderBuffers.begin(), renderBuffers.end(), [](const GiRenderBuffer* b) {
+      return b->postProcessMode != GiPostProcessMode::None;
+    });
+
+    if (!hasPostProcessing)
+    {
+      return;
+    }
+
+    // Wait for the trace and for earlier readbacks of the output.
+    _giCmdMemoryBarrier(commandBuffer,
+                        CgpuPipelineStage::RayTracingShader | CgpuPipelineStage::ComputeShader | CgpuPipelineStage::Transfer,
+                        CgpuMemoryAccess::ShaderWrite,
+                        CgpuPipelineStage::ComputeShader | CgpuPipelineStage::Transfer,
+                        CgpuMemoryAccess::ShaderRead | CgpuMemoryAccess::ShaderWrite | CgpuMemoryAccess::TransferWrite);
+
+    cgpuCmdBindPipeline(commandBuffer, s_postProcessPipeline, nullptr, 0);
+
+    for (GiRenderBuffer* renderBuffer : renderBuffers)
+    {
+      if (renderBuffer->postProcessMode == GiPostProcessMode::None)
+      {
+        continue;
+      }
+
+      const GiPostProcessSettings& settings = renderBuffer->postProcessSettings;
+
+      pp::PushConstants pushData = {
+        .inputAddress       = cgpuGetBufferAddress(s_device, renderBuffer->accumulationMem),
+        .outputAddress      = cgpuGetBufferAddress(s_device, renderBuffer->deviceMem),
+        .maxValueAddress    = cgpuGetBufferAddress(s_device, s_postProcessMaxValue),
+        .imageWidth         = renderBuffer->width,
+        .imageHeight        = renderBuffer->height,
+        .mode               = pp::MODE_COLOR,
+        .outputFormat       = _GiGetPostProcessOutputFormat(renderBuffer->format),
+        .exposureMultiplier = exp2f(settings.exposure),
+        .toneMapping        = uint32_t(settings.toneMapping),
+        .displayTransform   = uint32_t(settings.displayTransform)
+      };
+
+      uint32_t groupCountX = (renderBuffer->width + pp::WORKGROUP_SIZE_X - 1) / pp::WORKGROUP_SIZE_X;
+      uint32_t groupCountY = (renderBuffer->height + pp::WORKGROUP_SIZE_Y - 1) / pp::WORKGROUP_SIZE_Y;
+
+      if (renderBuffer->postProcessMode == GiPostProcessMode::Heatmap)
+      {
+        cgpuCmdFillBuffer(commandBuffer, s_postProcessMaxValue);
+
+        _giCmdMemoryBarrier(commandBuffer, CgpuPipelineStage::Transfer, CgpuMemoryAccess::TransferWrite,
+                            CgpuPipelineStage::ComputeShader, CgpuMemoryAccess::ShaderRead | CgpuMemoryAccess::ShaderWrite);
+
+        pushData.mode = pp::MODE_HEATMAP_MAX;
+        cgpuCmdPushConstants(commandBuffer, s_postProcessPipeline, sizeof(pushData), &pushData);
+        cgpuCmdDispatch(commandBuffer, groupCountX, groupCountY, 1);
+
+        _giCmdMemoryBarrier(commandBuffer, CgpuPipelineStage::ComputeShader, CgpuMemoryAccess::ShaderWrite,
+                            CgpuPipelineStage::ComputeShader, CgpuMemoryAccess::ShaderRead);
+
+        pushData.mode = pp::MODE_HEATMAP;
+      }
+
+      cgpuCmdPushConstants(commandBuffer, s_postProcessPipeline, sizeof(pushData), &pushData);
+      cgpuCmdDispatch(commandBuffer, groupCountX, groupCountY, 1);
+
+      // The max value buffer is reused by the next heatmap.
+      if (renderBuffer->postProcessMode == GiPostProcessMode::Heatmap)
+      {
+        _giCmdMemoryBarrier(commandBuffer, CgpuPipelineStage::ComputeShader, CgpuMemoryAccess::ShaderRead,
+                            CgpuPipelineStage::Transfer, CgpuMemoryAccess::TransferWrite);
+      }
+    }
+  }
+
+  void _giRecordReadbacks(CgpuCommandBuffer commandBuffer, const std::vector<GiRenderBuffer*>& renderBuffers,
+                          uint32_t readbackIndex, uint64_t frameValue)
+  {
+    if (renderBuffers.empty())
+    {
+      return;
+    }
+
+    _giRecordPostProcess(commandBuffer, renderBuffers);
+
+    GbSmallVector<CgpuBufferMemoryBarrier, 5> preBarriers;
+    GbSmallVector<CgpuBufferMemoryBarrier, 5> postBarriers;
+
+    preBarriers.resize(renderBuffers.size());
+    postBarriers.resize(renderBuffers.size());
+
+    for (size_t i = 0; i < renderBuffers.size(); i++)
+    {
+      GiRenderBuffer* renderBuffer = renderBuffers[i];
+
+      preBarriers[i] = CgpuBufferMemoryBarrier {
+        .buffer = renderBuffer->deviceMem,
+        .srcStageMask = CgpuPipelineStage::RayTracingShader | CgpuPipelineStage::ComputeShader,
+        .srcAccessMask = CgpuMemoryAccess::ShaderWrite,
+        .dstStageMask = CgpuPipelineStage::Transfer,
+        .dstAccessMask = CgpuMemoryAccess::TransferRead
+      };
+
+      postBarriers[i] = CgpuBufferMemoryBarrier {
+        .buffer = renderBuffer->readbackBuffers[readbackIndex].buffer,
+        .srcStageMask = CgpuPipelineStage::Transfer,
+        .srcAccessMask = CgpuMemoryAccess::TransferWrite,
+        .dstStageMask = CgpuPipelineStage::Host,
+        .dstAccessMask = CgpuMemoryAccess::HostRead
+      };
+    }
+
+    CgpuPipelineBarrier preBarrier = {
+      .bufferBarrierCount = (uint32_t) preBarriers.size(),
+      .bufferBarriers = preBarriers.data()
+    };
+
+    cgpuCmdPipelineBarrier(commandBuffer, &preBarrier);
+
+    for (GiRenderBuffer* renderBuffer : renderBuffers)
+    {
+      GiReadbackBuffer& readbackBuffer = renderBuffer->readbackBuffers[readbackIndex];
+
+      cgpuCmdCopyBuffer(commandBuffer, renderBuffer->deviceMem, 0, readbackBuffer.buffer);
+
+      readbackBuffer.frame = frameValue;
+    }
+
+    CgpuPipelineBarrier postBarrier = {
+      .bufferBarrierCount = (uint32_t) postBarriers.size(),
+      .bufferBarriers = postBarriers.data()
+    };
+
+    cgpuCmdPipelineBarrier(commandBuffer, &postBarrier);
   }
 
-  void _EncodeRenderBufferAsHeatmap(GiRenderBuffer* renderBuffer)
+  // Reads back the current contents of a render buffer that the last frames skipped.
+  GiReadbackBuffer* _giReadbackRenderBuffer(GiRenderBuffer* renderBuffer)
   {
-    int channelCount = renderBuffer->width * renderBuffer->height * 4;
-    float* rgbaImg = (float*) renderBuffer->mappedHostMem;
+    // Frees all readback buffers.
+    if (!_giWaitForFrames())
+    {
+      return nullptr;
+    }
 
-    float maxValue = 0.0f;
-    for (int i = 0; i < channelCount; i += 4) {
-      maxValue = std::max(maxValue, rgbaImg[i]); // only consider first channel
+    uint64_t frameValue = s_frameCounter + 1;
+    uint32_t readbackIndex = uint32_t(frameValue % s_frames.size());
+
+    if (!cgpuBeginCommandBuffer(s_readbackCommandBuffer))
+    {
+      return nullptr;
     }
-    for (int i = 0; i < channelCount && maxValue > 0.0f; i += 4) {
-      int valIndex = std::min(int((rgbaImg[i] / maxValue) * 255.0), 255);
-      rgbaImg[i + 0] = (float) TURBO_SRGB_FLOATS[valIndex][0];
-      rgbaImg[i + 1] = (float) TURBO_SRGB_FLOATS[valIndex][1];
-      rgbaImg[i + 2] = (float) TURBO_SRGB_FLOATS[valIndex][2];
-      rgbaImg[i + 3] = 255;
+
+    _giRecordReadbacks(s_readbackCommandBuffer, { renderBuffer }, readbackIndex, frameValue);
+
+    cgpuEndCommandBuffer(s_readbackCommandBuffer);
+
+    CgpuSignalSemaphoreInfo signalSemaphoreInfo = { .semaphore = s_frameSemaphore, .value = frameValue };
+    cgpuSubmitCommandBuffer(s_device, s_readbackCommandBuffer, 1, &signalSemaphoreInfo);
+
+    s_frameCounter = frameValue;
+
+    if (!_giWaitForFrame(frameValue))
+    {
+      return nullptr;
     }
+
+    return &renderBuffer->readbackBuffers[readbackIndex];
   }
 
   // IMPORTANT: this needs to match the rp_main* shaders. It is asserted in cgpu.
@@ -351,7 +747,7 @@ namespace gtl
   // IMPORTANT: this needs to match the rp_main* shaders. It is asserted in cgpu.
   uint32_t _GetRpMainMaxRayPayloadSize(uint32_t mediumStackSize)
   {
-    uint32_t size = 80;
+    uint32_t size = 88;
     if (mediumStackSize > 0)
     {
       size += mediumStackSize * 40 + 12;
@@ -383,7 +779,7 @@ namespace gtl
 
     s_cgpuInitialized = true;
 
-    if (!cgpuCreateDevice(&s_device))
+    if (!cgpuCreateDevice(&s_device, { .pipelineCacheDir = params.pipelineCacheDir.c_str() }))
       goto fail;
 
     cgpuGetDeviceFeatures(s_device, s_deviceFeatures);
@@ -392,7 +788,8 @@ namespace gtl
     if (!cgpuCreateSampler(s_device, {
                             .addressModeU = CgpuSamplerAddressMode::Repeat,
                             .addressModeV = CgpuSamplerAddressMode::Repeat,
-                            .addressModeW = CgpuSamplerAddressMode::Repeat
+                            .addressModeW = CgpuSamplerAddressMode::Repeat,
+                            .maxAnisotropy = 16.0f
                           }, &s_texSampler))
     {
       goto fail;
@@ -406,6 +803,37 @@ namespace gtl
 
     s_delayedResourceDestroyer = std::make_unique<GgpuDelayedResourceDestroyer>(s_device);
 
+    if (!cgpuCreateSemaphore(s_device, &s_frameSemaphore))
+    {
+      goto fail;
+    }
+
+    if (!cgpuCreateCommandBuffer(s_device, &s_readbackCommandBuffer))
+    {
+      goto fail;
+    }
+
+    s_frames.resize(std::clamp(params.framesInFlight, 1u, GI_MAX_FRAMES_IN_FLIGHT));
+    for (GiFrame& frame : s_frames)
+    {
+      if (!cgpuCreateCommandBuffer(s_device, &frame.commandBuffer))
+      {
+        goto fail;
+      }
+
+      if (!cgpuCreateBuffer(s_device, {
+                              .usage = CgpuBufferUsage::TransferDst,
+                              .memoryProperties = CgpuMemoryProperties::HostVisible | CgpuMemoryProperties::HostCached,
+                              .size = sizeof(uint64_t) * 2,
+                              .debugName = "FrameTimestamps"
+                            }, &frame.timestampBuffer))
+      {
+        goto fail;
+      }
+
+      cgpuMapBuffer(s_device, frame.timestampBuffer, &frame.timestamps);
+    }
+
     s_mcRuntime = std::unique_ptr<McRuntime>(McLoadRuntime(params.mdlRuntimePath, params.mdlSearchPaths));
     if (!s_mcRuntime)
     {
@@ -414,17 +842,74 @@ namespace gtl
 
     s_mcFrontend = std::make_unique<McFrontend>(mtlxStdLib, params.mtlxCustomNodesPath, *s_mcRuntime);
 
-    s_shaderGen = std::make_unique<GiGlslShaderGen>();
-    if (!s_shaderGen->init(shaderPath, *s_mcRuntime))
     {
-      goto fail;
+      std::string spvCacheDir;
+      if (!params.pipelineCacheDir.empty())
+      {
+        spvCacheDir = (fs::path(params.pipelineCacheDir) / "spirv").string();
+      }
+
+      s_shaderGen = std::make_unique<GiGlslShaderGen>();
+      if (!s_shaderGen->init(shaderPath, spvCacheDir, *s_mcRuntime))
+      {
+        goto fail;
+      }
+    }
+
+    {
+      std::vector<uint8_t> spv;
+      if (!s_shaderGen->generateComputeSpirv("pp_main.comp", spv))
+      {
+        goto fail;
+      }
+
+      if (!cgpuCreateShader(s_device, {
+                              .size = spv.size(),
+                              .source = spv.data(),
+                              .stageFlags = CgpuShaderStage::Compute,
+                              .debugName = "PostProcess"
+                            }, &s_postProcessShader))
+      {
+        goto fail;
+      }
+
+      cgpuCreateComputePipeline(s_device, {
+                                  .shader = s_postProcessShader,
+                                  .debugName = "PostProcess"
+                                }, &s_postProcessPipeline);
+
+      if (!cgpuCreateBuffer(s_device, {
+                              .usage = CgpuBufferUsage::ShaderDeviceAddress | CgpuBufferUsage::Storage | CgpuBufferUsage::TransferDst,
+                              .memoryProperties = CgpuMemoryProperties::DeviceLocal,
+                              .size = sizeof(uint32_t),
+                              .debugName = "PostProcessMaxValue"
+                            }, &s_postProcessMaxValue))
+      {
+        goto fail;
+      }
     }
 
     s_mmapAssetReader = std::make_unique<GiMmapAssetReader>();
     s_aggregateAssetReader = std::make_unique<GiAggregateAssetReader>();
     s_aggregateAssetReader->addAssetReader(s_mmapAssetReader.get());
 
-    s_texSys = std::make_unique<GiTextureManager>(s_device, *s_aggregateAssetReader, *s_stager, *s_delayedResourceDestroyer);
+    {
+      GiTextureCompression textureCompression = params.textureCompression;
+      if (textureCompression != GiTextureCompression::None && !s_deviceFeatures.textureCompressionBC)
+      {
+        GB_WARN("BC texture compression not supported by device; disabling");
+        textureCompression = GiTextureCompression::None;
+      }
+
+      fs::path textureCacheDir;
+      if (!params.pipelineCacheDir.empty())
+      {
+        textureCacheDir = fs::path(params.pipelineCacheDir) / "textures";
+      }
+
+      s_texSys = std::make_unique<GiTextureManager>(s_device, *s_aggregateAssetReader, *s_stager, *s_delayedResourceDestroyer,
+                                                    textureCompression, textureCacheDir, params.maxTextureResolution);
+    }
 
 #ifdef GI_SHADER_HOTLOADING
     s_fileWatcher = std::make_unique<efsw::FileWatcher>();
@@ -449,6 +934,35 @@ fail:
   #ifdef GI_SHADER_HOTLOADING
     s_fileWatcher.reset();
   #endif
+    if (s_frameSemaphore.handle)
+    {
+      _giWaitForFrames();
+    }
+    for (GiFrame& frame : s_frames)
+    {
+      if (frame.commandBuffer.handle)
+      {
+        cgpuDestroyCommandBuffer(s_device, frame.commandBuffer);
+      }
+      if (frame.timestampBuffer.handle)
+      {
+        cgpuUnmapBuffer(s_device, frame.timestampBuffer);
+        cgpuDestroyBuffer(s_device, frame.timestampBuffer);
+      }
+    }
+    s_frames.clear();
+    s_traceNsPerPixelSample = 0.0;
+    if (s_readbackCommandBuffer.handle)
+    {
+      cgpuDestroyCommandBuffer(s_device, s_readbackCommandBuffer);
+      s_readbackCommandBuffer = {};
+    }
+    if (s_frameSemaphore.handle)
+    {
+      cgpuDestroySemaphore(s_device, s_frameSemaphore);
+      s_frameSemaphore = {};
+    }
+    s_frameCounter = 0;
     s_aggregateAssetReader.reset();
     s_mmapAssetReader.reset();
     if (s_texSys)
@@ -456,6 +970,21 @@ fail:
       s_texSys->destroy();
       s_texSys.reset();
     }
+    if (s_postProcessPipeline.handle)
+    {
+      cgpuDestroyPipeline(s_device, s_postProcessPipeline);
+      s_postProcessPipeline = {};
+    }
+    if (s_postProcessShader.handle)
+    {
+      cgpuDestroyShader(s_device, s_postProcessShader);
+      s_postProcessShader = {};
+    }
+    if (s_postProcessMaxValue.handle)
+    {
+      cgpuDestroyBuffer(s_device, s_postProcessMaxValue);
+      s_postProcessMaxValue = {};
+    }
     s_shaderGen.reset();
     if (s_stager)
     {
@@ -636,30 +1165,40 @@ fail:
     return mesh;
   }
 
-  void giSetMeshTransform(GiMesh* mesh, const float* transform)
+  // Meshes that are already part of the TLAS only need their instances patched.
+  void _giMarkMeshTlasInstancesDirty(GiMesh* mesh, bool instanceCountChanged)
   {
-    mesh->transform = glm::mat3x4(glm::transpose(glm::make_mat4(transform)));
-
     GiScene* scene = mesh->scene;
+
+    std::lock_guard guard(scene->mutex);
+    if (mesh->tlasInstanceOffset == UINT32_MAX || instanceCountChanged)
     {
-      std::lock_guard guard(scene->mutex);
       scene->dirtyFlags |= GiSceneDirtyFlags::DirtyBvh;
+      return;
     }
+
+    scene->dirtyTlasMeshes.insert(mesh);
+    scene->dirtyFlags |= GiSceneDirtyFlags::DirtyTlasInstances;
+  }
+
+  void giSetMeshTransform(GiMesh* mesh, const float* transform)
+  {
+    mesh->transform = glm::mat3x4(glm::transpose(glm::make_mat4(transform)));
+
+    _giMarkMeshTlasInstancesDirty(mesh, false);
   }
 
   void giSetMeshInstanceTransforms(GiMesh* mesh, uint32_t count, const float (*transforms)[4][4])
   {
+    bool instanceCountChanged = (mesh->instanceTransforms.size() != count);
+
     mesh->instanceTransforms.resize(count);
     for (uint32_t i = 0; i < count; i++)
     {
       mesh->instanceTransforms[i] = glm::mat3x4(glm::transpose(glm::make_mat4((const float*) transforms[i])));
     }
 
-    GiScene* scene = mesh->scene;
-    {
-      std::lock_guard guard(scene->mutex);
-      scene->dirtyFlags |= GiSceneDirtyFlags::DirtyBvh;
-    }
+    _giMarkMeshTlasInstancesDirty(mesh, instanceCountChanged);
   }
 
   void giSetMeshInstanceIds(GiMesh* mesh, uint32_t count, int* ids)
@@ -678,9 +1217,14 @@ fail:
   {
     std::lock_guard guard(s_resourceDestroyerMutex); // Hydra sync is parallel
     s_delayedResourceDestroyer->enqueueDestruction(gpuData.blas, gpuData.payloadBuffer);
-  }
 
-  void giSetMeshInstancerPrimvars(GiMesh* mesh, const std::vector<GiPrimvarData>& instancerPrimvars)
+    if (gpuData.refitInfo.has_value())
+    {
+      s_delayedResourceDestroyer->enqueueDestruction(gpuData.refitInfo->vertexPosBuffer, gpuData.refitInfo->indexBuffer);
+    }
+  }
+
+  void giSetMeshInstancerPrimvars(GiMesh* mesh, const std::vector<GiPrimvarData>& instancerPrimvars)
   {
     mesh->instancerPrimvars = instancerPrimvars;
 
@@ -753,11 +1297,43 @@ fail:
   {
     mesh->visible = visible;
 
+    // Hidden meshes stay in the TLAS with an empty instance mask
+    _giMarkMeshTlasInstancesDirty(mesh, false);
+  }
+
+  bool giUpdateMeshVertices(GiMesh* mesh, const std::vector<GiVertex>& vertices)
+  {
+    if (!giUpdateMeshDataVertices(mesh->cpuData, vertices))
+    {
+      return false; // topology changed
+    }
+
+    // The BLAS of a mesh seen deforming for the first time lacks update support; rebuild it once
+    auto& gpuData = mesh->gpuData;
+    bool canRefit = gpuData.has_value() && gpuData->refitInfo.has_value();
+
+    if (!canRefit && gpuData.has_value())
+    {
+      giDestroyMeshGpuData(*gpuData);
+      gpuData.reset();
+    }
+
+    mesh->isDeforming = true;
+
     GiScene* scene = mesh->scene;
     {
       std::lock_guard guard(scene->mutex);
-      scene->dirtyFlags |= GiSceneDirtyFlags::DirtyBvh;
+      if (canRefit)
+      {
+        scene->deformedMeshes.insert(mesh);
+        scene->dirtyFlags |= GiSceneDirtyFlags::DirtyBlasVertices;
+      }
+      else
+      {
+        scene->dirtyFlags |= GiSceneDirtyFlags::DirtyBvh;
+      }
     }
+    return true;
   }
 
   void giDestroyMesh(GiMesh* mesh)
@@ -774,30 +1350,412 @@ fail:
     {
       std::lock_guard guard(scene->mutex);
       scene->meshes.erase(mesh);
+      scene->dirtyTlasMeshes.erase(mesh);
+      scene->deformedMeshes.erase(mesh);
       scene->dirtyFlags |= GiSceneDirtyFlags::DirtyBvh;
     }
     delete mesh;
   }
 
+  // CPU-side BLAS payload, laid out exactly like the GPU payload buffer.
+  struct GiMeshPayload
+  {
+    std::vector<uint8_t> blob;
+    std::vector<float> positions;
+    uint64_t indexBufferOffset;
+    uint64_t vertexBufferOffset;
+    uint32_t triangleCount;
+  };
+
+  struct GiBlasBuild
+  {
+    GiMesh* mesh;
+    uint64_t vertexBufferOffset;
+    CgpuBuffer payloadBuffer;
+    CgpuBuffer tmpPositionBuffer;
+    CgpuBuffer tmpIndexBuffer;
+    rp::BlasPayload payload;
+    CgpuBlasCreateInfo blasCreateInfo;
+  };
+
+  void _giEncodeMeshVertices(const std::vector<GiVertex>& vertices, uint8_t* fvertices, float* positions)
+  {
+    for (uint32_t i = 0; i < vertices.size(); i++)
+    {
+      const GiVertex& cpuVert = vertices[i];
+      uint32_t encodedNormal = _EncodeDirection(glm::make_vec3(cpuVert.norm));
+      uint32_t encodedTangent = _EncodeDirection(glm::make_vec3(cpuVert.tangent));
+
+      rp::FVertex vertex{
+        .field1 = { glm::make_vec3(cpuVert.pos), cpuVert.bitangentSign },
+        .field2 = { *((float*) &encodedNormal), *((float*) &encodedTangent), cpuVert.u, cpuVert.v }
+      };
+      memcpy(&fvertices[i * sizeof(rp::FVertex)], &vertex, sizeof(rp::FVertex));
+
+      positions[i * 3 + 0] = cpuVert.pos[0];
+      positions[i * 3 + 1] = cpuVert.pos[1];
+      positions[i * 3 + 2] = cpuVert.pos[2];
+    }
+  }
+
+  // Decompresses the mesh data and encodes it into a ready-to-upload payload blob.
+  // Does not touch GPU state and can therefore be invoked concurrently.
+  bool _giPrepareMeshPayload(const GiMesh* mesh, const GiMaterial* material, GiMeshPayload& payload)
+  {
+    std::vector<GiFace> meshFaces;
+    std::vector<int> meshFaceIds;
+    std::vector<GiVertex> meshVertices;
+    std::vector<GiPrimvarData> meshPrimvars;
+    giDecompressMeshData(mesh->cpuData, meshFaces, meshFaceIds, meshVertices, meshPrimvars);
+
+    if (meshFaces.empty())
+    {
+      return false;
+    }
+
+    uint64_t indicesSize = meshFaces.size() * sizeof(uint32_t) * 3;
+    uint64_t verticesSize = meshVertices.size() * sizeof(rp::FVertex);
+
+    uint32_t faceIdStride = mesh->maxFaceId <= UINT8_MAX ? 1 : (mesh->maxFaceId <= UINT16_MAX ? 2 : 4);
+    uint64_t faceIdsSize = (meshFaceIds.size() * faceIdStride + 3) / 4 * 4; // align buffer size to 4 bytes
+
+    // Prepare scene data & preamble
+    std::vector<const GiPrimvarData*> primvars;
+    if (material)
+    {
+      const std::vector<const char*> sceneDataNames = material->mcMat->sceneDataNames;
+
+      size_t sceneDataCount = sceneDataNames.size();
+      int overflowCount = int(sceneDataCount) - int(rp::MAX_SCENE_DATA_COUNT);
+
+      if (overflowCount > 0)
+      {
+          GB_ERROR("max scene data count exceeded for {}; ignoring {} scene data", mesh->name, overflowCount);
+          sceneDataCount = rp::MAX_SCENE_DATA_COUNT;
+      }
+
+      primvars.resize(sceneDataCount, nullptr);
+
+      if (sceneDataCount > 0)
+      {
+        GB_DEBUG("scene data for mesh {} with material {}:", mesh->name, material->name);
+      }
+      for (size_t i = 0; i < sceneDataCount; i++)
+      {
+        const char* sceneDataName = sceneDataNames[i];
+
+        // FIXME: we should check if scene data and primvar types match to prevent crashes
+        const GiPrimvarData* primvar = nullptr;
+        for (const GiPrimvarData& p : mesh->instancerPrimvars)
+        {
+          if (p.name == sceneDataName && !p.data.empty())
+          {
+            primvar = &p;
+            break;
+          }
+        }
+        for (const GiPrimvarData& p : meshPrimvars) // override instancer primvars
+        {
+          if (p.name == sceneDataName && !p.data.empty())
+          {
+            primvar = &p;
+            break;
+          }
+        }
+
+        if (!primvar)
+        {
+          GB_DEBUG("> [{}] {} (not found!)", i, sceneDataName);
+          continue;
+        }
+
+        GB_DEBUG("> [{}] {}", i, sceneDataName);
+        primvars[i] = primvar;
+      }
+    }
+
+    uint64_t preambleSize = sizeof(rp::BlasPayloadBufferPreamble);
+
+    uint64_t payloadBufferSize = preambleSize;
+    uint64_t indexBufferOffset = giAlignBuffer(sizeof(rp::FVertex), indicesSize, &payloadBufferSize);
+    uint64_t vertexBufferOffset = giAlignBuffer(sizeof(rp::FVertex), verticesSize, &payloadBufferSize);
+    uint64_t faceIdsBufferOffset = giAlignBuffer(sizeof(int), faceIdsSize, &payloadBufferSize);
+
+    rp::BlasPayloadBufferPreamble preamble
+    {
+      .objectId = mesh->id,
+      .faceIdsInfo = (faceIdStride << rp::FACE_ID_STRIDE_OFFSET) | uint32_t(faceIdsBufferOffset)
+    };
+
+    std::vector<uint32_t> sceneDataOffsets(primvars.size());
+    for (size_t i = 0; i < primvars.size(); i++)
+    {
+      const GiPrimvarData* primvar = primvars[i];
+
+      if (!primvar)
+      {
+        preamble.sceneDataInfos[i] = rp::SCENE_DATA_INVALID;
+        continue;
+      }
+
+      uint64_t newPayloadBufferSize = payloadBufferSize;
+      uint64_t sceneDataOffset = giAlignBuffer(rp::SCENE_DATA_ALIGNMENT, primvar->data.size(), &newPayloadBufferSize);
+
+      if (sceneDataOffset >= UINT32_MAX)
+      {
+        GB_ERROR("scene data too large");
+        preamble.sceneDataInfos[i] = rp::SCENE_DATA_INVALID;
+        continue;
+      }
+
+      if ((sceneDataOffset & rp::SCENE_DATA_OFFSET_MASK) != sceneDataOffset || sceneDataOffset == rp::SCENE_DATA_OFFSET_MASK)
+      {
+        GB_ERROR("max scene data offset exceeded");
+        preamble.sceneDataInfos[i] = rp::SCENE_DATA_INVALID;
+        continue;
+      }
+
+      payloadBufferSize = newPayloadBufferSize;
+      sceneDataOffsets[i] = uint32_t(sceneDataOffset);
+
+      uint32_t stride = 0;
+      switch (primvar->type)
+      {
+      case GiPrimvarType::Float:
+      case GiPrimvarType::Int:
+        stride = 1;
+        break;
+      case GiPrimvarType::Int2:
+      case GiPrimvarType::Vec2:
+        stride = 2;
+        break;
+      case GiPrimvarType::Int3:
+      case GiPrimvarType::Vec3:
+        stride = 3;
+        break;
+      case GiPrimvarType::Int4:
+      case GiPrimvarType::Vec4:
+        stride = 4;
+        break;
+      default:
+        assert(false);
+        GB_ERROR("coding error: unhandled type size!");
+        continue;
+      }
+      stride -= 1; // [0, 3] range -> 2 bit
+
+      assert(stride < 4);
+      static_assert(int(GiPrimvarInterpolation::COUNT) <= 4, "Enum exceeds 2 bits");
+
+      uint32_t info = ((uint32_t(sceneDataOffset) / rp::SCENE_DATA_ALIGNMENT) & rp::SCENE_DATA_OFFSET_MASK) |
+                      (stride << rp::SCENE_DATA_STRIDE_OFFSET) |
+                      (uint32_t(primvar->interpolation) << rp::SCENE_DATA_INTERPOLATION_OFFSET);
+      preamble.sceneDataInfos[i] = info;
+    }
+
+    std::vector<uint8_t>& blob = payload.blob;
+    blob.resize(payloadBufferSize);
+
+    memcpy(&blob[0], &preamble, preambleSize);
+
+    // Collect indices
+    static_assert(sizeof(GiFace) == sizeof(uint32_t) * 3);
+    memcpy(&blob[indexBufferOffset], meshFaces.data(), indicesSize);
+
+    // Collect vertices
+    payload.positions.resize(meshVertices.size() * 3);
+    _giEncodeMeshVertices(meshVertices, &blob[vertexBufferOffset], payload.positions.data());
+
+    // Collect face IDs
+    for (size_t i = 0; i < meshFaceIds.size(); i++)
+    {
+      memcpy(&blob[faceIdsBufferOffset + i * faceIdStride], &meshFaceIds[i], faceIdStride);
+    }
+
+    // Collect scene data
+    for (size_t i = 0; i < primvars.size(); i++)
+    {
+      if (preamble.sceneDataInfos[i] == rp::SCENE_DATA_INVALID)
+      {
+        continue;
+      }
+
+      const std::vector<uint8_t>& data = primvars[i]->data;
+      memcpy(&blob[sceneDataOffsets[i]], data.data(), data.size());
+    }
+
+    payload.indexBufferOffset = indexBufferOffset;
+    payload.vertexBufferOffset = vertexBufferOffset;
+    payload.triangleCount = uint32_t(meshFaces.size());
+
+    return true;
+  }
+
+  // Creates and stages the payload buffer and the temporary BLAS build inputs of a mesh.
+  bool _giUploadMeshPayload(GiMesh* mesh, const GiMaterial* material, const GiMeshPayload& meshPayload, bool compactBlas, GiBlasBuild& build)
+  {
+    CgpuBuffer tmpPositionBuffer;
+    CgpuBuffer tmpIndexBuffer;
+    CgpuBuffer payloadBuffer;
+    rp::BlasPayload payload;
+
+    uint64_t tmpIndexBufferSize = meshPayload.triangleCount * sizeof(uint32_t) * 3;
+    uint64_t tmpPositionBufferSize = meshPayload.positions.size() * sizeof(float);
+
+    // Create data buffers
+    if (!cgpuCreateBuffer(s_device, {
+                            .usage = CgpuBufferUsage::ShaderDeviceAddress | CgpuBufferUsage::TransferDst,
+                            .memoryProperties = CgpuMemoryProperties::DeviceLocal,
+                            .size = meshPayload.blob.size(),
+                            .debugName = "BlasPayloadBuffer"
+                          }, &payloadBuffer))
+    {
+      GB_ERROR("failed to allocate BLAS payload buffer memory");
+      goto fail_cleanup;
+    }
+
+    if (!cgpuCreateBuffer(s_device, {
+                            .usage = CgpuBufferUsage::ShaderDeviceAddress | CgpuBufferUsage::AccelerationStructureBuild,
+                            .memoryProperties = CgpuMemoryProperties::HostVisible | CgpuMemoryProperties::HostCached,
+                            .size = tmpPositionBufferSize,
+                            .debugName = "BlasVertexPositionsTmp"
+                          }, &tmpPositionBuffer))
+    {
+      GB_ERROR("failed to allocate BLAS temp vertex position memory");
+      goto fail_cleanup;
+    }
+
+    if (!cgpuCreateBuffer(s_device, {
+                            .usage = CgpuBufferUsage::ShaderDeviceAddress | CgpuBufferUsage::AccelerationStructureBuild,
+                            .memoryProperties = CgpuMemoryProperties::HostVisible | CgpuMemoryProperties::HostCached,
+                            .size = tmpIndexBufferSize,
+                            .debugName = "BlasIndicesTmp"
+                          }, &tmpIndexBuffer))
+    {
+      GB_ERROR("failed to allocate BLAS temp indices memory");
+      goto fail_cleanup;
+    }
+
+    // Copy data to GPU
+    {
+      void* mappedMem;
+
+      cgpuMapBuffer(s_device, tmpPositionBuffer, &mappedMem);
+      memcpy(mappedMem, meshPayload.positions.data(), tmpPositionBufferSize);
+      cgpuUnmapBuffer(s_device, tmpPositionBuffer);
+
+      cgpuMapBuffer(s_device, tmpIndexBuffer, &mappedMem);
+      memcpy(mappedMem, &meshPayload.blob[meshPayload.indexBufferOffset], tmpIndexBufferSize);
+      cgpuUnmapBuffer(s_device, tmpIndexBuffer);
+    }
+
+    if (!s_stager->stageToBuffer(meshPayload.blob.data(), meshPayload.blob.size(), payloadBuffer))
+    {
+      GB_ERROR("failed to stage BLAS data");
+      goto fail_cleanup;
+    }
+
+    // Fill BLAS payload data
+    {
+      uint64_t payloadBufferAddress = cgpuGetBufferAddress(s_device, payloadBuffer);
+      if (payloadBufferAddress == 0)
+      {
+        GB_ERROR("failed to get index-vertex buffer address");
+        goto fail_cleanup;
+      }
+
+      uint32_t bitfield = 0;
+      if (mesh->flipFacing)
+      {
+        bitfield |= rp::BLAS_PAYLOAD_BITFLAG_FLIP_FACING;
+      }
+      if (mesh->doubleSided)
+      {
+        bitfield |= rp::BLAS_PAYLOAD_BITFLAG_DOUBLE_SIDED;
+      }
+
+      uint64_t vertexBufferSize = (meshPayload.vertexBufferOffset/* account for align */ - meshPayload.indexBufferOffset/* account for preamble */);
+      payload = rp::BlasPayload{
+        .bufferAddress = payloadBufferAddress,
+        .vertexOffset = uint32_t(vertexBufferSize / sizeof(rp::FVertex)), // offset to skip index buffer
+        .bitfield = bitfield
+      };
+    }
+
+    build = GiBlasBuild{
+      .mesh = mesh,
+      .vertexBufferOffset = meshPayload.vertexBufferOffset,
+      .payloadBuffer = payloadBuffer,
+      .tmpPositionBuffer = tmpPositionBuffer,
+      .tmpIndexBuffer = tmpIndexBuffer,
+      .payload = payload,
+      .blasCreateInfo = {
+        .vertexPosBuffer = tmpPositionBuffer,
+        .indexBuffer = tmpIndexBuffer,
+        .maxVertex = (uint32_t) meshPayload.positions.size(),
+        .triangleCount = meshPayload.triangleCount,
+        .isOpaque = !material->mcMat->hasCutoutTransparency,
+        .allowCompaction = compactBlas && !mesh->isDeforming,
+        .allowUpdate = mesh->isDeforming,
+        .debugName = mesh->name.c_str()
+      }
+    };
+
+    return true;
+
+fail_cleanup:
+    if (payloadBuffer.handle)
+      cgpuDestroyBuffer(s_device, payloadBuffer);
+    if (tmpPositionBuffer.handle)
+      cgpuDestroyBuffer(s_device, tmpPositionBuffer);
+    if (tmpIndexBuffer.handle)
+      cgpuDestroyBuffer(s_device, tmpIndexBuffer);
+
+    return false;
+  }
+
+  void _giGetMeshInstanceTransform(const GiMesh* mesh, size_t instanceIndex, float (&out)[3][4])
+  {
+    glm::mat3x4 transform = glm::mat3x4(glm::mat4(mesh->transform) * glm::mat4(mesh->instanceTransforms[instanceIndex]));
+
+    memcpy(out, glm::value_ptr(transform), sizeof(float) * 12);
+  }
+
+  uint8_t _giGetMeshInstanceMask(const GiMesh* mesh)
+  {
+    return mesh->visible ? 0xFF : 0x00;
+  }
+
   void _giBuildGeometryStructures(GiScene* scene,
                                   const GiShaderCache* shaderCache,
                                   std::vector<CgpuBlasInstance>& blasInstances,
                                   std::vector<rp::BlasPayload>& blasPayloads,
                                   std::vector<int>& instanceIds,
+                                  bool compactBlases,
                                   uint64_t& totalIndicesSize,
-                                  uint64_t& totalVerticesSize)
+                                  uint64_t& totalVerticesSize,
+                                  uint64_t& builtBlasesSize,
+                                  uint64_t& compactedBlasesSize)
   {
     size_t meshCount = scene->meshes.size();
     blasInstances.reserve(meshCount);
     blasPayloads.reserve(meshCount);
     instanceIds.reserve(meshCount);
 
+    std::vector<std::pair<GiMesh*, uint32_t/*material index*/>> tlasMeshes;
+    tlasMeshes.reserve(meshCount);
+
+    std::vector<GiMesh*> dirtyMeshes;
+
     for (auto it = scene->meshes.begin(); it != scene->meshes.end(); ++it)
     {
       GiMesh* mesh = *it;
 
-      // Don't build BLAS/TLAS for non-visible geometry
-      if (!mesh->visible)
+      mesh->tlasInstanceOffset = UINT32_MAX;
+
+      // Don't build BLAS for non-visible geometry. Hidden meshes that already have one are
+      // kept in the TLAS with an empty mask, so that toggling visibility only requires a refit.
+      if (!mesh->visible && !mesh->gpuData.has_value())
       {
         continue;
       }
@@ -820,382 +1778,179 @@ fail:
           continue;
       }
 
+      tlasMeshes.push_back({ mesh, materialIndex });
+
       // Build mesh BLAS & buffers if they don't exist yet
       if (!mesh->gpuData.has_value())
       {
-        std::vector<GiFace> meshFaces;
-        std::vector<int> meshFaceIds;
-        std::vector<GiVertex> meshVertices;
-        std::vector<GiPrimvarData> meshPrimvars;
-        giDecompressMeshData(mesh->cpuData, meshFaces, meshFaceIds, meshVertices, meshPrimvars);
-
-        if (meshFaces.empty())
-        {
-          continue;
-        }
-
-        // Collect vertices
-        std::vector<rp::FVertex> vertexData;
-        std::vector<float> positionData;
-        vertexData.resize(meshVertices.size());
-        positionData.resize(meshVertices.size() * 3);
-
-        for (uint32_t i = 0; i < meshVertices.size(); i++)
-        {
-          const GiVertex& cpuVert = meshVertices[i];
-          uint32_t encodedNormal = _EncodeDirection(glm::make_vec3(cpuVert.norm));
-          uint32_t encodedTangent = _EncodeDirection(glm::make_vec3(cpuVert.tangent));
-
-          vertexData[i] = rp::FVertex{
-            .field1 = { glm::make_vec3(cpuVert.pos), cpuVert.bitangentSign },
-            .field2 = { *((float*) &encodedNormal), *((float*) &encodedTangent), cpuVert.u, cpuVert.v }
-          };
+        dirtyMeshes.push_back(mesh);
+      }
+    }
 
-          positionData[i * 3 + 0] = cpuVert.pos[0];
-          positionData[i * 3 + 1] = cpuVert.pos[1];
-          positionData[i * 3 + 2] = cpuVert.pos[2];
-        }
+    // Prepare payloads in parallel and upload them in windows, which bounds the host memory
+    // held by uncompressed payloads to a few meshes per thread
+    size_t windowSize = std::max(std::thread::hardware_concurrency(), 1u) * GI_MESH_PAYLOAD_WINDOW_SIZE_PER_THREAD;
 
-        uint64_t verticesSize = vertexData.size() * sizeof(rp::FVertex);
+    std::vector<GiMeshPayload> meshPayloads(std::min(windowSize, dirtyMeshes.size()));
+    std::vector<uint8_t> meshPayloadsValid(meshPayloads.size(), 0);
 
-        // Collect indices
-        std::vector<uint32_t> indexData;
-        indexData.reserve(meshFaces.size() * 3);
+    std::vector<GiBlasBuild> blasBuilds;
+    blasBuilds.reserve(dirtyMeshes.size());
 
-        for (uint32_t i = 0; i < meshFaces.size(); i++)
-        {
-          const auto* face = &meshFaces[i];
-          indexData.push_back(face->v_i[0]);
-          indexData.push_back(face->v_i[1]);
-          indexData.push_back(face->v_i[2]);
-        }
+    for (size_t windowStart = 0; windowStart < dirtyMeshes.size(); windowStart += windowSize)
+    {
+      size_t windowMeshCount = std::min(windowSize, dirtyMeshes.size() - windowStart);
 
-        uint64_t indicesSize = indexData.size() * sizeof(uint32_t);
+#pragma omp parallel for schedule(dynamic)
+      for (int i = 0; i < int(windowMeshCount); i++)
+      {
+        const GiMesh* mesh = dirtyMeshes[windowStart + i];
 
-        // Collect face IDs
-        uint32_t faceIdStride = mesh->maxFaceId <= UINT8_MAX ? 1 : (mesh->maxFaceId <= UINT16_MAX ? 2 : 4);
-        uint64_t faceIdsSize = (meshFaceIds.size() * faceIdStride + 3) / 4 * 4; // align buffer size to 4 bytes
+        meshPayloadsValid[i] = _giPrepareMeshPayload(mesh, mesh->material, meshPayloads[i]);
+      }
 
-        std::vector<uint8_t> faceIdData(faceIdsSize);
-        for (size_t i = 0; i < meshFaceIds.size(); i++)
-        {
-          memcpy(&faceIdData[i * faceIdStride], &meshFaceIds[i], faceIdStride);
-        }
+      // Upload payloads & BLAS build inputs
+      for (size_t i = 0; i < windowMeshCount; i++)
+      {
+        GiMesh* mesh = dirtyMeshes[windowStart + i];
 
-        // Prepare scene data & preamble
-        std::vector<const GiPrimvarData*> primvars;
-        if (material)
+        if (meshPayloadsValid[i])
         {
-          const std::vector<const char*> sceneDataNames = material->mcMat->sceneDataNames;
-
-          size_t sceneDataCount = sceneDataNames.size();
-          int overflowCount = int(sceneDataCount) - int(rp::MAX_SCENE_DATA_COUNT);
-
-          if (overflowCount > 0)
+          GiBlasBuild build;
+          if (_giUploadMeshPayload(mesh, mesh->material, meshPayloads[i], compactBlases, build))
           {
-              GB_ERROR("max scene data count exceeded for {}; ignoring {} scene data", mesh->name, overflowCount);
-              sceneDataCount = rp::MAX_SCENE_DATA_COUNT;
+            blasBuilds.push_back(build);
           }
+        }
 
-          primvars.resize(sceneDataCount, nullptr);
-
-          if (sceneDataCount > 0)
-          {
-            GB_DEBUG("scene data for mesh {} with material {}:", mesh->name, material->name);
-          }
-          for (size_t i = 0; i < sceneDataCount; i++)
-          {
-            const char* sceneDataName = sceneDataNames[i];
-
-            // FIXME: we should check if scene data and primvar types match to prevent crashes
-            const GiPrimvarData* primvar = nullptr;
-            for (const GiPrimvarData& p : mesh->instancerPrimvars)
-            {
-              if (p.name == sceneDataName && !p.data.empty())
-              {
-                primvar = &p;
-                break;
-              }
-            }
-            for (const GiPrimvarData& p : meshPrimvars) // override instancer primvars
-            {
-              if (p.name == sceneDataName && !p.data.empty())
-              {
-                primvar = &p;
-                break;
-              }
-            }
-
-            if (!primvar)
-            {
-              GB_DEBUG("> [{}] {} (not found!)", i, sceneDataName);
-              continue;
-            }
+        meshPayloads[i] = {}; // free memory
+      }
+    }
 
-            GB_DEBUG("> [{}] {}", i, sceneDataName);
-            primvars[i] = primvar;
-          }
-        }
+    s_stager->flush();
 
-        uint64_t preambleSize = sizeof(rp::BlasPayloadBufferPreamble);
+    // Build all new BLASes in a single batch
+    if (!blasBuilds.empty())
+    {
+      std::vector<CgpuBlasCreateInfo> blasCreateInfos;
+      blasCreateInfos.reserve(blasBuilds.size());
+      for (const GiBlasBuild& build : blasBuilds)
+      {
+        blasCreateInfos.push_back(build.blasCreateInfo);
+      }
 
-        uint64_t payloadBufferSize = preambleSize;
-        uint64_t indexBufferOffset = giAlignBuffer(sizeof(rp::FVertex), indicesSize, &payloadBufferSize);
-        uint64_t vertexBufferOffset = giAlignBuffer(sizeof(rp::FVertex), verticesSize, &payloadBufferSize);
-        uint64_t faceIdsBufferOffset = giAlignBuffer(sizeof(int), faceIdsSize, &payloadBufferSize);
+      std::vector<CgpuBlas> blases(blasBuilds.size());
+      bool blasesCreated = cgpuCreateBlases(s_device, (uint32_t) blasCreateInfos.size(), blasCreateInfos.data(), blases.data());
 
-        rp::BlasPayloadBufferPreamble preamble
+      if (!blasesCreated)
+      {
+        GB_ERROR("failed to build BLASes");
+      }
+      else
+      {
+        for (CgpuBlas blas : blases)
         {
-          .objectId = mesh->id,
-          .faceIdsInfo = (faceIdStride << rp::FACE_ID_STRIDE_OFFSET) | uint32_t(faceIdsBufferOffset)
-        };
+          builtBlasesSize += cgpuGetBlasSize(s_device, blas);
+        }
+      }
 
-        std::vector<uint32_t> sceneDataOffsets(primvars.size());
-        for (size_t i = 0; i < primvars.size(); i++)
+      if (blasesCreated && compactBlases)
+      {
+        // BLASes of deforming meshes are refitted and therefore not compacted
+        std::vector<uint32_t> compactIndices;
+        std::vector<CgpuBlas> srcBlases;
+        for (uint32_t i = 0; i < blasCreateInfos.size(); i++)
         {
-          const GiPrimvarData* primvar = primvars[i];
-
-          if (!primvar)
+          if (blasCreateInfos[i].allowCompaction)
           {
-            preamble.sceneDataInfos[i] = rp::SCENE_DATA_INVALID;
-            continue;
+            compactIndices.push_back(i);
+            srcBlases.push_back(blases[i]);
           }
+        }
 
-          uint64_t newPayloadBufferSize = payloadBufferSize;
-          uint64_t sceneDataOffset = giAlignBuffer(rp::SCENE_DATA_ALIGNMENT, primvar->data.size(), &newPayloadBufferSize);
+        std::vector<CgpuBlas> compactedBlases(srcBlases.size());
 
-          if (sceneDataOffset >= UINT32_MAX)
-          {
-            GB_ERROR("scene data too large");
-            preamble.sceneDataInfos[i] = rp::SCENE_DATA_INVALID;
-            continue;
-          }
-
-          if ((sceneDataOffset & rp::SCENE_DATA_OFFSET_MASK) != sceneDataOffset || sceneDataOffset == rp::SCENE_DATA_OFFSET_MASK)
+        if (cgpuCompactBlases(s_device, (uint32_t) srcBlases.size(), srcBlases.data(), compactedBlases.data()))
+        {
           {
-            GB_ERROR("max scene data offset exceeded");
-            preamble.sceneDataInfos[i] = rp::SCENE_DATA_INVALID;
-            continue;
+            std::lock_guard guard(s_resourceDestroyerMutex);
+            for (CgpuBlas blas : srcBlases)
+            {
+              s_delayedResourceDestroyer->enqueueDestruction(blas);
+            }
           }
 
-          payloadBufferSize = newPayloadBufferSize;
-          sceneDataOffsets[i] = uint32_t(sceneDataOffset);
-
-          uint32_t stride = 0;
-          switch (primvar->type)
+          for (size_t i = 0; i < compactIndices.size(); i++)
           {
-          case GiPrimvarType::Float:
-          case GiPrimvarType::Int:
-            stride = 1;
-            break;
-          case GiPrimvarType::Int2:
-          case GiPrimvarType::Vec2:
-            stride = 2;
-            break;
-          case GiPrimvarType::Int3:
-          case GiPrimvarType::Vec3:
-            stride = 3;
-            break;
-          case GiPrimvarType::Int4:
-          case GiPrimvarType::Vec4:
-            stride = 4;
-            break;
-          default:
-            assert(false);
-            GB_ERROR("coding error: unhandled type size!");
-            continue;
+            blases[compactIndices[i]] = compactedBlases[i];
           }
-          stride -= 1; // [0, 3] range -> 2 bit
-
-          assert(stride < 4);
-          static_assert(int(GiPrimvarInterpolation::COUNT) <= 4, "Enum exceeds 2 bits");
-
-          uint32_t info = ((uint32_t(sceneDataOffset) / rp::SCENE_DATA_ALIGNMENT) & rp::SCENE_DATA_OFFSET_MASK) |
-                          (stride << rp::SCENE_DATA_STRIDE_OFFSET) |
-                          (uint32_t(primvar->interpolation) << rp::SCENE_DATA_INTERPOLATION_OFFSET);
-          preamble.sceneDataInfos[i] = info;
-        }
-
-        // Upload GPU data
-        CgpuBlas blas;
-        CgpuBuffer tmpPositionBuffer;
-        CgpuBuffer tmpIndexBuffer;
-        CgpuBuffer payloadBuffer;
-        rp::BlasPayload payload;
-
-        uint64_t tmpIndexBufferSize = indicesSize;
-        uint64_t tmpPositionBufferSize = positionData.size() * sizeof(float);
-
-        // Create data buffers
-        if (!cgpuCreateBuffer(s_device, {
-                                .usage = CgpuBufferUsage::ShaderDeviceAddress | CgpuBufferUsage::TransferDst,
-                                .memoryProperties = CgpuMemoryProperties::DeviceLocal,
-                                .size = payloadBufferSize,
-                                .debugName = "BlasPayloadBuffer"
-                              }, &payloadBuffer))
-        {
-          GB_ERROR("failed to allocate BLAS payload buffer memory");
-          goto fail_cleanup;
-        }
-
-        if (!cgpuCreateBuffer(s_device, {
-                                .usage = CgpuBufferUsage::ShaderDeviceAddress | CgpuBufferUsage::AccelerationStructureBuild,
-                                .memoryProperties = CgpuMemoryProperties::HostVisible | CgpuMemoryProperties::HostCached,
-                                .size = tmpPositionBufferSize,
-                                .debugName = "BlasVertexPositionsTmp"
-                              }, &tmpPositionBuffer))
-        {
-          GB_ERROR("failed to allocate BLAS temp vertex position memory");
-          goto fail_cleanup;
-        }
-
-        if (!cgpuCreateBuffer(s_device, {
-                                .usage = CgpuBufferUsage::ShaderDeviceAddress | CgpuBufferUsage::AccelerationStructureBuild,
-                                .memoryProperties = CgpuMemoryProperties::HostVisible | CgpuMemoryProperties::HostCached,
-                                .size = tmpIndexBufferSize,
-                                .debugName = "BlasIndicesTmp"
-                              }, &tmpIndexBuffer))
-        {
-          GB_ERROR("failed to allocate BLAS temp indices memory");
-          goto fail_cleanup;
-        }
-
-        // Copy data to GPU
-        {
-          void* mappedMem;
-
-          cgpuMapBuffer(s_device, tmpPositionBuffer, &mappedMem);
-          memcpy(mappedMem, positionData.data(), tmpPositionBufferSize);
-          cgpuUnmapBuffer(s_device, tmpPositionBuffer);
-
-          cgpuMapBuffer(s_device, tmpIndexBuffer, &mappedMem);
-          memcpy(mappedMem, indexData.data(), tmpIndexBufferSize);
-          cgpuUnmapBuffer(s_device, tmpIndexBuffer);
         }
-
-        if (!s_stager->stageToBuffer((uint8_t*) &preamble, preambleSize, payloadBuffer, 0) ||
-            !s_stager->stageToBuffer((uint8_t*) indexData.data(), indicesSize, payloadBuffer, indexBufferOffset) ||
-            !s_stager->stageToBuffer((uint8_t*) vertexData.data(), verticesSize, payloadBuffer, vertexBufferOffset) ||
-            !s_stager->stageToBuffer((uint8_t*) faceIdData.data(), faceIdsSize, payloadBuffer, faceIdsBufferOffset))
+        else
         {
-          GB_ERROR("failed to stage BLAS data");
-          goto fail_cleanup;
+          GB_ERROR("failed to compact BLASes");
         }
 
-        for (size_t i = 0; i < primvars.size(); i++)
+        for (CgpuBlas blas : blases)
         {
-          if (preamble.sceneDataInfos[i] == rp::SCENE_DATA_INVALID)
-          {
-            continue;
-          }
-
-          const GiPrimvarData* s = primvars[i];
-          if (!s_stager->stageToBuffer(&s->data[0], s->data.size(), payloadBuffer, sceneDataOffsets[i]))
-          {
-            GB_ERROR("failed to stage BLAS primvar");
-            goto fail_cleanup;
-          }
+          compactedBlasesSize += cgpuGetBlasSize(s_device, blas);
         }
+      }
 
-        s_stager->flush();
-
-        // Build BLAS
-        {
-          const GiMaterial* material = shaderCache->materials[materialIndex];
-
-          bool blasCreated = cgpuCreateBlas(s_device, {
-                                              .vertexPosBuffer = tmpPositionBuffer,
-                                              .indexBuffer = tmpIndexBuffer,
-                                              .maxVertex = (uint32_t) positionData.size(),
-                                              .triangleCount = (uint32_t) indexData.size() / 3,
-                                              .isOpaque = !material->mcMat->hasCutoutTransparency,
-                                              .debugName = mesh->name.c_str()
-                                            }, &blas);
-
-          if (!blasCreated)
-          {
-            GB_ERROR("failed to allocate BLAS vertex memory");
-            goto fail_cleanup;
-          }
-        }
+      for (size_t i = 0; i < blasBuilds.size(); i++)
+      {
+        const GiBlasBuild& build = blasBuilds[i];
 
-        cgpuDestroyBuffer(s_device, tmpPositionBuffer);
-        tmpPositionBuffer.handle = 0;
-        cgpuDestroyBuffer(s_device, tmpIndexBuffer);
-        tmpIndexBuffer.handle = 0;
+        bool keepBuildInputs = blasesCreated && build.blasCreateInfo.allowUpdate;
 
-        // Append BLAS payload data
+        if (!keepBuildInputs)
         {
-          uint64_t payloadBufferAddress = cgpuGetBufferAddress(s_device, payloadBuffer);
-          if (payloadBufferAddress == 0)
-          {
-            GB_ERROR("failed to get index-vertex buffer address");
-            goto fail_cleanup;
-          }
-
-          uint32_t bitfield = 0;
-          if (mesh->flipFacing)
-          {
-            bitfield |= rp::BLAS_PAYLOAD_BITFLAG_FLIP_FACING;
-          }
-          if (mesh->doubleSided)
-          {
-            bitfield |= rp::BLAS_PAYLOAD_BITFLAG_DOUBLE_SIDED;
-          }
+          cgpuDestroyBuffer(s_device, build.tmpPositionBuffer);
+          cgpuDestroyBuffer(s_device, build.tmpIndexBuffer);
+        }
 
-          uint64_t vertexBufferSize = (vertexBufferOffset/* account for align */ - indexBufferOffset/* account for preamble */);
-          payload = rp::BlasPayload{
-            .bufferAddress = payloadBufferAddress,
-            .vertexOffset = uint32_t(vertexBufferSize / sizeof(rp::FVertex)), // offset to skip index buffer
-            .bitfield = bitfield
-          };
+        if (!blasesCreated)
+        {
+          cgpuDestroyBuffer(s_device, build.payloadBuffer);
+          continue;
         }
 
-        mesh->gpuData = GiMeshGpuData{
-          .blas = blas,
-          .payloadBuffer = payloadBuffer,
-          .payload = payload
+        build.mesh->gpuData = GiMeshGpuData{
+          .blas = blases[i],
+          .payloadBuffer = build.payloadBuffer,
+          .payload = build.payload,
+          .vertexBufferOffset = build.vertexBufferOffset
         };
 
-        // (we ignore padding and the preamble in the reporting, but they are negligible)
-        totalVerticesSize += verticesSize;
-        totalIndicesSize += indicesSize;
-
-        if (false) // not executed in success case
+        if (keepBuildInputs)
         {
-fail_cleanup:
-          if (payloadBuffer.handle)
-            cgpuDestroyBuffer(s_device, payloadBuffer);
-          if (tmpPositionBuffer.handle)
-            cgpuDestroyBuffer(s_device, tmpPositionBuffer);
-          if (tmpIndexBuffer.handle)
-            cgpuDestroyBuffer(s_device, tmpIndexBuffer);
-          if (blas.handle)
-            cgpuDestroyBlas(s_device, blas);
-
-          continue;
+          build.mesh->gpuData->refitInfo = build.blasCreateInfo;
         }
       }
+    }
 
+    for (auto [mesh, materialIndex] : tlasMeshes)
+    {
       const auto& data = mesh->gpuData;
       if (!data.has_value())
       {
         continue; // invalid geometry or an error occurred
       }
 
+      // (we ignore padding and the preamble in the reporting, but they are negligible)
       totalIndicesSize += mesh->cpuData.faceCount * sizeof(uint32_t) * 3;
       totalVerticesSize += mesh->cpuData.vertexCount * sizeof(rp::FVertex);
 
+      mesh->tlasInstanceOffset = uint32_t(blasInstances.size());
+
       for (size_t i = 0; i < mesh->instanceTransforms.size(); i++)
       {
         // Create BLAS instance for TLAS.
-        glm::mat3x4 transform = glm::mat3x4(glm::mat4(mesh->transform) * glm::mat4(mesh->instanceTransforms[i]));
-
         CgpuBlasInstance blasInstance;
         blasInstance.as = data->blas;
         blasInstance.hitGroupIndex = materialIndex * 2; // always two hit groups per material: regular & shadow
         blasInstance.instanceCustomIndex = uint32_t(blasPayloads.size());
-        memcpy(blasInstance.transform, glm::value_ptr(transform), sizeof(float) * 12);
+        _giGetMeshInstanceTransform(mesh, i, blasInstance.transform);
+        blasInstance.mask = _giGetMeshInstanceMask(mesh);
 
         blasInstances.push_back(blasInstance);
         blasPayloads.push_back(data->payload);
@@ -1204,7 +1959,7 @@ fail_cleanup:
     }
   }
 
-  GiBvh* _giCreateBvh(GiScene* scene, const GiShaderCache* shaderCache)
+  GiBvh* _giCreateBvh(GiScene* scene, const GiShaderCache* shaderCache, bool compactBlases)
   {
     GiBvh* bvh = nullptr;
 
@@ -1218,22 +1973,35 @@ fail_cleanup:
     std::vector<int> instanceIds;
     uint64_t indicesSize = 0;
     uint64_t verticesSize = 0;
+    uint64_t builtBlasesSize = 0;
+    uint64_t compactedBlasesSize = 0;
     CgpuBuffer blasPayloadsBuffer;
     CgpuBuffer instanceIdsBuffer;
 
-    _giBuildGeometryStructures(scene, shaderCache, blasInstances, blasPayloads, instanceIds, indicesSize, verticesSize);
+    _giBuildGeometryStructures(scene, shaderCache, blasInstances, blasPayloads, instanceIds, compactBlases,
+                               indicesSize, verticesSize, builtBlasesSize, compactedBlasesSize);
 
     GB_LOG("BLAS builds finished");
     GB_LOG("> {} unique BLAS", blasPayloads.size());
     GB_LOG("> {} BLAS instances", blasInstances.size());
     GB_LOG("> {:.2f} MiB total indices", indicesSize * BYTES_TO_MIB);
     GB_LOG("> {:.2f} MiB total vertices", verticesSize * BYTES_TO_MIB);
+    if (compactBlases && builtBlasesSize > 0)
+    {
+      GB_LOG("> {:.2f} MiB new BLAS memory ({:.2f} MiB before compaction, {:.1f}% saved)", compactedBlasesSize * BYTES_TO_MIB,
+        builtBlasesSize * BYTES_TO_MIB, (1.0 - double(compactedBlasesSize) / double(builtBlasesSize)) * 100.0);
+    }
+    else
+    {
+      GB_LOG("> {:.2f} MiB new BLAS memory", builtBlasesSize * BYTES_TO_MIB);
+    }
 
     // Create TLAS.
     {
       if (!cgpuCreateTlas(s_device, {
                             .instanceCount = (uint32_t) blasInstances.size(),
-                            .instances = blasInstances.data()
+                            .instances = blasInstances.data(),
+                            .allowUpdate = true
                           }, &tlas))
       {
         GB_ERROR("failed to create TLAS");
@@ -1293,6 +2061,7 @@ fail_cleanup:
     bvh->instanceIdsBuffer = instanceIdsBuffer;
     bvh->scene = scene;
     bvh->tlas = tlas;
+    bvh->instanceCount = (uint32_t) blasInstances.size();
 
 cleanup:
     if (!bvh)
@@ -1315,6 +2084,124 @@ cleanup:
     return bvh;
   }
 
+  bool _giRefitDeformedMeshes(GiScene* scene)
+  {
+    std::vector<GiMesh*> meshes;
+    std::vector<CgpuBlas> refitBlases;
+    std::vector<CgpuBlasCreateInfo> refitInfos;
+    std::vector<CgpuBlas> rebuildBlases;
+    std::vector<CgpuBlasCreateInfo> rebuildInfos;
+
+    for (GiMesh* mesh : scene->deformedMeshes)
+    {
+      auto& gpuData = mesh->gpuData;
+      if (!gpuData.has_value() || !gpuData->refitInfo.has_value())
+      {
+        continue; // gets rebuilt with the BVH
+      }
+
+      const CgpuBlasCreateInfo& refitInfo = *gpuData->refitInfo;
+
+      std::vector<GiVertex> vertices = giDecompressMeshVertices(mesh->cpuData);
+
+      std::vector<uint8_t> fvertices(vertices.size() * sizeof(rp::FVertex));
+      std::vector<float> positions(vertices.size() * 3);
+      _giEncodeMeshVertices(vertices, fvertices.data(), positions.data());
+
+      // Positions are read by the BLAS refit, FVertices by the shaders
+      void* mappedMem;
+      cgpuMapBuffer(s_device, refitInfo.vertexPosBuffer, &mappedMem);
+      memcpy(mappedMem, positions.data(), positions.size() * sizeof(float));
+      cgpuUnmapBuffer(s_device, refitInfo.vertexPosBuffer);
+
+      if (!s_stager->stageToBuffer(fvertices.data(), fvertices.size(), gpuData->payloadBuffer, gpuData->vertexBufferOffset))
+      {
+        GB_ERROR("failed to stage deformed vertices");
+        return false;
+      }
+
+      meshes.push_back(mesh);
+
+      // Refitting degrades BLAS quality as the mesh deforms, so rebuild periodically
+      if (gpuData->refitCount >= GI_MAX_BLAS_REFIT_COUNT)
+      {
+        rebuildBlases.push_back(gpuData->blas);
+        rebuildInfos.push_back(refitInfo);
+        gpuData->refitCount = 0;
+      }
+      else
+      {
+        refitBlases.push_back(gpuData->blas);
+        refitInfos.push_back(refitInfo);
+        gpuData->refitCount++;
+      }
+    }
+
+    s_stager->flush();
+
+    if (!cgpuUpdateBlases(s_device, (uint32_t) refitBlases.size(), refitBlases.data(), refitInfos.data()) ||
+        !cgpuUpdateBlases(s_device, (uint32_t) rebuildBlases.size(), rebuildBlases.data(), rebuildInfos.data(), true))
+    {
+      return false;
+    }
+
+    // Instances reference the refitted BLASes in-place, but the TLAS bounds are stale
+    for (GiMesh* mesh : meshes)
+    {
+      if (mesh->tlasInstanceOffset != UINT32_MAX)
+      {
+        scene->dirtyTlasMeshes.insert(mesh);
+        scene->dirtyFlags |= GiSceneDirtyFlags::DirtyTlasInstances;
+      }
+    }
+
+    GB_DEBUG("refitted {} BLAS, rebuilt {} BLAS", refitBlases.size(), rebuildBlases.size());
+
+    return true;
+  }
+
+  bool _giUpdateBvhInstances(GiBvh* bvh)
+  {
+    GiScene* scene = bvh->scene;
+
+    std::vector<CgpuTlasInstanceUpdate> updates;
+    for (const GiMesh* mesh : scene->dirtyTlasMeshes)
+    {
+      uint32_t offset = mesh->tlasInstanceOffset;
+      if (offset == UINT32_MAX)
+      {
+        continue;
+      }
+
+      for (size_t i = 0; i < mesh->instanceTransforms.size(); i++)
+      {
+        CgpuTlasInstanceUpdate update;
+        update.instanceIndex = offset + uint32_t(i);
+        _giGetMeshInstanceTransform(mesh, i, update.transform);
+        update.mask = _giGetMeshInstanceMask(mesh);
+        updates.push_back(update);
+      }
+    }
+
+    // Refitting degrades TLAS quality over time and with large changes, so rebuild in these cases
+    bool rebuild = (updates.size() * 4 > bvh->instanceCount) || (bvh->refitCount >= GI_MAX_TLAS_REFIT_COUNT);
+
+    if (!cgpuUpdateTlas(s_device, bvh->tlas, {
+                          .updateCount = (uint32_t) updates.size(),
+                          .updates = updates.data(),
+                          .rebuild = rebuild
+                        }))
+    {
+      return false;
+    }
+
+    bvh->refitCount = rebuild ? 0 : (bvh->refitCount + 1);
+
+    GB_DEBUG("{} {} TLAS instances", rebuild ? "rebuilt" : "refitted", updates.size());
+
+    return true;
+  }
+
   void _giDestroyBvh(GiBvh* bvh)
   {
     cgpuDestroyTlas(s_device, bvh->tlas);
@@ -1323,7 +2210,8 @@ cleanup:
     delete bvh;
   }
 
-  GiShaderCache* _giCreateShaderCache(const GiRenderParams& params)
+  // Raygen and miss shaders of the previous cache are reused if they are not dirty.
+  GiShaderCache* _giCreateShaderCache(const GiRenderParams& params, GiShaderCache* prevCache, GiSceneDirtyFlags dirtyFlags)
   {
     struct HitShaderCompInfo
     {
@@ -1366,6 +2254,11 @@ cleanup:
 
     std::vector<GiMaterial*> materials(materialSet.begin(), materialSet.end());
 
+    // The raygen shader depends on the material count for invocation reordering.
+    bool reuseRgenShader = prevCache && !bool(dirtyFlags & GiSceneDirtyFlags::DirtyShadersRgen) &&
+                           prevCache->materials.size() == materials.size();
+    bool reuseMissShaders = prevCache && !bool(dirtyFlags & GiSceneDirtyFlags::DirtyShadersMiss);
+
     GB_LOG("material count: {}", materials.size());
     GB_LOG("creating shader cache..");
     fflush(stdout);
@@ -1497,7 +2390,6 @@ cleanup:
         {
           GiGlslShaderGen::ClosestHitShaderParams hitParams = {
             .baseFileName = "rp_main.chit",
-            .commonParams = commonParams,
             .directionalBias = mcMat->directionalBias,
             .enableSceneTransforms = mcMat->requiresSceneTransforms,
             .cameraPositionSceneDataIndex = mcMat->cameraPositionSceneDataIndex,
@@ -1508,7 +2400,7 @@ cleanup:
             .hasVolumeScatteringCoeff = mcMat->hasVolumeScatteringCoeff,
             .isEmissive = mcMat->isEmissive,
             .isThinWalled = mcMat->isThinWalled,
-            .nextEventEstimation = renderSettings.nextEventEstimation,
+            .mediumStackSize = renderSettings.mediumStackSize,
             .sceneDataCount = sceneDataCount,
             .shadingGlsl = compInfo.genInfo.glslSource,
             .textureIndexOffset = texOffset
@@ -1526,9 +2418,9 @@ cleanup:
         {
           GiGlslShaderGen::AnyHitShaderParams hitParams = {
             .baseFileName = "rp_main.ahit",
-            .commonParams = commonParams,
             .enableSceneTransforms = mcMat->requiresSceneTransforms,
             .cameraPositionSceneDataIndex = mcMat->cameraPositionSceneDataIndex,
+            .mediumStackSize = renderSettings.mediumStackSize,
             .opacityEvalGlsl = compInfo.genInfo.glslSource,
             .sceneDataCount = sceneDataCount,
             .textureIndexOffset = texOffset
@@ -1657,6 +2549,11 @@ cleanup:
     }
 
     // Create ray generation shader.
+    if (reuseRgenShader)
+    {
+      rgenShader = prevCache->rgenShader;
+    }
+    else
     {
       GiGlslShaderGen::RaygenShaderParams rgenParams = {
         .clippingPlanes = renderSettings.clippingPlanes,
@@ -1689,6 +2586,11 @@ cleanup:
     }
 
     // Create miss shaders.
+    if (reuseMissShaders)
+    {
+      missShaders = prevCache->missShaders;
+    }
+    else
     {
       GiGlslShaderGen::MissShaderParams missParams = {
         .commonParams = commonParams,
@@ -1760,6 +2662,16 @@ cleanup:
       cgpuCreateBindSets(s_device, pipeline, bindSets.data(), (uint32_t) bindSets.size());
     }
 
+    // Transfer ownership of reused shaders.
+    if (reuseRgenShader)
+    {
+      prevCache->rgenShader = {};
+    }
+    if (reuseMissShaders)
+    {
+      prevCache->missShaders.clear();
+    }
+
     // Assign GPU data to materials.
     for (size_t i = 0; i < hitGroupCompInfos.size(); i++)
     {
@@ -1802,13 +2714,16 @@ cleanup:
     // compilation errors is that we want shader hotloading to not bloat resource usage.
     if (!cache)
     {
-      if (rgenShader.handle)
+      if (rgenShader.handle && !reuseRgenShader)
       {
         cgpuDestroyShader(s_device, rgenShader);
       }
       for (CgpuShader shader : missShaders)
       {
-        cgpuDestroyShader(s_device, shader);
+        if (!reuseMissShaders)
+        {
+          cgpuDestroyShader(s_device, shader);
+        }
       }
       if (pipeline.handle)
       {
@@ -1827,7 +2742,10 @@ cleanup:
   {
     GiScene* scene = cache->scene;
 
-    cgpuDestroyShader(s_device, cache->rgenShader);
+    if (cache->rgenShader.handle)
+    {
+      cgpuDestroyShader(s_device, cache->rgenShader);
+    }
     for (CgpuShader shader : cache->missShaders)
     {
       cgpuDestroyShader(s_device, shader);
@@ -1877,7 +2795,8 @@ cleanup:
     }
     if (aovsChanged)
     {
-      flags |= GiSceneDirtyFlags::DirtyShadersAll | GiSceneDirtyFlags::DirtyBindSets;
+      // Hit shaders read the AOV mask from push constants.
+      flags |= GiSceneDirtyFlags::DirtyShadersRgen | GiSceneDirtyFlags::DirtyShadersMiss | GiSceneDirtyFlags::DirtyBindSets;
     }
     if (aovsChanged || aovDefaultsChanged)
     {
@@ -1888,8 +2807,9 @@ cleanup:
       flags |= GiSceneDirtyFlags::DirtyFramebuffer | GiSceneDirtyFlags::DirtyBindSets;
     }
 
+    // Accumulation weighs samples by count, so spp and the members after it can change without a reset.
     if (memcmp(&a.camera, &b.camera, sizeof(GiCameraDesc)) != 0 ||
-        memcmp(&a.renderSettings, &b.renderSettings, sizeof(GiRenderSettings)) != 0)
+        memcmp(&a.renderSettings, &b.renderSettings, offsetof(GiRenderSettings, spp)) != 0)
     {
       flags |= GiSceneDirtyFlags::DirtyFramebuffer;
     }
@@ -1914,13 +2834,14 @@ cleanup:
         ra.filterImportanceSampling != rb.filterImportanceSampling ||
         ra.jitteredSampling != rb.jitteredSampling ||
         ra.maxVolumeWalkLength != rb.maxVolumeWalkLength ||
+        ra.nextEventEstimation != rb.nextEventEstimation ||
         ra.progressiveAccumulation != rb.progressiveAccumulation)
     {
       flags |= GiSceneDirtyFlags::DirtyShadersRgen;
     }
 
-    if (ra.mediumStackSize != rb.mediumStackSize ||
-        ra.nextEventEstimation != rb.nextEventEstimation)
+    // The medium stack is part of the ray payload and thus affects all stages.
+    if (ra.mediumStackSize != rb.mediumStackSize)
     {
       flags |= GiSceneDirtyFlags::DirtyShadersAll;
     }
@@ -1937,6 +2858,7 @@ cleanup:
 
     if (s_forceShaderCacheInvalid)
     {
+      s_shaderGen->invalidateSpvCache();
       scene->dirtyFlags |= GiSceneDirtyFlags::DirtyShadersAll | GiSceneDirtyFlags::DirtyFramebuffer;
       s_forceShaderCacheInvalid = false;
     }
@@ -1947,12 +2869,71 @@ cleanup:
       s_resetSampleOffset = false;
     }
 
+    for (const GiAovBinding& binding : params.aovBindings)
+    {
+      if (!_GiIsAovFormatSupported(binding.aovId, binding.renderBuffer->format))
+      {
+        GB_ERROR("render buffer format {} not supported for AOV {}", int(binding.renderBuffer->format), int(binding.aovId));
+        return GiStatus::Error;
+      }
+    }
+
     if (GiSceneDirtyFlags flags = _CalcDirtyFlagsForRenderParams(params, scene->oldRenderParams); bool(flags))
     {
       scene->dirtyFlags |= flags;
       scene->oldRenderParams = params;
     }
 
+    // Post-processed render buffers are traced into a separate accumulation buffer.
+    for (const GiAovBinding& binding : params.aovBindings)
+    {
+      GiRenderBuffer* renderBuffer = binding.renderBuffer;
+
+      GiPostProcessMode postProcessMode = _GiGetPostProcessMode(binding.aovId, renderBuffer->format, params.postProcess);
+      if (postProcessMode == renderBuffer->postProcessMode)
+      {
+        continue;
+      }
+
+      bool needsAccumulationMem = (postProcessMode != GiPostProcessMode::None);
+      if (needsAccumulationMem && !renderBuffer->accumulationMem.handle)
+      {
+        uint64_t size = uint64_t(renderBuffer->width) * renderBuffer->height * _GiRenderBufferFormatStride(GiRenderBufferFormat::Float32Vec4);
+
+        if (!cgpuCreateBuffer(s_device, {
+                                .usage = CgpuBufferUsage::ShaderDeviceAddress | CgpuBufferUsage::Storage,
+                                .memoryProperties = CgpuMemoryProperties::DeviceLocal,
+                                .size = size,
+                                .debugName = "RenderBufferAccumulation"
+                              }, &renderBuffer->accumulationMem))
+        {
+          return GiStatus::Error;
+        }
+      }
+      else if (!needsAccumulationMem && renderBuffer->accumulationMem.handle)
+      {
+        s_delayedResourceDestroyer->enqueueDestruction(renderBuffer->accumulationMem);
+        renderBuffer->accumulationMem = {};
+      }
+
+      renderBuffer->postProcessMode = postProcessMode;
+      scene->dirtyFlags |= GiSceneDirtyFlags::DirtyFramebuffer | GiSceneDirtyFlags::DirtyBindSets;
+    }
+
+    // Uploads through the stager are ordered on the GPU, but shaders, acceleration
+    // structures and bind sets are modified in place or destroyed right away.
+    {
+      GiSceneDirtyFlags inFlightSafeFlags = GiSceneDirtyFlags::Clean |
+                                            GiSceneDirtyFlags::DirtyFramebuffer |
+                                            GiSceneDirtyFlags::DirtyAovBindingDefaults |
+                                            GiSceneDirtyFlags::DirtySceneParams;
+
+      if (bool(scene->dirtyFlags & ~inFlightSafeFlags) && !_giWaitForFrames())
+      {
+        return GiStatus::Error;
+      }
+    }
+
     if (bool(scene->dirtyFlags & GiSceneDirtyFlags::DirtyShadersHit))
     {
       for (GiMaterial* mat : scene->materials)
@@ -1983,7 +2964,6 @@ cleanup:
       scene->dirtyFlags |= GiSceneDirtyFlags::DirtyPipeline;
     }
 
-    // TODO: individual rgen & miss shader recompilation
     if (!scene->shaderCache ||
         bool(scene->dirtyFlags & GiSceneDirtyFlags::DirtyPipeline) ||
         bool(scene->dirtyFlags & GiSceneDirtyFlags::DirtyShadersRgen) ||
@@ -1992,7 +2972,14 @@ cleanup:
     {
       GiShaderCache* oldShaderCache = scene->shaderCache;
 
-      scene->shaderCache = _giCreateShaderCache(params);
+      scene->shaderCache = _giCreateShaderCache(params, oldShaderCache, scene->dirtyFlags);
+
+      // Instance SBT offsets are derived from material indices, so the BVH only needs
+      // to be rebuilt if these have changed. Each pipeline comes with its own SBT.
+      if (!scene->shaderCache || !oldShaderCache || scene->shaderCache->materials != oldShaderCache->materials)
+      {
+        scene->dirtyFlags |= GiSceneDirtyFlags::DirtyBvh;
+      }
 
       if (oldShaderCache)
       {
@@ -2005,7 +2992,6 @@ cleanup:
       scene->dirtyFlags &= ~GiSceneDirtyFlags::DirtyShadersMiss;
       scene->dirtyFlags &= ~GiSceneDirtyFlags::DirtyPipeline;
       scene->dirtyFlags |= GiSceneDirtyFlags::DirtyFramebuffer |
-                           GiSceneDirtyFlags::DirtyBvh/*SBT*/ |
                            GiSceneDirtyFlags::DirtyBindSets;
     }
 
@@ -2014,13 +3000,50 @@ cleanup:
       return GiStatus::Error;
     }
 
+    if (bool(scene->dirtyFlags & GiSceneDirtyFlags::DirtyBlasVertices))
+    {
+      if (!_giRefitDeformedMeshes(scene))
+      {
+        GB_ERROR("failed to refit deformed meshes; rebuilding BVH");
+
+        for (GiMesh* mesh : scene->deformedMeshes)
+        {
+          if (mesh->gpuData.has_value())
+          {
+            giDestroyMeshGpuData(*mesh->gpuData);
+            mesh->gpuData.reset();
+          }
+        }
+        scene->dirtyFlags |= GiSceneDirtyFlags::DirtyBvh;
+      }
+
+      scene->deformedMeshes.clear();
+      scene->dirtyFlags &= ~GiSceneDirtyFlags::DirtyBlasVertices;
+      scene->dirtyFlags |= GiSceneDirtyFlags::DirtyFramebuffer;
+    }
+
+    if (scene->bvh && !bool(scene->dirtyFlags & GiSceneDirtyFlags::DirtyBvh) &&
+        bool(scene->dirtyFlags & GiSceneDirtyFlags::DirtyTlasInstances))
+    {
+      if (!_giUpdateBvhInstances(scene->bvh))
+      {
+        GB_ERROR("failed to update TLAS instances; rebuilding BVH");
+        scene->dirtyFlags |= GiSceneDirtyFlags::DirtyBvh;
+      }
+
+      scene->dirtyTlasMeshes.clear();
+      scene->dirtyFlags &= ~GiSceneDirtyFlags::DirtyTlasInstances;
+      scene->dirtyFlags |= GiSceneDirtyFlags::DirtyFramebuffer;
+    }
+
     if (!scene->bvh || bool(scene->dirtyFlags & GiSceneDirtyFlags::DirtyBvh))
     {
       if (scene->bvh) _giDestroyBvh(scene->bvh);
 
-      scene->bvh = _giCreateBvh(scene, scene->shaderCache);
+      scene->bvh = _giCreateBvh(scene, scene->shaderCache, renderSettings.bvhCompaction);
 
-      scene->dirtyFlags &= ~GiSceneDirtyFlags::DirtyBvh;
+      scene->dirtyTlasMeshes.clear();
+      scene->dirtyFlags &= ~(GiSceneDirtyFlags::DirtyBvh | GiSceneDirtyFlags::DirtyTlasInstances);
       scene->dirtyFlags |= GiSceneDirtyFlags::DirtyFramebuffer | GiSceneDirtyFlags::DirtyBindSets;
     }
 
@@ -2145,7 +3168,7 @@ cleanup:
       if (scene->domeLightTexture &&
           scene->domeLightTexture->handle != scene->fallbackDomeLightTexture.handle)
       {
-        // TODO: if we have multiple frames in flight, we need to wait for last frame's semaphore here
+        _giWaitForFrames();
         scene->domeLightTexture.reset(); // frees memory immediately
         scene->dirtyFlags |= GiSceneDirtyFlags::DirtyBindSets;
       }
@@ -2200,34 +3223,63 @@ cleanup:
       GB_ERROR("{}:{}: light commit failed!", __FILE__, __LINE__);
     }
 
-    if (!s_stager->flush())
+    // Rendering waits for the uploads on the GPU instead of the CPU.
+    uint64_t stagerFenceValue = 0;
+    if (!s_stager->submit(stagerFenceValue))
     {
-      GB_ERROR("{}:{}: stager flush failed!", __FILE__, __LINE__);
+      GB_ERROR("{}:{}: stager submit failed!", __FILE__, __LINE__);
     }
 
     // FIXME: use values from Hydra camera and ensure they match the render buffers
     uint32_t imageWidth = params.aovBindings[0].renderBuffer->width;
     uint32_t imageHeight = params.aovBindings[0].renderBuffer->height;
 
-    // Start command buffer.
-    CgpuCommandBuffer commandBuffer;
-    CgpuSemaphore semaphore;
+    // Reuse the resources of the oldest frame in flight.
+    uint64_t frameValue = s_frameCounter + 1;
+    GiFrame& frame = s_frames[frameValue % s_frames.size()];
+    uint32_t readbackIndex = uint32_t(frameValue % s_frames.size());
+
+    CgpuCommandBuffer commandBuffer = frame.commandBuffer;
     CgpuSignalSemaphoreInfo signalSemaphoreInfo;
-    CgpuWaitSemaphoreInfo waitSemaphoreInfo;
+    CgpuWaitSemaphoreInfo stagerWaitSemaphoreInfo;
+
+    if (!_giWaitForFrame(frame.timelineValue))
+      return GiStatus::Error;
 
-    if (!cgpuCreateCommandBuffer(s_device, &commandBuffer))
-      goto cleanup;
+    // After the wait, so that the reused frame's timings are available.
+    uint32_t sampleCount = _giGetFrameSampleCount(renderSettings, scene->sampleOffset, imageWidth * imageHeight);
 
     if (!cgpuBeginCommandBuffer(commandBuffer))
-      goto cleanup;
+      return GiStatus::Error;
+
+    // Accumulation continues in place, after the previous frame's writes and readback.
+    {
+      CgpuMemoryBarrier barrier = {
+        .srcStageMask = CgpuPipelineStage::RayTracingShader | CgpuPipelineStage::ComputeShader | CgpuPipelineStage::Transfer,
+        .srcAccessMask = CgpuMemoryAccess::ShaderWrite,
+        .dstStageMask = CgpuPipelineStage::RayTracingShader,
+        .dstAccessMask = CgpuMemoryAccess::ShaderRead | CgpuMemoryAccess::ShaderWrite
+      };
+
+      CgpuPipelineBarrier pipelineBarrier = {
+        .memoryBarrierCount = 1,
+        .memoryBarriers = &barrier
+      };
+
+      cgpuCmdPipelineBarrier(commandBuffer, &pipelineBarrier);
+    }
 
     // Update descriptor sets if needed
     if (bool(scene->dirtyFlags & GiSceneDirtyFlags::DirtyBindSets))
     {
       GB_DEBUG("updating descriptor sets");
 
+      // Bind sets can't be updated while in use.
+      if (!_giWaitForFrames())
+        goto cleanup;
+
       std::vector<CgpuBufferBinding> buffers;
-      buffers.reserve(16);
+      buffers.reserve(32);
 
       buffers.push_back({ .binding = rp::BINDING_INDEX_SCENE_PARAMS, .buffer = scene->sceneParams });
       buffers.push_back({ .binding = rp::BINDING_INDEX_SPHERE_LIGHTS, .buffer = scene->sphereLights.buffer() });
@@ -2259,10 +3311,24 @@ cleanup:
         rp::BINDING_INDEX_AOV_DOUBLE_SIDED
       };
 
+      std::array<bool, size_t(GiAovId::COUNT)> aovBound = {};
       for (const GiAovBinding& binding : params.aovBindings)
       {
+        const GiRenderBuffer* renderBuffer = binding.renderBuffer;
         uint32_t bindingIndex = aovBindingIndices[int(binding.aovId)];
-        buffers.push_back({ .binding = bindingIndex, .buffer = binding.renderBuffer->deviceMem });
+        CgpuBuffer buffer = renderBuffer->accumulationMem.handle ? renderBuffer->accumulationMem : renderBuffer->deviceMem;
+        assert(binding.aovId != GiAovId::Color || !_GiIsCompactColorFormat(renderBuffer->format) || renderBuffer->accumulationMem.handle);
+        buffers.push_back({ .binding = bindingIndex, .buffer = buffer });
+        aovBound[int(binding.aovId)] = true;
+      }
+
+      // All AOV bindings are declared, but inactive ones are never written to.
+      for (size_t i = 0; i < aovBound.size(); i++)
+      {
+        if (!aovBound[i])
+        {
+          buffers.push_back({ .binding = aovBindingIndices[i], .buffer = scene->aovDefaultValues });
+        }
       }
 
       size_t imageCount = shaderCache->imageBindings.size() + 2/* dome lights */;
@@ -2328,6 +3394,18 @@ cleanup:
       glm::vec3 domeLightEmissionMultiplier = scene->domeLight ? scene->domeLight->baseEmission : glm::vec3(1.0f);
       uint32_t domeLightDiffuseSpecularPacked = glm::packHalf2x16(scene->domeLight ? glm::vec2(scene->domeLight->diffuse, scene->domeLight->specular) : glm::vec2(1.0f));
 
+      uint32_t pcFlags = renderSettings.nextEventEstimation ? rp::PC_FLAG_NEXT_EVENT_ESTIMATION : 0;
+
+      GiRenderBufferFormat normalFormat = _GiGetAovFormat(params, GiAovId::Normal);
+      if (normalFormat == GiRenderBufferFormat::Float16Vec4)
+      {
+        pcFlags |= rp::PC_FLAG_NORMALS_FLOAT16;
+      }
+      else if (normalFormat == GiRenderBufferFormat::PackedNormal)
+      {
+        pcFlags |= rp::PC_FLAG_NORMALS_PACKED;
+      }
+
       rp::PushConstants pushData = {
         .cameraPosition                 = glm::make_vec3(params.camera.position),
         .imageDims                      = ((imageHeight << 16) | imageWidth),
@@ -2337,7 +3415,7 @@ cleanup:
         .cameraVFoV                     = params.camera.vfov,
         .sampleOffset                   = scene->sampleOffset,
         .lensRadius                     = lensRadius,
-        .sampleCount                    = renderSettings.spp,
+        .sampleCount                    = sampleCount,
         .maxSampleValue                 = renderSettings.maxSampleValue,
         .domeLightRotation              = glm::make_vec4(&domeLightRotation[0]),
         .domeLightEmissionMultiplier    = domeLightEmissionMultiplier,
@@ -2348,104 +3426,86 @@ cleanup:
         .clipRangePacked                = glm::packHalf2x16(glm::vec2(params.camera.clipStart, params.camera.clipEnd)),
         .sensorExposure                 = params.camera.exposure,
         .maxVolumeWalkLength            = renderSettings.maxVolumeWalkLength,
-        .metersPerSceneUnit             = renderSettings.metersPerSceneUnit
+        .metersPerSceneUnit             = renderSettings.metersPerSceneUnit,
+        .aovMaskAndFlags                = shaderCache->aovMask | pcFlags
       };
 
       cgpuCmdPushConstants(commandBuffer, shaderCache->pipeline, sizeof(pushData), &pushData);
     }
 
-    // Trace rays
-    cgpuCmdTraceRays(commandBuffer, shaderCache->pipeline, imageWidth, imageHeight);
-
-    // Copy device to host memory
+    // Trace rays, timed to estimate the samples that fit into the budget of later frames
     {
-      GbSmallVector<CgpuBufferMemoryBarrier, 5> preBarriers;
-      GbSmallVector<CgpuBufferMemoryBarrier, 5> postBarriers;
+      uint32_t timestampIndex = readbackIndex * 2;
 
-      preBarriers.resize(params.aovBindings.size());
-      postBarriers.resize(params.aovBindings.size());
+      cgpuCmdResetTimestamps(commandBuffer, timestampIndex, 2);
+      cgpuCmdWriteTimestamp(commandBuffer, timestampIndex);
 
-      for (size_t i = 0; i < params.aovBindings.size(); i++)
-      {
-        const GiAovBinding& binding = params.aovBindings[i];
-        GiRenderBuffer* renderBuffer = binding.renderBuffer;
+      cgpuCmdTraceRays(commandBuffer, shaderCache->pipeline, imageWidth, imageHeight);
 
-        preBarriers[i] = CgpuBufferMemoryBarrier {
-          .buffer = renderBuffer->deviceMem,
-          .srcStageMask = CgpuPipelineStage::RayTracingShader,
-          .srcAccessMask = CgpuMemoryAccess::ShaderWrite,
-          .dstStageMask = CgpuPipelineStage::Transfer,
-          .dstAccessMask = CgpuMemoryAccess::TransferRead
-        };
+      cgpuCmdWriteTimestamp(commandBuffer, timestampIndex + 1);
+      cgpuCmdCopyTimestamps(commandBuffer, frame.timestampBuffer, timestampIndex, 2, true);
 
-        postBarriers[i] = CgpuBufferMemoryBarrier {
-          .buffer = renderBuffer->hostMem,
-          .srcStageMask = CgpuPipelineStage::Transfer,
-          .srcAccessMask = CgpuMemoryAccess::TransferWrite,
-          .dstStageMask = CgpuPipelineStage::Host,
-          .dstAccessMask = CgpuMemoryAccess::HostRead
-        };
-      }
+      _giCmdMemoryBarrier(commandBuffer, CgpuPipelineStage::Transfer, CgpuMemoryAccess::TransferWrite,
+                          CgpuPipelineStage::Host, CgpuMemoryAccess::HostRead);
 
-      CgpuPipelineBarrier preBarrier = {
-        .bufferBarrierCount = (uint32_t) preBarriers.size(),
-        .bufferBarriers = preBarriers.data()
-      };
+      frame.tracedPixelSamples = uint64_t(sampleCount) * imageWidth * imageHeight;
+    }
 
-      cgpuCmdPipelineBarrier(commandBuffer, &preBarrier);
+    // Copy device to host memory, but only for render buffers that are being read
+    {
+      std::vector<GiRenderBuffer*> readbackRenderBuffers;
+      readbackRenderBuffers.reserve(params.aovBindings.size());
 
       for (const GiAovBinding& binding : params.aovBindings)
       {
         GiRenderBuffer* renderBuffer = binding.renderBuffer;
 
-        cgpuCmdCopyBuffer(commandBuffer, renderBuffer->deviceMem, 0, renderBuffer->hostMem);
+        if (renderBuffer->readbackRequested)
+        {
+          readbackRenderBuffers.push_back(renderBuffer);
+        }
+        else
+        {
+          renderBuffer->lastUnreadFrame = frameValue;
+        }
 
-        cgpuInvalidateMappedMemory(s_device, renderBuffer->hostMem, 0, CGPU_WHOLE_SIZE);
+        renderBuffer->renderedFrame = frameValue;
+        renderBuffer->readbackRequested = false;
+        renderBuffer->postProcessSettings = params.postProcess;
       }
 
-      CgpuPipelineBarrier postBarrier = {
-        .bufferBarrierCount = (uint32_t) postBarriers.size(),
-        .bufferBarriers = postBarriers.data()
-      };
-
-      cgpuCmdPipelineBarrier(commandBuffer, &postBarrier);
+      _giRecordReadbacks(commandBuffer, readbackRenderBuffers, readbackIndex, frameValue);
     }
 
-    // Submit command buffer
+    // Submit command buffer. Results are picked up by giGetRenderBufferMem.
     cgpuEndCommandBuffer(commandBuffer);
 
-    if (!cgpuCreateSemaphore(s_device, &semaphore))
-      goto cleanup;
-
-    signalSemaphoreInfo = { .semaphore = semaphore, .value = 1 };
-    cgpuSubmitCommandBuffer(s_device, commandBuffer, 1, &signalSemaphoreInfo);
+    signalSemaphoreInfo = { .semaphore = s_frameSemaphore, .value = frameValue };
+    stagerWaitSemaphoreInfo = { .semaphore = s_stager->semaphore(), .value = stagerFenceValue };
+    cgpuSubmitCommandBuffer(s_device, commandBuffer, 1, &signalSemaphoreInfo, 1, &stagerWaitSemaphoreInfo);
 
-    waitSemaphoreInfo = { .semaphore = semaphore, .value = 1 };
-    if (!cgpuWaitSemaphores(s_device, 1, &waitSemaphoreInfo))
-      goto cleanup;
+    frame.timelineValue = frameValue;
+    s_frameCounter = frameValue;
 
-    s_delayedResourceDestroyer->nextFrame();
-    s_delayedResourceDestroyer->housekeep();
+    // Resources released from now on may still be used by this frame.
+    s_delayedResourceDestroyer->nextFrame(frameValue);
+    s_delayedResourceDestroyer->housekeep(_giGetCompletedFrame());
 
-    for (const GiAovBinding& binding : params.aovBindings)
-    {
-      if (binding.aovId == GiAovId::ClockCycles)
-      {
-        _EncodeRenderBufferAsHeatmap(binding.renderBuffer);
-      }
-    }
-
-    scene->sampleOffset += renderSettings.spp;
+    scene->sampleOffset += sampleCount;
 
-    result = GiStatus::Ok;
+    return GiStatus::Ok;
 
 cleanup:
-    cgpuDestroySemaphore(s_device, semaphore);
-    cgpuDestroyCommandBuffer(s_device, commandBuffer);
+    cgpuEndCommandBuffer(commandBuffer);
 
     return result;
   }
 
+  uint32_t giGetSampleCount(const GiScene* scene)
+  {
+    return scene->sampleOffset;
+  }
+
   GiScene* giCreateScene()
   {
     CgpuImage fallbackDomeLightTexture;
@@ -2473,6 +3533,8 @@ cleanup:
 
   void giDestroyScene(GiScene* scene)
   {
+    _giWaitForFrames();
+
     if (scene->bvh)
     {
       _giDestroyBvh(scene->bvh);
@@ -2910,7 +3972,7 @@ cleanup:
 
     CgpuBuffer deviceMem;
     if (!cgpuCreateBuffer(s_device, {
-                            .usage = CgpuBufferUsage::Storage | CgpuBufferUsage::TransferSrc,
+                            .usage = CgpuBufferUsage::Storage | CgpuBufferUsage::TransferSrc | CgpuBufferUsage::ShaderDeviceAddress,
                             .memoryProperties = CgpuMemoryProperties::DeviceLocal,
                             .size = bufferSize,
                             .debugName = "RenderBufferGpu"
@@ -2919,40 +3981,111 @@ cleanup:
       return nullptr;
     }
 
-    CgpuBuffer hostMem;
-    if (!cgpuCreateBuffer(s_device, {
-                            .usage = CgpuBufferUsage::TransferDst,
-                            .memoryProperties = CgpuMemoryProperties::HostVisible | CgpuMemoryProperties::HostCached,
-                            .size = bufferSize,
-                            .debugName = "RenderBufferCpu"
-                          }, &hostMem))
-    {
-      cgpuDestroyBuffer(s_device, deviceMem);
-      return nullptr;
-    }
-
-    void* mappedMem;
-    cgpuMapBuffer(s_device, hostMem, &mappedMem);
-
-    return new GiRenderBuffer {
+    GiRenderBuffer* renderBuffer = new GiRenderBuffer {
       .deviceMem = deviceMem,
-      .hostMem = hostMem,
-      .mappedHostMem = mappedMem,
+      .format = format,
       .width = width,
       .height = height
     };
+
+    renderBuffer->readbackBuffers.resize(s_frames.size());
+
+    for (GiReadbackBuffer& readbackBuffer : renderBuffer->readbackBuffers)
+    {
+      if (!cgpuCreateBuffer(s_device, {
+                              .usage = CgpuBufferUsage::TransferDst,
+                              .memoryProperties = CgpuMemoryProperties::HostVisible | CgpuMemoryProperties::HostCached,
+                              .size = bufferSize,
+                              .debugName = "RenderBufferCpu"
+                            }, &readbackBuffer.buffer))
+      {
+        giDestroyRenderBuffer(renderBuffer);
+        return nullptr;
+      }
+
+      cgpuMapBuffer(s_device, readbackBuffer.buffer, &readbackBuffer.mappedMem);
+    }
+
+    return renderBuffer;
   }
 
   void giDestroyRenderBuffer(GiRenderBuffer* renderBuffer)
   {
-    cgpuUnmapBuffer(s_device, renderBuffer->hostMem);
     s_delayedResourceDestroyer->enqueueDestruction(renderBuffer->deviceMem);
-    s_delayedResourceDestroyer->enqueueDestruction(renderBuffer->hostMem);
+    if (renderBuffer->accumulationMem.handle)
+    {
+      s_delayedResourceDestroyer->enqueueDestruction(renderBuffer->accumulationMem);
+    }
+    for (const GiReadbackBuffer& readbackBuffer : renderBuffer->readbackBuffers)
+    {
+      if (!readbackBuffer.buffer.handle)
+      {
+        continue;
+      }
+      cgpuUnmapBuffer(s_device, readbackBuffer.buffer);
+      s_delayedResourceDestroyer->enqueueDestruction(readbackBuffer.buffer);
+    }
     delete renderBuffer;
   }
 
   void* giGetRenderBufferMem(GiRenderBuffer* renderBuffer)
   {
-    return renderBuffer->mappedHostMem;
+    // Upcoming frames read back this render buffer too.
+    renderBuffer->readbackRequested = true;
+
+    if (renderBuffer->renderedFrame == 0)
+    {
+      return renderBuffer->readbackBuffers[0].mappedMem;
+    }
+
+    // Prefer the most recent frame that has already completed.
+    uint64_t completedFrame = _giGetCompletedFrame();
+
+    GiReadbackBuffer* newest = nullptr;
+    GiReadbackBuffer* newestCompleted = nullptr;
+    for (GiReadbackBuffer& readbackBuffer : renderBuffer->readbackBuffers)
+    {
+      // Skip results that have been superseded by a frame without readback.
+      if (readbackBuffer.frame <= renderBuffer->lastUnreadFrame)
+      {
+        continue;
+      }
+      if (!newest || readbackBuffer.frame > newest->frame)
+      {
+        newest = &readbackBuffer;
+      }
+      if (readbackBuffer.frame <= completedFrame &&
+          (!newestCompleted || readbackBuffer.frame > newestCompleted->frame))
+      {
+        newestCompleted = &readbackBuffer;
+      }
+    }
+
+    GiReadbackBuffer* readbackBuffer = newestCompleted;
+    if (!readbackBuffer && newest)
+    {
+      // Block on a frame still in flight.
+      readbackBuffer = newest;
+      _giWaitForFrame(readbackBuffer->frame);
+    }
+    else if (!readbackBuffer)
+    {
+      readbackBuffer = _giReadbackRenderBuffer(renderBuffer);
+
+      if (!readbackBuffer)
+      {
+        GB_ERROR("{}:{}: render buffer readback failed", __FILE__, __LINE__);
+        return nullptr;
+      }
+    }
+
+    if (readbackBuffer->frame != renderBuffer->resolvedFrame)
+    {
+      cgpuInvalidateMappedMemory(s_device, readbackBuffer->buffer, 0, CGPU_WHOLE_SIZE);
+
+      renderBuffer->resolvedFrame = readbackBuffer->frame;
+    }
+
+    return readbackBuffer->mappedMem;
   }
 }
@@ -22,8 +22,14 @@
 #include <SPIRV/GlslangToSpv.h>
 
 #include <fstream>
+#include <algorithm>
+#include <string>
+#include <gtl/gb/File.h>
+#include <gtl/gb/Fmt.h>
 #include <gtl/gb/Log.h>
 
+#include <xxhash.h>
+
 namespace
 {
   using ShaderStage = gtl::GiGlslShaderCompiler::ShaderStage;
@@ -42,6 +48,88 @@ namespace
       return EShLangCount;
     }
   }
+
+  // Bump when the compiler options change in a way not covered by the cache key.
+  constexpr static const uint32_t SPV_CACHE_VERSION = 1;
+  constexpr static const uint32_t SPV_CACHE_FILE_MAGIC = 0x56505347; // 'GSPV'
+  constexpr static const size_t MAX_SPV_CACHE_MEMORY_SIZE = 64 * 1024 * 1024;
+  constexpr static const size_t MAX_SPV_CACHE_DISK_SIZE = 256 * 1024 * 1024;
+
+  struct SpvCacheFileHeader
+  {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t key;
+  };
+
+  // Includes are resolved by glslang, so their contents are not part of the stitched
+  // source. We hash the whole shader directory to catch changes to them.
+  uint64_t _HashShaderDirectory(const fs::path& shaderPath)
+  {
+    std::error_code errorCode;
+    std::vector<fs::path> filePaths;
+
+    for (auto it = fs::recursive_directory_iterator(shaderPath, errorCode);
+         !errorCode && it != fs::recursive_directory_iterator(); it.increment(errorCode))
+    {
+      if (it->is_regular_file(errorCode))
+      {
+        filePaths.push_back(it->path());
+      }
+    }
+
+    std::sort(filePaths.begin(), filePaths.end());
+
+    XXH64_state_t* state = XXH64_createState();
+    XXH64_reset(state, 0);
+
+    std::vector<char> text;
+    for (const fs::path& filePath : filePaths)
+    {
+      std::string relPath = fs::relative(filePath, shaderPath, errorCode).generic_string();
+      XXH64_update(state, relPath.data(), relPath.size());
+
+      std::ifstream fileStream(filePath, std::ios_base::binary | std::ios_base::ate);
+      if (!fileStream.is_open())
+      {
+        continue;
+      }
+
+      text.resize(fileStream.tellg());
+      fileStream.seekg(0, std::ios::beg);
+      fileStream.read(text.data(), text.size());
+      XXH64_update(state, text.data(), text.size());
+    }
+
+    uint64_t hash = XXH64_digest(state);
+    XXH64_freeState(state);
+    return hash;
+  }
+
+  void _WriteSpvCacheFile(const fs::path& cacheDir, uint64_t key, const std::vector<uint8_t>& spv)
+  {
+    std::error_code ec;
+    fs::create_directories(cacheDir, ec);
+
+    fs::path filePath = cacheDir / GB_FMT("{:016x}.spv", key);
+    std::string path = filePath.string();
+
+    SpvCacheFileHeader header {
+      .magic = SPV_CACHE_FILE_MAGIC,
+      .version = SPV_CACHE_VERSION,
+      .key = key
+    };
+
+    std::span<const uint8_t> chunks[] = {
+      std::span((const uint8_t*) &header, sizeof(header)),
+      std::span(spv)
+    };
+
+    if (!gbWriteFileAtomic(path, chunks))
+    {
+      GB_ERROR("failed to write SPIR-V cache file {}", path);
+    }
+  }
 }
 
 namespace gtl
@@ -97,13 +185,21 @@ namespace gtl
     }
   };
 
-  GiGlslShaderCompiler::GiGlslShaderCompiler(const fs::path& shaderPath)
+  GiGlslShaderCompiler::GiGlslShaderCompiler(const fs::path& shaderPath, const fs::path& cacheDir)
     : m_fileIncluder(std::make_shared<_FileIncluder>(shaderPath))
+    , m_shaderPath(shaderPath)
+    , m_cacheDir(cacheDir)
+    , m_includeHash(_HashShaderDirectory(shaderPath))
   {
     // glslang requires this static initialization, however it internally
     // ref-counts and is thread-safe. The return value seems to be unused.
     [[maybe_unused]] bool result = glslang::InitializeProcess();
     assert(result);
+
+    if (!m_cacheDir.empty())
+    {
+      gbTrimDirectory(m_cacheDir.string(), ".spv", MAX_SPV_CACHE_DISK_SIZE);
+    }
   }
 
   GiGlslShaderCompiler::~GiGlslShaderCompiler()
@@ -111,10 +207,144 @@ namespace gtl
     glslang::FinalizeProcess(); // see above
   }
 
+  void GiGlslShaderCompiler::invalidateCache()
+  {
+    std::lock_guard guard(m_cacheMutex);
+
+    m_includeHash = _HashShaderDirectory(m_shaderPath);
+    m_lruList.clear();
+    m_lruMap.clear();
+    m_lruSize = 0;
+  }
+
+  uint64_t GiGlslShaderCompiler::calcCacheKey(ShaderStage stage, std::string_view source) const
+  {
+    glslang::Version glslangVersion = glslang::GetVersion();
+
+    const struct
+    {
+      uint64_t version;
+      uint64_t glslangVersion;
+      uint64_t stage;
+      uint64_t debug;
+      uint64_t clientVersion;
+      uint64_t targetVersion;
+      uint64_t includeHash;
+    } options {
+      .version = SPV_CACHE_VERSION,
+      .glslangVersion = (uint64_t(glslangVersion.major) << 32) | (uint64_t(glslangVersion.minor) << 16) | uint64_t(glslangVersion.patch),
+      .stage = uint64_t(stage),
+#ifdef NDEBUG
+      .debug = 0,
+#else
+      .debug = 1,
+#endif
+      .clientVersion = uint64_t(glslang::EShTargetVulkan_1_1),
+      .targetVersion = uint64_t(glslang::EShTargetSpv_1_4),
+      .includeHash = m_includeHash
+    };
+
+    uint64_t optionsHash = XXH64(&options, sizeof(options), 0);
+    return XXH64(source.data(), source.size(), optionsHash);
+  }
+
+  bool GiGlslShaderCompiler::readCachedSpv(uint64_t key, std::vector<uint8_t>& spv)
+  {
+    {
+      std::lock_guard guard(m_cacheMutex);
+
+      auto mapIt = m_lruMap.find(key);
+      if (mapIt != m_lruMap.end())
+      {
+        m_lruList.splice(m_lruList.begin(), m_lruList, mapIt->second);
+        spv = mapIt->second->spv;
+        return true;
+      }
+    }
+
+    if (m_cacheDir.empty())
+    {
+      return false;
+    }
+
+    fs::path filePath = m_cacheDir / GB_FMT("{:016x}.spv", key);
+
+    std::ifstream fileStream(filePath, std::ios_base::binary | std::ios_base::ate);
+    if (!fileStream.is_open())
+    {
+      return false;
+    }
+
+    size_t fileSize = fileStream.tellg();
+    if (fileSize <= sizeof(SpvCacheFileHeader) || ((fileSize - sizeof(SpvCacheFileHeader)) % sizeof(uint32_t)) != 0)
+    {
+      return false;
+    }
+
+    SpvCacheFileHeader header;
+    fileStream.seekg(0, std::ios::beg);
+    fileStream.read((char*) &header, sizeof(header));
+
+    if (header.magic != SPV_CACHE_FILE_MAGIC || header.version != SPV_CACHE_VERSION || header.key != key)
+    {
+      return false;
+    }
+
+    std::vector<uint8_t> fileSpv(fileSize - sizeof(SpvCacheFileHeader));
+    fileStream.read((char*) fileSpv.data(), fileSpv.size());
+
+    if (!fileStream)
+    {
+      return false;
+    }
+
+    // Keep recently used files when the disk tier is trimmed.
+    gbTouchFile(filePath.string());
+
+    // Promote to memory tier.
+    writeCachedSpv(key, fileSpv);
+
+    spv = std::move(fileSpv);
+    return true;
+  }
+
+  void GiGlslShaderCompiler::writeCachedSpv(uint64_t key, const std::vector<uint8_t>& spv)
+  {
+    if (spv.size() > MAX_SPV_CACHE_MEMORY_SIZE)
+    {
+      return;
+    }
+
+    std::lock_guard guard(m_cacheMutex);
+
+    if (m_lruMap.count(key) > 0)
+    {
+      return;
+    }
+
+    while (!m_lruList.empty() && (m_lruSize + spv.size()) > MAX_SPV_CACHE_MEMORY_SIZE)
+    {
+      const _SpvCacheEntry& entry = m_lruList.back();
+      m_lruSize -= entry.spv.size();
+      m_lruMap.erase(entry.key);
+      m_lruList.pop_back();
+    }
+
+    m_lruList.push_front(_SpvCacheEntry{ key, spv });
+    m_lruMap[key] = m_lruList.begin();
+    m_lruSize += spv.size();
+  }
+
   bool GiGlslShaderCompiler::compileGlslToSpv(ShaderStage stage,
                                                std::string_view source,
                                                std::vector<uint8_t>& spv)
   {
+    uint64_t cacheKey = calcCacheKey(stage, source);
+    if (readCachedSpv(cacheKey, spv))
+    {
+      return true;
+    }
+
     EShLanguage language = _GetGlslangShaderLanguage(stage);
 
     glslang::TShader shader(language);
@@ -168,6 +398,14 @@ namespace gtl
 
     glslang::TIntermediate* intermediate = program.getIntermediate(language);
     glslang::GlslangToSpv(*intermediate, *reinterpret_cast<std::vector<unsigned int>*>(&spv), &spvOptions);
+
+    writeCachedSpv(cacheKey, spv);
+
+    if (!m_cacheDir.empty())
+    {
+      _WriteSpvCacheFile(m_cacheDir, cacheKey, spv);
+    }
+
     return true;
   }
 }
@@ -17,9 +17,14 @@
 
 #pragma once
 
+#include <atomic>
 #include <vector>
 #include <string_view>
 #include <filesystem>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
 
 namespace fs = std::filesystem;
 
@@ -38,7 +43,9 @@ namespace gtl
     };
 
   public:
-    GiGlslShaderCompiler(const fs::path& shaderPath);
+    // SPIR-V is cached by source hash in memory and, if cacheDir is non-empty, on disk.
+    // The disk tier is trimmed to the least recently used files on construction.
+    GiGlslShaderCompiler(const fs::path& shaderPath, const fs::path& cacheDir = {});
 
     ~GiGlslShaderCompiler();
 
@@ -47,7 +54,28 @@ namespace gtl
                           std::string_view source,
                           std::vector<uint8_t>& spv);
 
+    // Needs to be called when files in the shader path have changed.
+    void invalidateCache();
+
+  private:
+    uint64_t calcCacheKey(ShaderStage stage, std::string_view source) const;
+    bool readCachedSpv(uint64_t key, std::vector<uint8_t>& spv);
+    void writeCachedSpv(uint64_t key, const std::vector<uint8_t>& spv);
+
   private:
+    struct _SpvCacheEntry
+    {
+      uint64_t key;
+      std::vector<uint8_t> spv;
+    };
+
     std::shared_ptr<class _FileIncluder> m_fileIncluder;
+    fs::path m_shaderPath;
+    fs::path m_cacheDir;
+    std::atomic_uint64_t m_includeHash = 0;
+    std::mutex m_cacheMutex;
+    std::list<_SpvCacheEntry> m_lruList;
+    std::unordered_map<uint64_t, std::list<_SpvCacheEntry>::iterator> m_lruMap;
+    size_t m_lruSize = 0;
   };
 }
@@ -34,7 +34,7 @@ namespace gtl
 {
   class McRuntime;
 
-  bool GiGlslShaderGen::init(std::string_view shaderPath, McRuntime& mcRuntime)
+  bool GiGlslShaderGen::init(std::string_view shaderPath, std::string_view spvCacheDir, McRuntime& mcRuntime)
   {
     m_shaderPath = fs::path(shaderPath);
 
@@ -44,18 +44,28 @@ namespace gtl
       return false;
     }
 
-    m_shaderCompiler = std::make_shared<GiGlslShaderCompiler>(m_shaderPath);
+    m_shaderCompiler = std::make_shared<GiGlslShaderCompiler>(m_shaderPath, fs::path(spvCacheDir));
 
     return true;
   }
 
-  void _sgGenerateCommonDefines(GiGlslStitcher& stitcher, const GiGlslShaderGen::CommonShaderParams& params)
+  void GiGlslShaderGen::invalidateSpvCache()
+  {
+    m_shaderCompiler->invalidateCache();
+  }
+
+  void _sgGenerateCommonDefines(GiGlslStitcher& stitcher, uint32_t mediumStackSize)
   {
 #if defined(NDEBUG)
     stitcher.appendDefine("NDEBUG");
 #endif
+    stitcher.appendDefine("MEDIUM_STACK_SIZE", (int32_t) mediumStackSize);
+  }
+
+  void _sgGenerateCommonDefines(GiGlslStitcher& stitcher, const GiGlslShaderGen::CommonShaderParams& params)
+  {
+    _sgGenerateCommonDefines(stitcher, params.mediumStackSize);
     stitcher.appendDefine("AOV_MASK", (int) params.aovMask);
-    stitcher.appendDefine("MEDIUM_STACK_SIZE", (int32_t) params.mediumStackSize);
   }
 
   bool GiGlslShaderGen::generateRgenSpirv(std::string_view fileName, const RaygenShaderParams& params, std::vector<uint8_t>& spv)
@@ -136,6 +146,21 @@ namespace gtl
     return m_shaderCompiler->compileGlslToSpv(GiGlslShaderCompiler::ShaderStage::Miss, source, spv);
   }
 
+  bool GiGlslShaderGen::generateComputeSpirv(std::string_view fileName, std::vector<uint8_t>& spv)
+  {
+    GiGlslStitcher stitcher;
+    stitcher.appendVersion();
+
+    fs::path filePath = m_shaderPath / fileName;
+    if (!stitcher.appendSourceFile(filePath))
+    {
+      return false;
+    }
+
+    std::string source = stitcher.source();
+    return m_shaderCompiler->compileGlslToSpv(GiGlslShaderCompiler::ShaderStage::Compute, source, spv);
+  }
+
   bool _MakeMaterialGenInfo(const McGlslGenResult& codeGenResult,
                             const std::string& resourcePathPrefix,
                             fs::path shaderPath,
@@ -197,7 +222,7 @@ namespace gtl
     GiGlslStitcher stitcher;
     stitcher.appendVersion();
 
-    _sgGenerateCommonDefines(stitcher, params.commonParams);
+    _sgGenerateCommonDefines(stitcher, params.mediumStackSize);
 
     stitcher.appendDefine("TEXTURE_INDEX_OFFSET", (int32_t) params.textureIndexOffset);
     stitcher.appendDefine("MEDIUM_DIRECTIONAL_BIAS", params.directionalBias);
@@ -231,10 +256,6 @@ namespace gtl
     {
       stitcher.appendDefine("IS_THIN_WALLED");
     }
-    if (params.nextEventEstimation)
-    {
-      stitcher.appendDefine("NEXT_EVENT_ESTIMATION");
-    }
     if (params.enableSceneTransforms)
     {
       stitcher.appendDefine("SCENE_TRANSFORMS");
@@ -261,7 +282,7 @@ namespace gtl
     GiGlslStitcher stitcher;
     stitcher.appendVersion();
 
-    _sgGenerateCommonDefines(stitcher, params.commonParams);
+    _sgGenerateCommonDefines(stitcher, params.mediumStackSize);
 
     stitcher.appendDefine("TEXTURE_INDEX_OFFSET", (int32_t) params.textureIndexOffset);
     stitcher.appendDefine("SCENE_DATA_COUNT", (int32_t) params.sceneDataCount);
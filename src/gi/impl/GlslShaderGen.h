@@ -38,7 +38,9 @@ namespace gtl
   class GiGlslShaderGen
   {
   public:
-    bool init(std::string_view shaderPath, McRuntime& runtime);
+    bool init(std::string_view shaderPath, std::string_view spvCacheDir, McRuntime& runtime);
+
+    void invalidateSpvCache();
 
   public:
     struct MaterialGenInfo
@@ -75,10 +77,11 @@ namespace gtl
       bool domeLightCameraVisible;
     };
 
+    // Hit shaders don't depend on the AOV mask or NEE so that they
+    // can be reused across changes; both are passed as push constants.
     struct ClosestHitShaderParams
     {
       std::string_view baseFileName;
-      CommonShaderParams commonParams;
       float directionalBias;
       bool enableSceneTransforms;
       int cameraPositionSceneDataIndex;
@@ -89,7 +92,7 @@ namespace gtl
       bool hasVolumeScatteringCoeff;
       bool isEmissive;
       bool isThinWalled;
-      bool nextEventEstimation;
+      uint32_t mediumStackSize;
       uint32_t sceneDataCount;
       std::string_view shadingGlsl;
       uint32_t textureIndexOffset;
@@ -98,9 +101,9 @@ namespace gtl
     struct AnyHitShaderParams
     {
       std::string_view baseFileName;
-      CommonShaderParams commonParams;
       bool enableSceneTransforms;
       int cameraPositionSceneDataIndex;
+      uint32_t mediumStackSize;
       std::string_view opacityEvalGlsl;
       uint32_t sceneDataCount;
       bool shadowTest;
@@ -111,6 +114,7 @@ namespace gtl
     bool generateMissSpirv(std::string_view fileName, const MissShaderParams& params, std::vector<uint8_t>& spv);
     bool generateClosestHitSpirv(const ClosestHitShaderParams& params, std::vector<uint8_t>& spv);
     bool generateAnyHitSpirv(const AnyHitShaderParams& params, std::vector<uint8_t>& spv);
+    bool generateComputeSpirv(std::string_view fileName, std::vector<uint8_t>& spv);
 
   private:
     std::shared_ptr<McBackend> m_mcBackend;
@@ -88,7 +88,14 @@ namespace
       return data;
     }
 
-    uint32_t dataSize = blosc1_decompress(&buf.data[0], &data[0], buf.uncompressedSize);
+    // Use a dedicated single-threaded context because the blosc1 API serializes
+    // calls through a global lock, and we decompress multiple meshes in parallel.
+    blosc2_dparams dparams = BLOSC2_DPARAMS_DEFAULTS;
+    dparams.nthreads = 1;
+
+    blosc2_context* dctx = blosc2_create_dctx(dparams);
+    int dataSize = blosc2_decompress_ctx(dctx, &buf.data[0], int32_t(buf.data.size()), &data[0], int32_t(buf.uncompressedSize));
+    blosc2_free_ctx(dctx);
     assert(dataSize > 0);
     data.resize(dataSize / sizeof(T));
     return std::move(data);
@@ -153,7 +160,9 @@ namespace gtl
 
     if (vertexCount < 16)
     {
-      return _CompressData(faces, faceIds, vertices, primvars);
+      GiMeshData m = _CompressData(faces, faceIds, vertices, primvars);
+      m.sourceVertexCount = vertexCount;
+      return m;
     }
 
     std::vector<meshopt_Stream> streams;
@@ -176,7 +185,9 @@ namespace gtl
 
     if (newVertexCount == vertexCount)
     {
-      return _CompressData(faces, faceIds, vertices, primvars);
+      GiMeshData m = _CompressData(faces, faceIds, vertices, primvars);
+      m.sourceVertexCount = vertexCount;
+      return m;
     }
     else
     {
@@ -208,7 +219,10 @@ namespace gtl
       meshopt_remapVertexBuffer(&n.data[0], &o.data[0], vertexCount, typeSize, remap.data());
     }
 
-    return _CompressData(newFaces, faceIds, newVertices, newPrimvars);
+    GiMeshData m = _CompressData(newFaces, faceIds, newVertices, newPrimvars);
+    m.vertexRemap = _CompressMeshBuffer(remap);
+    m.sourceVertexCount = vertexCount;
+    return m;
   }
 
   void giDecompressMeshData(const GiMeshData& cmd,
@@ -234,4 +248,35 @@ namespace gtl
       };
     }
   }
+
+  std::vector<GiVertex> giDecompressMeshVertices(const GiMeshData& cmd)
+  {
+    return _DecompressMeshBuffer<GiVertex>(cmd.vertices);
+  }
+
+  bool giUpdateMeshDataVertices(GiMeshData& cmd,
+                                const std::vector<GiVertex>& vertices)
+  {
+    if (vertices.size() != cmd.sourceVertexCount)
+    {
+      return false;
+    }
+
+    if (cmd.vertexRemap.data.empty())
+    {
+      cmd.vertices = _CompressMeshBuffer(vertices);
+      return true;
+    }
+
+    // The remap table of the initial data is reused. Vertices that were merged because they
+    // were identical are assumed to stay identical, which holds for regular deformations.
+    std::vector<uint32_t> remap = _DecompressMeshBuffer<uint32_t>(cmd.vertexRemap);
+
+    std::vector<GiVertex> newVertices(cmd.vertexCount);
+    meshopt_remapVertexBuffer((void*) newVertices.data(), (void*) &vertices[0],
+                              vertices.size(), sizeof(GiVertex), remap.data());
+
+    cmd.vertices = _CompressMeshBuffer(newVertices);
+    return true;
+  }
 }
@@ -44,8 +44,10 @@ namespace gtl
     GiMeshBuffer faceIds;
     GiMeshBuffer vertices;
     std::vector<GiMeshPrimvar> primvars;
+    GiMeshBuffer vertexRemap; // empty if vertices have not been remapped
     uint32_t faceCount;
     uint32_t vertexCount;
+    uint32_t sourceVertexCount;
   };
 
   GiMeshData giProcessMeshData(const std::vector<GiFace>& faces,
@@ -58,4 +60,9 @@ namespace gtl
                             std::vector<int>& faceIds,
                             std::vector<GiVertex>& vertices,
                             std::vector<GiPrimvarData>& primvars);
+
+  std::vector<GiVertex> giDecompressMeshVertices(const GiMeshData& cmd);
+
+  bool giUpdateMeshDataVertices(GiMeshData& cmd,
+                                const std::vector<GiVertex>& vertices);
 }
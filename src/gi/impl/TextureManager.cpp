@@ -16,9 +16,12 @@
 //
 
 #include "TextureManager.h"
+#include "BcEncoder.h"
 #include "Gi.h"
 
 #include <gtl/mc/Backend.h>
+#include <gtl/gb/File.h>
+#include <gtl/gb/Fmt.h>
 #include <gtl/gb/Log.h>
 #include <gtl/ggpu/DelayedResourceDestroyer.h>
 #include <gtl/ggpu/Stager.h>
@@ -26,43 +29,334 @@
 
 #include <xxhash.h>
 
+#include <algorithm>
+#include <filesystem>
+#include <span>
+#include <thread>
+
 #include <assert.h>
 #include <string.h>
 #include <inttypes.h>
 
+namespace gtl
+{
+  struct GiDecodedTexture
+  {
+    CgpuImageCreateInfo createInfo;
+    uint32_t blockDim = 1;
+    std::vector<std::span<const uint8_t>> levels; // upload-ready data per mip level
+    std::vector<std::vector<uint8_t>> levelStorage; // empty if mapped from texture cache
+    size_t size = 0;
+
+    GiAssetReader* cacheReader = nullptr;
+    GiAsset* cacheAsset = nullptr;
+
+    GiDecodedTexture() = default;
+    GiDecodedTexture(const GiDecodedTexture&) = delete;
+    GiDecodedTexture& operator=(const GiDecodedTexture&) = delete;
+
+    ~GiDecodedTexture()
+    {
+      if (cacheAsset)
+      {
+        cacheReader->close(cacheAsset);
+      }
+    }
+  };
+}
+
 namespace
 {
   using namespace gtl;
+  namespace fs = std::filesystem;
 
   constexpr static const float BYTES_TO_MIB = 1.0f / (1024.0f * 1024.0f);
+  constexpr static const size_t MAX_IN_FLIGHT_DECODE_BYTES = 1024 * 1024 * 1024;
+  // Least recently used files are evicted at startup. The cache is disabled with an empty cache dir.
+  constexpr static const uint64_t MAX_TEXTURE_CACHE_DISK_SIZE = 4ull * 1024 * 1024 * 1024;
+
+  // Upper bound of the host memory that decoding an image takes, from its header alone.
+  size_t _EstimateDecodedSize(const ImgioImageInfo& imageInfo, bool is3dImage, uint32_t maxResolution)
+  {
+    size_t pixelSize = ImgioGetFormatPixelSize(imageInfo.format);
+    size_t decodedSize = size_t(imageInfo.width) * imageInfo.height * pixelSize;
+
+    uint32_t width = imageInfo.width;
+    uint32_t height = imageInfo.height;
+    while (maxResolution > 0 && std::max(width, height) > maxResolution)
+    {
+      width = std::max(width / 2, 1u);
+      height = std::max(height / 2, 1u);
+    }
+
+    // A full mip chain adds a third to the base level
+    size_t levelSize = size_t(width) * height * pixelSize;
+    size_t chainSize = is3dImage ? levelSize : (levelSize + levelSize / 3);
+
+    return std::max(decodedSize, chainSize);
+  }
+
+  uint32_t _CalcMipLevelCount(uint32_t width, uint32_t height)
+  {
+    uint32_t levelCount = 1;
+    for (uint32_t size = std::max(width, height); size > 1; size /= 2)
+    {
+      levelCount++;
+    }
+    return levelCount;
+  }
+
+  // 3D textures are uploaded verbatim (no mip chain, compression or resolution cap), so they can be
+  // decoded directly into staging memory unless the decoded pixels are needed for the disk cache.
+  bool _CanDecodeToStaging(bool is3dImage, const fs::path& cacheDir)
+  {
+    return is3dImage && cacheDir.empty();
+  }
+
+  void _GetImageFormat(ImgioFormat imgioFormat, CgpuImageFormat& format, CgpuComponentMapping& components)
+  {
+    // Grayscale images are expanded to RGB(A) on sampling.
+    const CgpuComponentSwizzle R = CgpuComponentSwizzle::R;
+
+    switch (imgioFormat)
+    {
+    case ImgioFormat::R8:
+      format = CgpuImageFormat::R8Unorm;
+      components = { .r = R, .g = R, .b = R, .a = CgpuComponentSwizzle::One };
+      break;
+    case ImgioFormat::RG8:
+      format = CgpuImageFormat::R8G8Unorm;
+      components = { .r = R, .g = R, .b = R, .a = CgpuComponentSwizzle::G };
+      break;
+    case ImgioFormat::RGBA16F:
+      format = CgpuImageFormat::R16G16B16A16Sfloat;
+      components = {};
+      break;
+    case ImgioFormat::RGBA32F:
+      format = CgpuImageFormat::R32G32B32A32Sfloat;
+      components = {};
+      break;
+    default:
+      format = CgpuImageFormat::R8G8B8A8Unorm;
+      components = {};
+      break;
+    }
+  }
+
+  // Returns 0 for formats the texture cache does not produce.
+  uint64_t _CalcLevelSize(CgpuImageFormat format, uint32_t blockDim, uint32_t width, uint32_t height)
+  {
+    if (blockDim > 1)
+    {
+      uint64_t blockCount = uint64_t((width + blockDim - 1) / blockDim) * ((height + blockDim - 1) / blockDim);
+      return blockCount * giBcGetBlockSize(format);
+    }
+
+    uint64_t texelCount = uint64_t(width) * height;
+    switch (format)
+    {
+    case CgpuImageFormat::R8Unorm: return texelCount;
+    case CgpuImageFormat::R8G8Unorm: return texelCount * 2;
+    case CgpuImageFormat::R8G8B8A8Unorm: return texelCount * 4;
+    case CgpuImageFormat::R16G16B16A16Sfloat: return texelCount * 8;
+    case CgpuImageFormat::R32Sfloat: return texelCount * 4;
+    case CgpuImageFormat::R32G32B32A32Sfloat: return texelCount * 16;
+    default: return 0;
+    }
+  }
+
+  constexpr static const uint32_t TEXTURE_CACHE_FILE_MAGIC = 0x58455447; // 'GTEX'
+  constexpr static const uint32_t TEXTURE_CACHE_VERSION = 1;
+  constexpr static const uint32_t TEXTURE_CACHE_MAX_MIP_LEVELS = 32;
+
+  struct TextureCacheFileHeader
+  {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t key;
+    uint32_t width;
+    uint32_t height;
+    uint32_t format;
+    uint32_t components[4];
+    uint32_t mipLevels;
+    uint32_t blockDim;
+    uint32_t is3d;
+    // followed by uint64_t level sizes and the level data
+  };
+
+  uint64_t _CalcTextureCacheKey(const void* data, size_t size, bool is3dImage, GiTextureCompression textureCompression,
+                                uint32_t maxResolution)
+  {
+    // All-uint64 to avoid hashing uninitialized padding
+    struct {
+      uint64_t version;
+      uint64_t is3dImage;
+      uint64_t textureCompression;
+      uint64_t maxResolution;
+    } options = {
+      .version = TEXTURE_CACHE_VERSION,
+      .is3dImage = is3dImage,
+      .textureCompression = uint64_t(textureCompression),
+      .maxResolution = maxResolution
+    };
+
+    uint64_t seed = XXH64(&options, sizeof(options), 0);
+    return XXH64(data, size, seed);
+  }
+
+  bool _ParseTextureCacheFile(const uint8_t* fileData, size_t fileSize, uint64_t key, GiDecodedTexture& texture)
+  {
+    if (!fileData || fileSize < sizeof(TextureCacheFileHeader))
+    {
+      return false;
+    }
+
+    TextureCacheFileHeader header;
+    memcpy(&header, fileData, sizeof(header));
+
+    if (header.magic != TEXTURE_CACHE_FILE_MAGIC || header.version != TEXTURE_CACHE_VERSION || header.key != key ||
+        header.mipLevels == 0 || header.mipLevels > TEXTURE_CACHE_MAX_MIP_LEVELS ||
+        header.width == 0 || header.height == 0 || (header.blockDim != 1 && header.blockDim != GI_BC_BLOCK_DIM))
+    {
+      return false;
+    }
+
+    size_t offset = sizeof(header) + header.mipLevels * sizeof(uint64_t);
+    if (fileSize < offset)
+    {
+      return false;
+    }
+
+    texture.levels.resize(header.mipLevels);
+    texture.size = 0;
+
+    for (uint32_t level = 0; level < header.mipLevels; level++)
+    {
+      uint64_t levelSize;
+      memcpy(&levelSize, &fileData[sizeof(header) + level * sizeof(uint64_t)], sizeof(levelSize));
+
+      // Uploads read the full level, so it must match the dimensions exactly
+      uint32_t width = std::max(header.width >> level, 1u);
+      uint32_t height = std::max(header.height >> level, 1u);
+      uint64_t expectedSize = _CalcLevelSize(CgpuImageFormat(header.format), header.blockDim, width, height);
+
+      if (expectedSize == 0 || levelSize != expectedSize || levelSize > fileSize - offset)
+      {
+        return false;
+      }
+
+      texture.levels[level] = std::span<const uint8_t>(&fileData[offset], levelSize);
+      texture.size += levelSize;
+      offset += levelSize;
+    }
+
+    texture.createInfo = {
+      .width = header.width,
+      .height = header.height,
+      .is3d = bool(header.is3d),
+      .mipLevels = header.mipLevels,
+      .format = CgpuImageFormat(header.format),
+      .components = {
+        .r = CgpuComponentSwizzle(header.components[0]),
+        .g = CgpuComponentSwizzle(header.components[1]),
+        .b = CgpuComponentSwizzle(header.components[2]),
+        .a = CgpuComponentSwizzle(header.components[3])
+      }
+    };
+    texture.blockDim = header.blockDim;
+
+    return offset == fileSize;
+  }
 
-  bool _ReadImage(const char* filePath, GiAssetReader& assetReader, ImgioImage* img)
+  bool _ReadTextureCacheFile(const fs::path& filePath, uint64_t key, GiAssetReader& cacheReader, GiDecodedTexture& texture)
   {
-    GiAsset* asset = assetReader.open(filePath);
+    GiAsset* asset = cacheReader.open(filePath.string().c_str());
     if (!asset)
     {
       return false;
     }
 
-    size_t size = assetReader.size(asset);
-    void* data = assetReader.data(asset);
+    const uint8_t* fileData = (const uint8_t*) cacheReader.data(asset);
+    if (!_ParseTextureCacheFile(fileData, cacheReader.size(asset), key, texture))
+    {
+      GB_WARN("ignoring invalid texture cache file {}", filePath.string());
+      cacheReader.close(asset);
+      return false;
+    }
 
-    bool loadResult = data && ImgioLoadImage(data, size, img) == ImgioError::None;
+    gbTouchFile(filePath.string());
 
-    assetReader.close(asset);
-    return loadResult;
+    // Level data points into the mapped file, which is released together with the texture
+    texture.cacheReader = &cacheReader;
+    texture.cacheAsset = asset;
+    return true;
+  }
+
+  void _WriteTextureCacheFile(const fs::path& filePath, uint64_t key, const GiDecodedTexture& texture)
+  {
+    const CgpuImageCreateInfo& createInfo = texture.createInfo;
+
+    TextureCacheFileHeader header {
+      .magic = TEXTURE_CACHE_FILE_MAGIC,
+      .version = TEXTURE_CACHE_VERSION,
+      .key = key,
+      .width = createInfo.width,
+      .height = createInfo.height,
+      .format = uint32_t(createInfo.format),
+      .components = {
+        uint32_t(createInfo.components.r),
+        uint32_t(createInfo.components.g),
+        uint32_t(createInfo.components.b),
+        uint32_t(createInfo.components.a)
+      },
+      .mipLevels = createInfo.mipLevels,
+      .blockDim = texture.blockDim,
+      .is3d = createInfo.is3d
+    };
+
+    std::vector<uint64_t> levelSizes;
+    for (std::span<const uint8_t> level : texture.levels)
+    {
+      levelSizes.push_back(level.size());
+    }
+
+    std::vector<std::span<const uint8_t>> chunks;
+    chunks.reserve(texture.levels.size() + 2);
+    chunks.push_back(std::span((const uint8_t*) &header, sizeof(header)));
+    chunks.push_back(std::span((const uint8_t*) levelSizes.data(), levelSizes.size() * sizeof(uint64_t)));
+    chunks.insert(chunks.end(), texture.levels.begin(), texture.levels.end());
+
+    if (!gbWriteFileAtomic(filePath.string(), chunks))
+    {
+      GB_ERROR("failed to write texture cache file {}", filePath.string());
+    }
   }
 }
 
 namespace gtl
 {
   GiTextureManager::GiTextureManager(CgpuDevice device, GiAssetReader& assetReader, GgpuStager& stager,
-                                     GgpuDelayedResourceDestroyer& delayedResourceDestroyer)
+                                     GgpuDelayedResourceDestroyer& delayedResourceDestroyer,
+                                     GiTextureCompression textureCompression,
+                                     const fs::path& cacheDir,
+                                     uint32_t maxTextureResolution)
     : m_device(device)
     , m_assetReader(assetReader)
     , m_stager(stager)
     , m_delayedResourceDestroyer(delayedResourceDestroyer)
+    , m_textureCompression(textureCompression)
+    , m_cacheDir(cacheDir)
+    , m_maxTextureResolution(maxTextureResolution)
   {
+    cgpuGetDeviceProperties(m_device, m_deviceProperties);
+
+    if (!m_cacheDir.empty())
+    {
+      std::error_code ec;
+      fs::create_directories(m_cacheDir, ec);
+
+      gbTrimDirectory(m_cacheDir.string(), ".gtex", MAX_TEXTURE_CACHE_DISK_SIZE);
+    }
   }
 
   void GiTextureManager::destroy()
@@ -85,51 +379,294 @@ namespace gtl
     m_binaryCache.clear();
   }
 
-  GiImagePtr GiTextureManager::loadTextureFromFilePath(const char* filePath, bool is3dImage, bool destroyImmediately)
+  GiImagePtr GiTextureManager::findCachedTexture(const char* filePath) const
   {
     auto cacheResult = m_fileCache.find(filePath);
 
-    if (cacheResult != m_fileCache.end())
+    if (cacheResult == m_fileCache.end())
     {
-      GiImagePtr image = cacheResult->second.lock();
+      return nullptr;
+    }
 
-      if (image)
+    GiImagePtr image = cacheResult->second.lock();
+
+    if (image)
+    {
+      GB_DEBUG("found image \"{}\" in cache", filePath);
+    }
+
+    return image;
+  }
+
+  bool GiTextureManager::decodeTexture(const char* filePath, bool is3dImage, GiDecodedTexture& texture) const
+  {
+    GiAsset* asset = m_assetReader.open(filePath);
+    if (!asset)
+    {
+      return false;
+    }
+
+    size_t size = m_assetReader.size(asset);
+    const void* data = m_assetReader.data(asset);
+
+    if (!data)
+    {
+      m_assetReader.close(asset);
+      return false;
+    }
+
+    uint32_t maxResolution = is3dImage ? 0 : m_maxTextureResolution;
+
+    // Reject unsupported files from the header alone, before hashing or decoding them.
+    ImgioImageInfo imageInfo;
+    if (ImgioProbe(data, size, &imageInfo) != ImgioError::None)
+    {
+      GB_ERROR("unsupported or corrupt image \"{}\"", filePath);
+      m_assetReader.close(asset);
+      return false;
+    }
+
+    uint32_t maxDimension = std::max(imageInfo.width, imageInfo.height);
+    if (maxResolution > 0)
+    {
+      maxDimension = std::min(maxDimension, maxResolution);
+    }
+
+    uint32_t maxDeviceDimension = is3dImage ? m_deviceProperties.maxImageDimension3D : m_deviceProperties.maxImageDimension2D;
+    if (maxDimension > maxDeviceDimension)
+    {
+      GB_ERROR("image \"{}\" exceeds device limit ({}x{} > {})", filePath, imageInfo.width, imageInfo.height, maxDeviceDimension);
+      m_assetReader.close(asset);
+      return false;
+    }
+
+    uint64_t cacheKey = 0;
+    fs::path cacheFilePath;
+
+    if (!m_cacheDir.empty())
+    {
+      cacheKey = _CalcTextureCacheKey(data, size, is3dImage, m_textureCompression, maxResolution);
+      cacheFilePath = m_cacheDir / GB_FMT("{:016x}.gtex", cacheKey);
+
+      if (_ReadTextureCacheFile(cacheFilePath, cacheKey, m_cacheReader, texture))
       {
-        GB_DEBUG("found image \"{}\" in cache", filePath);
-        return image;
+        m_assetReader.close(asset);
+
+        GB_LOG("read image \"{}\" from texture cache ({:.2f} MiB)", filePath, texture.size * BYTES_TO_MIB);
+
+        texture.createInfo.debugName = filePath;
+        return true;
       }
     }
 
     ImgioImage imageData;
-    if (!_ReadImage(filePath, m_assetReader, &imageData))
+    bool loadResult = ImgioLoadImage(data, size, &imageData, maxResolution) == ImgioError::None;
+
+    m_assetReader.close(asset);
+
+    if (!loadResult)
     {
-      return nullptr;
+      return false;
     }
 
     GB_LOG("read image \"{}\" ({:.2f} MiB)", filePath, imageData.size * BYTES_TO_MIB);
 
-    CgpuImageCreateInfo createInfo = {
+    CgpuImageCreateInfo& createInfo = texture.createInfo;
+    createInfo = {
       .width = imageData.width,
       .height = imageData.height,
       .is3d = is3dImage,
+      .mipLevels = is3dImage ? 1 : _CalcMipLevelCount(imageData.width, imageData.height),
+      .debugName = filePath
+    };
+    _GetImageFormat(imageData.format, createInfo.format, createInfo.components);
+
+    bool compress = (m_textureCompression != GiTextureCompression::None) && !is3dImage &&
+                    giBcSelectFormat(imageData, createInfo.format);
+
+    texture.blockDim = compress ? GI_BC_BLOCK_DIM : 1;
+    texture.levelStorage.resize(createInfo.mipLevels);
+    texture.levels.resize(createInfo.mipLevels);
+    texture.size = 0;
+
+    ImgioImage mipData;
+    for (uint32_t level = 0; level < createInfo.mipLevels; level++)
+    {
+      std::vector<uint8_t>& levelData = texture.levelStorage[level];
+
+      if (compress)
+      {
+        giBcEncodeImage(imageData, createInfo.format, m_textureCompression == GiTextureCompression::HighQuality, levelData);
+      }
+
+      if (level + 1 < createInfo.mipLevels)
+      {
+        ImgioGenerateMipLevel(imageData, &mipData);
+      }
+
+      // Uncompressed levels take over the decoded pixels instead of copying them.
+      if (!compress)
+      {
+        levelData = std::move(imageData.data);
+      }
+
+      std::swap(imageData, mipData);
+
+      texture.levels[level] = levelData;
+      texture.size += levelData.size();
+    }
+
+    if (!m_cacheDir.empty())
+    {
+      _WriteTextureCacheFile(cacheFilePath, cacheKey, texture);
+    }
+
+    return true;
+  }
+
+  size_t GiTextureManager::estimateDecodedTextureSize(const char* filePath, bool is3dImage) const
+  {
+    GiAsset* asset = m_assetReader.open(filePath);
+    if (!asset)
+    {
+      return 0;
+    }
+
+    size_t size = m_assetReader.size(asset);
+    const void* data = m_assetReader.data(asset);
+
+    ImgioImageInfo imageInfo;
+    bool probeResult = data && ImgioProbe(data, size, &imageInfo) == ImgioError::None;
+
+    m_assetReader.close(asset);
+
+    if (!probeResult)
+    {
+      return 0; // decoding fails early
+    }
+
+    return _EstimateDecodedSize(imageInfo, is3dImage, is3dImage ? 0 : m_maxTextureResolution);
+  }
+
+  GiImagePtr GiTextureManager::decodeTextureToStaging(const char* filePath, bool destroyImmediately)
+  {
+    GiAsset* asset = m_assetReader.open(filePath);
+    if (!asset)
+    {
+      return nullptr;
+    }
+
+    size_t size = m_assetReader.size(asset);
+    const void* data = m_assetReader.data(asset);
+
+    ImgioImageInfo imageInfo;
+    if (!data || ImgioProbe(data, size, &imageInfo) != ImgioError::None ||
+        std::max(imageInfo.width, imageInfo.height) > m_deviceProperties.maxImageDimension3D)
+    {
+      m_assetReader.close(asset);
+      return nullptr;
+    }
+
+    CgpuImageCreateInfo createInfo = {
+      .width = imageInfo.width,
+      .height = imageInfo.height,
+      .is3d = true,
       .debugName = filePath
     };
+    _GetImageFormat(imageInfo.format, createInfo.format, createInfo.components);
 
     GiImagePtr image = makeImagePtr(destroyImmediately);
 
-    bool creationSuccessful = cgpuCreateImage(m_device, createInfo, image.get()) &&
-                              m_stager.stageToImage(&imageData.data[0], imageData.size, *image, imageData.width, imageData.height, 1);
+    if (!cgpuCreateImage(m_device, createInfo, image.get()))
+    {
+      m_assetReader.close(asset);
+      return nullptr;
+    }
+
+    size_t rowPitch = imageInfo.width * ImgioGetFormatPixelSize(imageInfo.format);
+    uint64_t imageSize = rowPitch * imageInfo.height;
+
+    uint8_t* stagingMem = m_stager.reserveImage(imageSize);
+    if (!stagingMem)
+    {
+      m_assetReader.close(asset);
+      return nullptr;
+    }
+
+    bool decodeResult = ImgioDecodeImage(data, size, imageInfo, stagingMem, rowPitch) == ImgioError::None;
+
+    m_assetReader.close(asset);
+
+    if (!decodeResult)
+    {
+      m_stager.cancelImage();
+      return nullptr;
+    }
+
+    if (!m_stager.commitImage(*image, createInfo.width, createInfo.height))
+    {
+      return nullptr;
+    }
+
+    GB_LOG("read image \"{}\" into staging memory ({:.2f} MiB)", filePath, imageSize * BYTES_TO_MIB);
+
+    m_fileCache[filePath] = std::weak_ptr<CgpuImage>(image);
+
+    return image;
+  }
+
+  GiImagePtr GiTextureManager::uploadTexture(const char* filePath, const GiDecodedTexture& texture, bool destroyImmediately)
+  {
+    const CgpuImageCreateInfo& createInfo = texture.createInfo;
+
+    GiImagePtr image = makeImagePtr(destroyImmediately);
 
-    if (!creationSuccessful)
+    if (!cgpuCreateImage(m_device, createInfo, image.get()))
     {
       return nullptr;
     }
 
+    for (uint32_t level = 0; level < createInfo.mipLevels; level++)
+    {
+      std::span<const uint8_t> data = texture.levels[level];
+      uint32_t width = std::max(createInfo.width >> level, 1u);
+      uint32_t height = std::max(createInfo.height >> level, 1u);
+
+      if (!m_stager.stageToImage(data.data(), data.size(), *image, width, height, 1, level, texture.blockDim))
+      {
+        return nullptr;
+      }
+    }
+
     m_fileCache[filePath] = std::weak_ptr<CgpuImage>(image);
 
     return image;
   }
 
+  GiImagePtr GiTextureManager::loadTextureFromFilePath(const char* filePath, bool is3dImage, bool destroyImmediately)
+  {
+    if (GiImagePtr image = findCachedTexture(filePath); image)
+    {
+      return image;
+    }
+
+    if (_CanDecodeToStaging(is3dImage, m_cacheDir))
+    {
+      if (GiImagePtr image = decodeTextureToStaging(filePath, destroyImmediately); image)
+      {
+        return image;
+      }
+    }
+
+    GiDecodedTexture texture;
+    if (!decodeTexture(filePath, is3dImage, texture))
+    {
+      return nullptr;
+    }
+
+    return uploadTexture(filePath, texture, destroyImmediately);
+  }
+
   GiImagePtr GiTextureManager::makeImagePtr(bool destroyImmediately)
   {
     return std::shared_ptr<CgpuImage>(new CgpuImage, [=](CgpuImage* d) {
@@ -157,12 +694,80 @@ namespace gtl
 
     GB_LOG("staging {} images", texCount);
 
+    // Decode file textures in parallel, but upload them in order on this thread.
+    // The resulting references keep the images alive until they are collected below.
+    std::unordered_map<std::string, GiImagePtr> fileImages;
+    {
+      std::vector<const McTextureDescription*> decodeList;
+      for (const McTextureDescription& textureResource : textureDescriptions)
+      {
+        const std::string& filePath = textureResource.filePath;
+
+        if (filePath.empty() || fileImages.count(filePath) > 0)
+        {
+          continue;
+        }
+
+        GiImagePtr image = findCachedTexture(filePath.c_str());
+        if (!image && _CanDecodeToStaging(textureResource.is3dImage, m_cacheDir))
+        {
+          image = decodeTextureToStaging(filePath.c_str(), false);
+        }
+        if (!image)
+        {
+          decodeList.push_back(&textureResource);
+        }
+        fileImages[filePath] = image;
+      }
+
+      // Bound the memory of decoded but not yet uploaded textures. Windows are sized from the
+      // image headers; a single texture exceeding the budget is decoded on its own.
+      std::vector<size_t> decodedSizes(decodeList.size());
+      for (size_t i = 0; i < decodeList.size(); i++)
+      {
+        decodedSizes[i] = estimateDecodedTextureSize(decodeList[i]->filePath.c_str(), decodeList[i]->is3dImage);
+      }
+
+      size_t maxWindowSize = std::max(std::thread::hardware_concurrency(), 1u);
+
+      for (size_t begin = 0, end = 0; begin < decodeList.size(); begin = end)
+      {
+        size_t windowBytes = 0;
+        for (end = begin; end < decodeList.size() && (end - begin) < maxWindowSize; end++)
+        {
+          if (end > begin && (windowBytes + decodedSizes[end]) > MAX_IN_FLIGHT_DECODE_BYTES)
+          {
+            break;
+          }
+          windowBytes += decodedSizes[end];
+        }
+
+        std::vector<GiDecodedTexture> textures(end - begin);
+        std::vector<uint8_t> decodeResults(end - begin, 0);
+
+#pragma omp parallel for schedule(dynamic)
+        for (int j = 0; j < int(end - begin); j++)
+        {
+          const McTextureDescription* textureResource = decodeList[begin + j];
+          decodeResults[j] = decodeTexture(textureResource->filePath.c_str(), textureResource->is3dImage, textures[j]);
+        }
+
+        for (size_t j = 0; j < textures.size(); j++)
+        {
+          const char* filePath = decodeList[begin + j]->filePath.c_str();
+
+          if (decodeResults[j])
+          {
+            fileImages[filePath] = uploadTexture(filePath, textures[j], false);
+          }
+        }
+      }
+    }
+
     images.reserve(texCount);
 
     for (size_t i = 0; i < texCount; i++)
     {
-      fflush(stdout);
-
       auto& textureResource = textureDescriptions[i];
       auto& payload = textureResource.data;
 
@@ -220,7 +825,7 @@ namespace gtl
         continue;
       }
 
-      GiImagePtr image = loadTextureFromFilePath(filePath, textureResource.is3dImage);
+      GiImagePtr image = fileImages[filePath];
 
       if (image)
       {
@@ -17,6 +17,7 @@
 
 #pragma once
 
+#include <filesystem>
 #include <unordered_map>
 #include <string>
 #include <vector>
@@ -24,11 +25,16 @@
 #include <gtl/cgpu/Cgpu.h>
 #include <gtl/mc/Backend.h>
 
+#include <Gi.h>
+
+#include "AssetReader.h"
+
 namespace gtl
 {
   class GgpuDelayedResourceDestroyer;
   class GgpuStager;
   class GiAssetReader;
+  struct GiDecodedTexture;
 
   using GiImagePtr = std::shared_ptr<CgpuImage>;
 
@@ -36,7 +42,10 @@ namespace gtl
   {
   public:
     GiTextureManager(CgpuDevice device, GiAssetReader& assetReader, gtl::GgpuStager& stager,
-                     GgpuDelayedResourceDestroyer& delayedResourceDestroyer);
+                     GgpuDelayedResourceDestroyer& delayedResourceDestroyer,
+                     GiTextureCompression textureCompression = GiTextureCompression::None,
+                     const std::filesystem::path& cacheDir = {}, // cache disabled if empty
+                     uint32_t maxTextureResolution = 0); // unlimited if 0
 
     void housekeep();
 
@@ -53,11 +62,30 @@ namespace gtl
   private:
     GiImagePtr makeImagePtr(bool destroyImmediately = false);
 
+    GiImagePtr findCachedTexture(const char* filePath) const;
+
+    // Thread-safe; does not touch the GPU. Reads and writes the disk cache; concurrent
+    // writes of the same entry are safe because cache files are replaced atomically.
+    bool decodeTexture(const char* filePath, bool is3dImage, GiDecodedTexture& texture) const;
+
+    // Reads the image header only; returns 0 if the file is unsupported.
+    size_t estimateDecodedTextureSize(const char* filePath, bool is3dImage) const;
+
+    // Fast path without intermediate copies; returns nullptr if the texture could not be staged.
+    GiImagePtr decodeTextureToStaging(const char* filePath, bool destroyImmediately);
+
+    GiImagePtr uploadTexture(const char* filePath, const GiDecodedTexture& texture, bool destroyImmediately);
+
   private:
     CgpuDevice m_device;
     GiAssetReader& m_assetReader;
     gtl::GgpuStager& m_stager;
     GgpuDelayedResourceDestroyer& m_delayedResourceDestroyer;
+    GiTextureCompression m_textureCompression;
+    std::filesystem::path m_cacheDir;
+    mutable GiMmapAssetReader m_cacheReader;
+    uint32_t m_maxTextureResolution;
+    CgpuDeviceProperties m_deviceProperties;
     std::unordered_map<std::string, std::weak_ptr<CgpuImage>> m_fileCache;
     std::unordered_map<uint64_t, std::weak_ptr<CgpuImage>> m_binaryCache;
   };
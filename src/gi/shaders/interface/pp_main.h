@@ -0,0 +1,60 @@
+//
+// Copyright (C) 2023 Pablo Delgado Krämer
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef PP_MAIN_H
+#define PP_MAIN_H
+
+#include "interface/gtl.h"
+
+GI_INTERFACE_BEGIN(pp_main)
+
+const GI_UINT WORKGROUP_SIZE_X = 8;
+const GI_UINT WORKGROUP_SIZE_Y = 8;
+
+const GI_UINT MODE_COLOR = 0;
+const GI_UINT MODE_HEATMAP_MAX = 1; // first pass
+const GI_UINT MODE_HEATMAP = 2;
+
+const GI_UINT OUTPUT_FORMAT_FLOAT32 = 0;
+const GI_UINT OUTPUT_FORMAT_FLOAT16 = 1;
+const GI_UINT OUTPUT_FORMAT_UNORM8 = 2;
+
+const GI_UINT TONE_MAPPING_NONE = 0;
+const GI_UINT TONE_MAPPING_REINHARD = 1;
+const GI_UINT TONE_MAPPING_ACES_FILMIC = 2;
+
+const GI_UINT DISPLAY_TRANSFORM_LINEAR = 0;
+const GI_UINT DISPLAY_TRANSFORM_SRGB = 1;
+
+struct PushConstants
+{
+  GI_UINT64 inputAddress; // vec4 per pixel
+  GI_UINT64 outputAddress;
+  GI_UINT64 maxValueAddress; // uint, heatmap only
+  GI_UINT   imageWidth;
+  GI_UINT   imageHeight;
+  GI_UINT   mode;
+  GI_UINT   outputFormat;
+  GI_FLOAT  exposureMultiplier;
+  GI_UINT   toneMapping;
+  GI_UINT   displayTransform;
+  GI_UINT   padding;
+};
+
+GI_INTERFACE_END()
+
+#endif
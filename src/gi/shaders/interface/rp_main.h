@@ -111,9 +111,13 @@ struct PushConstants
   GI_FLOAT sensorExposure;
   GI_UINT  maxVolumeWalkLength; // NOTE: can be quantized
   GI_FLOAT metersPerSceneUnit;
-  /* 1 float free */
+  GI_UINT  aovMaskAndFlags; // AOV bits in lower half, PC_FLAG_* in upper half
 };
 
+const GI_UINT PC_FLAG_NEXT_EVENT_ESTIMATION = (1 << 16); // lowest flag bit; GiAovId must fit below
+const GI_UINT PC_FLAG_NORMALS_FLOAT16 = (1 << 17);
+const GI_UINT PC_FLAG_NORMALS_PACKED = (1 << 18);
+
 const GI_UINT BLAS_PAYLOAD_BITFLAG_FLIP_FACING = (1 << 0);
 const GI_UINT BLAS_PAYLOAD_BITFLAG_DOUBLE_SIDED = (1 << 1);
 
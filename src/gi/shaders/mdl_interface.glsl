@@ -5,6 +5,11 @@
 
 // See also: https://github.com/NVIDIA/MDL-SDK/blob/master/examples/mdl_sdk/dxr/content/mdl_renderer_runtime.hlsl
 
+// UV gradients along the axes of the ray cone footprint, for anisotropic filtering.
+// Set during shading state setup; the default selects the finest mip level.
+vec2 tex_grad_1 = vec2(0.0);
+vec2 tex_grad_2 = vec2(0.0);
+
 float apply_wrap_and_crop(float coord, int wrap, vec2 crop, int res)
 {
     if (wrap == TEX_WRAP_REPEAT)
@@ -140,8 +145,11 @@ vec4 tex_lookup_float4_2d(int tex, vec2 coord, int wrap_u, int wrap_v, vec2 crop
     coord.x = apply_wrap_and_crop(coord.x, wrap_u, crop_u, res.x);
     coord.y = apply_wrap_and_crop(coord.y, wrap_v, crop_v, res.y);
 
+    vec2 crop_scale = vec2(crop_u.y - crop_u.x, crop_v.y - crop_v.x);
+
     ASSERT(array_idx < sceneParams.textureCount, "Error: invalid texture index\n");
-    return texture(sampler2D(textures_2d[nonuniformEXT(array_idx)], tex_sampler), coord);
+    return textureGrad(sampler2D(textures_2d[nonuniformEXT(array_idx)], tex_sampler), coord,
+                       tex_grad_1 * crop_scale, tex_grad_2 * crop_scale);
 }
 
 vec3 tex_lookup_float3_2d(int tex, vec2 coord, int wrap_u, int wrap_v, vec2 crop_u, vec2 crop_v, float frame)
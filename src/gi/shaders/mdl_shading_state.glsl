@@ -1,7 +1,7 @@
 #ifndef MDL_SHADING_STATE
 #define MDL_SHADING_STATE
 
-void setup_mdl_shading_state(in vec2 hit_bc, out State state, out bool isFrontFace)
+void setup_mdl_shading_state(in vec2 hit_bc, in float coneWidth, out State state, out bool isFrontFace, out float curvature)
 {
     BlasPayload payload = blas_payloads[gl_InstanceCustomIndexEXT];
     IndexBuffer indices = IndexBuffer(payload.bufferAddress);
@@ -63,6 +63,43 @@ void setup_mdl_shading_state(in vec2 hit_bc, out State state, out bool isFrontFa
     vec2 uv_2 = vec2(v_2.field2.z, v_2.field2.w);
     vec2 uv = bc.x * uv_0 + bc.y * uv_1 + bc.z * uv_2;
 
+    // Anisotropic ray cone texture gradients and curvature estimate, cmp. Akenine-Möller et al.:
+    // "Improved Shader and Texture Level of Detail Using Ray Cones" (JCGT 2021)
+    mat3 objectToWorld = mat3(gl_ObjectToWorldEXT);
+    vec3 e_1 = objectToWorld * (p_1 - p_0);
+    vec3 e_2 = objectToWorld * (p_2 - p_0);
+    vec3 e_3 = e_2 - e_1;
+
+    vec3 worldCross = cross(e_1, e_2);
+    float worldArea = length(worldCross);
+    vec2 uvEdge_1 = uv_1 - uv_0;
+    vec2 uvEdge_2 = uv_2 - uv_0;
+    float uvArea = abs(uvEdge_1.x * uvEdge_2.y - uvEdge_2.x * uvEdge_1.y);
+
+    if (coneWidth > 0.0 && worldArea > 0.0 && uvArea > 0.0)
+    {
+        vec3 rayDir = normalize(gl_WorldRayDirectionEXT);
+        vec3 faceNormal = worldCross / worldArea;
+
+        // Axes of the ellipse in which the cone intersects the triangle plane. The major axis lies
+        // along the projected ray direction; at normal incidence the footprint is a circle.
+        vec3 a_1 = rayDir - dot(faceNormal, rayDir) * faceNormal;
+        a_1 = (dot(a_1, a_1) > 1e-12) ? normalize(a_1) : normalize(e_1);
+        vec3 a_2 = cross(faceNormal, a_1);
+
+        // Scale both so that their extent perpendicular to the ray matches the cone width.
+        a_1 *= coneWidth / max(1e-3, length(a_1 - dot(rayDir, a_1) * rayDir));
+        a_2 *= coneWidth / max(1e-3, length(a_2 - dot(rayDir, a_2) * rayDir));
+
+        // Map the axes to UV space through the barycentrics of their end points.
+        tex_grad_1 = (dot(faceNormal, cross(a_1, e_2)) * uvEdge_1 + dot(faceNormal, cross(e_1, a_1)) * uvEdge_2) / worldArea;
+        tex_grad_2 = (dot(faceNormal, cross(a_2, e_2)) * uvEdge_1 + dot(faceNormal, cross(e_1, a_2)) * uvEdge_2) / worldArea;
+    }
+
+    curvature = max(safe_div(length(n_1 - n_0), length(e_1)),
+                max(safe_div(length(n_2 - n_0), length(e_2)),
+                    safe_div(length(n_2 - n_1), length(e_3))));
+
 #if SCENE_DATA_COUNT > 0
     BlasPayloadBufferPreamble preamble = indices.preamble;
 
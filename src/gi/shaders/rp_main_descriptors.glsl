@@ -21,54 +21,25 @@ layout(binding = BINDING_INDEX_INSTANCE_IDS, std430) readonly buffer InstanceIds
 layout(binding = BINDING_INDEX_AOV_CLEAR_VALUES_F, std430) readonly buffer ClearValueBufferF { vec4 ClearValuesF[]; };
 layout(binding = BINDING_INDEX_AOV_CLEAR_VALUES_I, std430) readonly buffer ClearValueBufferI { ivec4 ClearValuesI[]; };
 
-#if (AOV_MASK & AOV_BIT_COLOR) != 0
+// AOV buffers are always declared because hit shaders test the AOV mask at runtime.
+// Color is always accumulated in full precision; compact formats are converted by pp_main.
+// Normals are stored as raw words; their format is selected with PC_FLAG_NORMALS_* at runtime.
 layout(binding = BINDING_INDEX_AOV_COLOR, std430) buffer Framebuffer { vec4 ColorAov[]; };
-#endif
-#if (AOV_MASK & AOV_BIT_NORMAL) != 0
-layout(binding = BINDING_INDEX_AOV_NORMAL, std430) writeonly buffer NormalBuffer { vec3 NormalsAov[]; };
-#endif
-#if (AOV_MASK & AOV_BIT_DEBUG_NEE) != 0
-layout(binding = BINDING_INDEX_AOV_NEE, std430) writeonly writeonly buffer NeeBuffer { vec3 NeeAov[]; };
-#endif
-#if (AOV_MASK & AOV_BIT_DEBUG_BARYCENTRICS) != 0
+layout(binding = BINDING_INDEX_AOV_NORMAL, std430) writeonly buffer NormalBuffer { uint NormalsAov[]; };
+layout(binding = BINDING_INDEX_AOV_NEE, std430) writeonly buffer NeeBuffer { vec3 NeeAov[]; };
 layout(binding = BINDING_INDEX_AOV_BARYCENTRICS, std430) writeonly buffer BarycentricsBuffer { vec3 BarycentricsAov[]; };
-#endif
-#if (AOV_MASK & AOV_BIT_DEBUG_TEXCOORDS) != 0
 layout(binding = BINDING_INDEX_AOV_TEXCOORDS, std430) writeonly buffer TexcoordsBuffer { vec3 TexcoordsAov[]; };
-#endif
-#if (AOV_MASK & AOV_BIT_DEBUG_BOUNCES) != 0
 layout(binding = BINDING_INDEX_AOV_BOUNCES, std430) writeonly buffer BouncesBuffer { vec3 BouncesAov[]; };
-#endif
-#if (AOV_MASK & AOV_BIT_DEBUG_CLOCK_CYCLES) != 0
 layout(binding = BINDING_INDEX_AOV_CLOCK_CYCLES, std430) writeonly buffer ClockCyclesBuffer { uvec3 ClockCyclesAov[]; };
-#endif
-#if (AOV_MASK & AOV_BIT_DEBUG_OPACITY) != 0
 layout(binding = BINDING_INDEX_AOV_OPACITY, std430) writeonly buffer OpacityBuffer { vec3 OpacityAov[]; };
-#endif
-#if (AOV_MASK & AOV_BIT_DEBUG_TANGENTS) != 0
 layout(binding = BINDING_INDEX_AOV_TANGENTS, std430) writeonly buffer TangentsBuffer { vec3 TangentsAov[]; };
-#endif
-#if (AOV_MASK & AOV_BIT_DEBUG_BITANGENTS) != 0
 layout(binding = BINDING_INDEX_AOV_BITANGENTS, std430) writeonly buffer BitangentsBuffer { vec3 BitangentsAov[]; };
-#endif
-#if (AOV_MASK & AOV_BIT_DEBUG_THIN_WALLED) != 0
 layout(binding = BINDING_INDEX_AOV_THIN_WALLED, std430) writeonly buffer ThinWalledBuffer { vec3 ThinWalledAov[]; };
-#endif
-#if (AOV_MASK & AOV_BIT_OBJECT_ID) != 0
 layout(binding = BINDING_INDEX_AOV_OBJECT_ID, std430) writeonly buffer ObjectIdBuffer { int ObjectIdAov[]; };
-#endif
-#if (AOV_MASK & AOV_BIT_DEPTH) != 0
 layout(binding = BINDING_INDEX_AOV_DEPTH, std430) writeonly buffer DepthBuffer { float DepthAov[]; };
-#endif
-#if (AOV_MASK & AOV_BIT_FACE_ID) != 0
 layout(binding = BINDING_INDEX_AOV_FACE_ID, std430) writeonly buffer FaceIdBuffer { int FaceIdAov[]; };
-#endif
-#if (AOV_MASK & AOV_BIT_INSTANCE_ID) != 0
 layout(binding = BINDING_INDEX_AOV_INSTANCE_ID, std430) writeonly buffer InstanceIdBuffer { int InstanceIdAov[]; };
-#endif
-#if (AOV_MASK & AOV_BIT_DEBUG_DOUBLE_SIDED) != 0
 layout(binding = BINDING_INDEX_AOV_DOUBLE_SIDED, std430) writeonly buffer DoubleSidedBuffer { vec3 DoubleSidedAov[]; };
-#endif
 
 layout(set = 1, binding = BINDING_INDEX_TEXTURES) uniform texture2D textures_2d[MAX_TEXTURE_COUNT];
 
@@ -87,3 +58,24 @@ layout(buffer_reference, std430, buffer_reference_align = 32/* largest type: ver
 layout(buffer_reference, std430, buffer_reference_align = 4) buffer RawIntBuffer { int data[]; };
 
 layout(push_constant) uniform PushConstantBlock { PushConstants PC; };
+
+// Expects values in [0, 1]. The packed format stores the octahedral encoding of the normal.
+void storeNormalAov(uint pixelIndex, vec3 value)
+{
+  if ((PC.aovMaskAndFlags & PC_FLAG_NORMALS_PACKED) != 0)
+  {
+    vec3 normal = value * 2.0 - 1.0;
+    NormalsAov[pixelIndex] = (dot(normal, normal) > 0.0) ? encode_direction(normal) : 0u;
+  }
+  else if ((PC.aovMaskAndFlags & PC_FLAG_NORMALS_FLOAT16) != 0)
+  {
+    NormalsAov[pixelIndex * 2 + 0] = packHalf2x16(value.xy);
+    NormalsAov[pixelIndex * 2 + 1] = packHalf2x16(vec2(value.z, 0.0));
+  }
+  else
+  {
+    NormalsAov[pixelIndex * 4 + 0] = floatBitsToUint(value.x);
+    NormalsAov[pixelIndex * 4 + 1] = floatBitsToUint(value.y);
+    NormalsAov[pixelIndex * 4 + 2] = floatBitsToUint(value.z);
+  }
+}
@@ -33,6 +33,8 @@ struct ShadeRayPayload
 
     /* inout */ RNG_STATE_TYPE rng_state;
 
+    /* inout */ vec2 cone; // x: width, y: spread angle
+
 #if MEDIUM_STACK_SIZE > 0
     /* inout */ Medium media[MEDIUM_STACK_SIZE];
     /* inout */ vec3 walkSegmentPdf;
@@ -278,8 +278,7 @@ namespace
     }
   }
 
-  void _BakeMeshGeometry(_VertexStreams& s,
-                         std::vector<GiFace>& faces,
+  void _BakeMeshVertices(_VertexStreams& s,
                          std::vector<GiVertex>& vertices)
   {
     bool hasTexCoords = s.texCoords.size() > 0;
@@ -303,17 +302,7 @@ namespace
       _CalculateTangents(s.faces, s.points, s.normals, s.texCoords, s.tangents, s.bitangentSigns);
     }
 
-    for (size_t i = 0; i < s.faces.size(); i++)
-    {
-      const GfVec3i& vertexIndices = s.faces[i];
-
-      GiFace face;
-      face.v_i[0] = vertexIndices[0];
-      face.v_i[1] = vertexIndices[1];
-      face.v_i[2] = vertexIndices[2];
-
-      faces.push_back(face);
-    }
+    vertices.reserve(s.points.size());
 
     for (size_t j = 0; j < s.points.size(); j++)
     {
@@ -463,6 +452,7 @@ void HdGatlingMesh::Finalize(HdRenderParam* renderParam)
   {
     giDestroyMesh(m);
   }
+  _bakedTopology.reset();
 }
 
 void HdGatlingMesh::Sync(HdSceneDelegate* sceneDelegate,
@@ -479,13 +469,25 @@ void HdGatlingMesh::Sync(HdSceneDelegate* sceneDelegate,
 
   const SdfPath& id = GetId();
 
-  bool updateGeometry =
+  bool updateVertices =
     (*dirtyBits & HdChangeTracker::DirtyPoints) |
-    (*dirtyBits & HdChangeTracker::DirtyNormals) |
+    (*dirtyBits & HdChangeTracker::DirtyNormals);
+
+  bool updateGeometry =
     (*dirtyBits & HdChangeTracker::DirtyPrimvar) |
     (*dirtyBits & HdChangeTracker::DirtyTopology) |
     (*dirtyBits & HdChangeTracker::DirtyComputationPrimvarDesc);
 
+  // Deforming meshes keep their topology: only rewrite the vertices and refit the BLAS
+  if (updateVertices && !updateGeometry && (_baseMesh || !_subMeshes.empty()))
+  {
+    updateGeometry = !_UpdateGiMeshVertices(sceneDelegate);
+  }
+  else
+  {
+    updateGeometry |= updateVertices;
+  }
+
   if (updateGeometry)
   {
     if (_baseMesh)
@@ -823,20 +825,10 @@ std::vector<GiPrimvarData> HdGatlingMesh::_CollectSecondaryPrimvars(const Primva
   return result;
 }
 
-void HdGatlingMesh::_CreateGiMeshes(HdSceneDelegate* sceneDelegate)
+bool HdGatlingMesh::_GetAuthoredPoints(HdSceneDelegate* sceneDelegate, VtVec3fArray& points)
 {
   const SdfPath& id = GetId();
 
-  VtVec3iArray faces;
-
-  // Faces
-  const HdMeshTopology& topology = GetMeshTopology(sceneDelegate);
-  HdMeshUtil meshUtil(&topology, id);
-
-  VtIntArray primitiveParams;
-  meshUtil.ComputeTriangleIndices(&faces, &primitiveParams);
-  auto faceCount = uint32_t(faces.size());
-
   // Points (required; vertex interpolation)
   VtValue boxedPoints;
 
@@ -875,44 +867,94 @@ void HdGatlingMesh::_CreateGiMeshes(HdSceneDelegate* sceneDelegate)
   if (boxedPoints.IsEmpty() || !boxedPoints.IsHolding<VtVec3fArray>())
   {
     TF_RUNTIME_ERROR("Points primvar not found (%s)", id.GetText());
-    return;
+    return false;
   }
 
-  // Analyze primvars
-  bool foundNormals;
-  bool useIndexing;
-  _AnalyzePrimvars(sceneDelegate, foundNormals, useIndexing);
+  points = boxedPoints.UncheckedGet<VtVec3fArray>();
+  return true;
+}
+
+void HdGatlingMesh::_BakeGiMeshVertices(const VtVec3fArray& authoredPoints,
+                                        VtVec3fArray normals,
+                                        std::vector<GiVertex>& giVertices)
+{
+  const BakedTopology& t = *_bakedTopology;
 
   // Generate fallback normals on original points
-  VtVec3fArray normals;
-  if (!foundNormals)
+  if (!t.foundNormals)
   {
-    VtVec3fArray points = boxedPoints.UncheckedGet<VtVec3fArray>();
-
-    Hd_VertexAdjacency adjacency;
-    adjacency.BuildAdjacencyTable(&topology);
-    normals = Hd_SmoothNormals::ComputeSmoothNormals(&adjacency, points.size(), points.cdata());
-    TF_AXIOM(normals.size() == points.size());
+    normals = Hd_SmoothNormals::ComputeSmoothNormals(&t.adjacency, authoredPoints.size(), authoredPoints.cdata());
+    TF_AXIOM(normals.size() == authoredPoints.size());
 
-    if (!useIndexing)
+    if (!t.indexingAllowed)
     {
       HdVtBufferSource buffer(HdTokens->normals, VtValue(normals));
-      normals = _DeindexBufferElements(HdTypeFloatVec3, buffer, faces).Get<VtVec3fArray>();
+      normals = _DeindexBufferElements(HdTypeFloatVec3, buffer, t.faces).Get<VtVec3fArray>();
     }
   }
 
-  // Deindex points and process primvars
-  if (!useIndexing)
+  // Deindex points
+  VtVec3fArray points = authoredPoints;
+  if (!t.indexingAllowed)
+  {
+    HdVtBufferSource buffer(HdTokens->points, VtValue(authoredPoints));
+    points = _DeindexBufferElements(HdTypeFloatVec3, buffer, t.faces).Get<VtVec3fArray>();
+  }
+
+  // Collect vertices. Tangents are recalculated unless they have been authored.
+  _VertexStreams s = {
+    .faces = t.bakedFaces,
+    .points = points,
+    .normals = normals,
+    .texCoords = t.texCoords,
+    .tangents = t.tangents,
+    .bitangentSigns = t.bitangentSigns,
+  };
+
+  _BakeMeshVertices(s, giVertices);
+}
+
+bool HdGatlingMesh::_BakeGiMeshGeometry(HdSceneDelegate* sceneDelegate,
+                                        const HdMeshTopology& topology,
+                                        PrimvarMap& primvarMap,
+                                        std::vector<GiFace>& giFaces,
+                                        std::vector<GiVertex>& giVertices)
+{
+  const SdfPath& id = GetId();
+
+  _bakedTopology.reset();
+
+  VtVec3fArray authoredPoints;
+  if (!_GetAuthoredPoints(sceneDelegate, authoredPoints))
+  {
+    return false;
+  }
+
+  BakedTopology& t = _bakedTopology.emplace();
+  t.pointCount = authoredPoints.size();
+
+  // Faces
+  HdMeshUtil meshUtil(&topology, id);
+
+  meshUtil.ComputeTriangleIndices(&t.faces, &t.primitiveParams);
+  auto faceCount = uint32_t(t.faces.size());
+
+  // Analyze primvars
+  _AnalyzePrimvars(sceneDelegate, t.foundNormals, t.indexingAllowed);
+
+  if (!t.foundNormals)
   {
-    HdVtBufferSource buffer(HdTokens->points, boxedPoints);
-    boxedPoints = _DeindexBufferElements(HdTypeFloatVec3, buffer, faces);
+    t.adjacency.BuildAdjacencyTable(&topology);
   }
-  VtVec3fArray points = boxedPoints.UncheckedGet<VtVec3fArray>();
 
-  PrimvarMap primvarMap = _ProcessPrimvars(sceneDelegate, primitiveParams, faces, points.size(), useIndexing);
+  // Process primvars
+  size_t vertexCount = t.indexingAllowed ? authoredPoints.size() : (faceCount * 3);
+
+  primvarMap = _ProcessPrimvars(sceneDelegate, t.primitiveParams, t.faces, vertexCount, t.indexingAllowed);
 
   // Use normals if authored
-  if (foundNormals)
+  VtVec3fArray normals;
+  if (t.foundNormals)
   {
     auto normalsIt = primvarMap.find(HdTokens->normals);
     TF_AXIOM(normalsIt != primvarMap.end());
@@ -945,19 +987,15 @@ void HdGatlingMesh::_CreateGiMeshes(HdSceneDelegate* sceneDelegate)
     }
   }
 
-  VtVec2fArray texCoords;
   if (!texcoordPrimvarName.IsEmpty())
   {
     const ProcessedPrimvar& pt = primvarMap[texcoordPrimvarName];
     TF_VERIFY(pt.type == HdTypeFloatVec2);
 
-    texCoords = pt.indexMatchingData.Get<VtVec2fArray>();
+    t.texCoords = pt.indexMatchingData.Get<VtVec2fArray>();
   }
 
   // Tangents. Although barely used in practice.
-  VtVec3fArray tangents;
-  VtFloatArray bitangentSigns;
-
   auto tangentsIt = primvarMap.find(_tokens->tangents);
   if (tangentsIt != primvarMap.end())
   {
@@ -966,18 +1004,18 @@ void HdGatlingMesh::_CreateGiMeshes(HdSceneDelegate* sceneDelegate)
     if (pt.type == HdTypeFloatVec4)
     {
       VtVec4fArray vec4Tangents = pt.indexMatchingData.Get<VtVec4fArray>();
-      tangents.resize(vec4Tangents.size());
-      bitangentSigns.resize(vec4Tangents.size());
+      t.tangents.resize(vec4Tangents.size());
+      t.bitangentSigns.resize(vec4Tangents.size());
 
       for (size_t i = 0; i < vec4Tangents.size(); i++)
       {
-        tangents[i] = GfVec3f(vec4Tangents[i].data());
-        bitangentSigns[i] = vec4Tangents[i][3];
+        t.tangents[i] = GfVec3f(vec4Tangents[i].data());
+        t.bitangentSigns[i] = vec4Tangents[i][3];
       }
     }
     else if (pt.type == HdTypeFloatVec3)
     {
-      tangents = pt.indexMatchingData.Get<VtVec3fArray>();
+      t.tangents = pt.indexMatchingData.Get<VtVec3fArray>();
 
       auto bitangentSignsIt = primvarMap.find(_tokens->bitangentSigns);
       if (bitangentSignsIt != primvarMap.end())
@@ -986,7 +1024,7 @@ void HdGatlingMesh::_CreateGiMeshes(HdSceneDelegate* sceneDelegate)
 
         if (pb.type == HdTypeFloat)
         {
-          bitangentSigns = pb.indexMatchingData.Get<VtFloatArray>();
+          t.bitangentSigns = pb.indexMatchingData.Get<VtFloatArray>();
         }
       }
     }
@@ -997,27 +1035,49 @@ void HdGatlingMesh::_CreateGiMeshes(HdSceneDelegate* sceneDelegate)
   }
 
   // Deindex faces
-  if (!useIndexing)
+  t.bakedFaces = t.faces;
+  if (!t.indexingAllowed)
   {
     for (uint32_t i = 0; i < faceCount; i++)
     {
-      faces[i] = GfVec3i(i * 3 + 0, i * 3 + 1, i * 3 + 2);
+      t.bakedFaces[i] = GfVec3i(i * 3 + 0, i * 3 + 1, i * 3 + 2);
     }
   }
 
   // Collect vertices and indices
-  _VertexStreams s = {
-    .faces = faces,
-    .points = points,
-    .normals = normals,
-    .texCoords = texCoords,
-    .tangents = tangents,
-    .bitangentSigns = bitangentSigns,
-  };
+  giFaces.reserve(faceCount);
+  for (const GfVec3i& vertexIndices : t.bakedFaces)
+  {
+    GiFace face;
+    face.v_i[0] = vertexIndices[0];
+    face.v_i[1] = vertexIndices[1];
+    face.v_i[2] = vertexIndices[2];
+
+    giFaces.push_back(face);
+  }
+
+  _BakeGiMeshVertices(authoredPoints, normals, giVertices);
+
+  return true;
+}
+
+void HdGatlingMesh::_CreateGiMeshes(HdSceneDelegate* sceneDelegate)
+{
+  const SdfPath& id = GetId();
+
+  const HdMeshTopology& topology = GetMeshTopology(sceneDelegate);
 
+  PrimvarMap primvarMap;
   std::vector<GiFace> giFaces;
   std::vector<GiVertex> giVertices;
-  _BakeMeshGeometry(s, giFaces, giVertices);
+  if (!_BakeGiMeshGeometry(sceneDelegate, topology, primvarMap, giFaces, giVertices))
+  {
+    return;
+  }
+
+  const VtIntArray& primitiveParams = _bakedTopology->primitiveParams;
+
+  auto faceCount = uint32_t(giFaces.size());
 
   // Collect secondary primvars
   std::vector<GiPrimvarData> secondaryPrimvars = _CollectSecondaryPrimvars(primvarMap);
@@ -1126,6 +1186,63 @@ void HdGatlingMesh::_CreateGiMeshes(HdSceneDelegate* sceneDelegate)
   }
 }
 
+bool HdGatlingMesh::_UpdateGiMeshVertices(HdSceneDelegate* sceneDelegate)
+{
+  if (!_bakedTopology.has_value())
+  {
+    return false;
+  }
+
+  const BakedTopology& t = *_bakedTopology;
+
+  VtVec3fArray authoredPoints;
+  if (!_GetAuthoredPoints(sceneDelegate, authoredPoints) || authoredPoints.size() != t.pointCount)
+  {
+    return false;
+  }
+
+  // Only the normals primvar is processed again; the triangulation is reused
+  VtVec3fArray normals;
+  if (t.foundNormals)
+  {
+    size_t vertexCount = t.indexingAllowed ? t.pointCount : (t.faces.size() * 3);
+
+    std::optional<ProcessedPrimvar> pn;
+    for (int i = 0; i < int(HdInterpolationCount) && !pn.has_value(); i++)
+    {
+      for (const HdPrimvarDescriptor& primvar : GetPrimvarDescriptors(sceneDelegate, (HdInterpolation) i))
+      {
+        if (primvar.name == HdTokens->normals)
+        {
+          pn = _ProcessPrimvar(sceneDelegate, t.primitiveParams, primvar, t.faces, vertexCount, t.indexingAllowed, true);
+          break;
+        }
+      }
+    }
+
+    if (!pn.has_value() || pn->type != HdTypeFloatVec3)
+    {
+      return false;
+    }
+
+    normals = pn->indexMatchingData.Get<VtVec3fArray>();
+  }
+
+  std::vector<GiVertex> giVertices;
+  _BakeGiMeshVertices(authoredPoints, normals, giVertices);
+
+  bool success = true;
+  if (_baseMesh)
+  {
+    success &= giUpdateMeshVertices(_baseMesh, giVertices);
+  }
+  for (GiMesh* m : _subMeshes)
+  {
+    success &= giUpdateMeshVertices(m, giVertices);
+  }
+  return success;
+}
+
 HdDirtyBits HdGatlingMesh::GetInitialDirtyBitsMask() const
 {
   return HdChangeTracker::DirtyPoints |
@@ -18,6 +18,7 @@
 #pragma once
 
 #include <pxr/imaging/hd/mesh.h>
+#include <pxr/imaging/hd/vertexAdjacency.h>
 #include <pxr/base/gf/vec2f.h>
 
 #include <gtl/gi/Gi.h>
@@ -82,9 +83,40 @@ private:
                               uint32_t vertexCount,
                               bool indexingAllowed);
 
+  bool _GetAuthoredPoints(HdSceneDelegate* sceneDelegate, VtVec3fArray& points);
+
+  void _BakeGiMeshVertices(const VtVec3fArray& authoredPoints,
+                           VtVec3fArray normals,
+                           std::vector<GiVertex>& giVertices);
+
+  bool _BakeGiMeshGeometry(HdSceneDelegate* sceneDelegate,
+                           const HdMeshTopology& topology,
+                           PrimvarMap& primvarMap,
+                           std::vector<GiFace>& giFaces,
+                           std::vector<GiVertex>& giVertices);
+
   void _CreateGiMeshes(HdSceneDelegate* sceneDelegate);
 
+  bool _UpdateGiMeshVertices(HdSceneDelegate* sceneDelegate);
+
 private:
+  // Vertex streams that only change with the topology, kept for deforming meshes
+  struct BakedTopology
+  {
+    VtVec3iArray faces; // triangulated, indexing authored points
+    VtVec3iArray bakedFaces; // indexing baked vertices
+    VtIntArray primitiveParams;
+    size_t pointCount;
+    bool foundNormals;
+    bool indexingAllowed;
+    Hd_VertexAdjacency adjacency; // only built for fallback normals
+    VtVec2fArray texCoords;
+    VtVec3fArray tangents; // empty if not authored
+    VtFloatArray bitangentSigns;
+  };
+
+  std::optional<BakedTopology> _bakedTopology;
+
   GiMesh* _baseMesh = nullptr;
   std::vector<GiMesh*> _subMeshes;
 
@@ -30,7 +30,9 @@ namespace
   static std::map<HdFormat, GiRenderBufferFormat> s_supportedRenderBufferFormats = {
     { HdFormatInt32, GiRenderBufferFormat::Int32 },
     { HdFormatFloat32, GiRenderBufferFormat::Float32 },
-    { HdFormatFloat32Vec4, GiRenderBufferFormat::Float32Vec4 }
+    { HdFormatFloat32Vec4, GiRenderBufferFormat::Float32Vec4 },
+    { HdFormatFloat16Vec4, GiRenderBufferFormat::Float16Vec4 },
+    { HdFormatUNorm8Vec4, GiRenderBufferFormat::UNorm8Vec4 }
   };
 }
 
@@ -125,6 +127,7 @@ void HdGatlingRenderBuffer::SetConverged(bool converged)
 
 void* HdGatlingRenderBuffer::Map()
 {
+  // Gi only copies render buffers to the host once they have been mapped.
   return _renderBuffer ? giGetRenderBufferMem(_renderBuffer) : nullptr;
 }
 
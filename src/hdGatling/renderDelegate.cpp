@@ -24,6 +24,7 @@
 #include "material.h"
 #include "tokens.h"
 #include "light.h"
+#include "utils.h"
 
 #include <pxr/base/arch/fileSystem.h>
 #include <pxr/imaging/hd/extComputation.h>
@@ -31,6 +32,7 @@
 #include <pxr/imaging/hd/camera.h>
 #include <pxr/base/gf/vec4f.h>
 
+#include <algorithm>
 #include <memory>
 
 PXR_NAMESPACE_OPEN_SCOPE
@@ -104,6 +106,11 @@ HdGatlingRenderDelegate::HdGatlingRenderDelegate(const HdRenderSettingsMap& sett
   _settingDescriptors.push_back(HdRenderSettingDescriptor{ "Max volume walk length", HdGatlingSettingsTokens->maxVolumeWalkLength, VtValue{7} });
   _settingDescriptors.push_back(HdRenderSettingDescriptor{ "Jittered sampling", HdGatlingSettingsTokens->jitteredSampling, VtValue{true} });
   _settingDescriptors.push_back(HdRenderSettingDescriptor{ "Meters per scene unit", HdGatlingSettingsTokens->stageMetersPerUnit, VtValue{1.0f} });
+  _settingDescriptors.push_back(HdRenderSettingDescriptor{ "BVH compaction", HdGatlingSettingsTokens->bvhCompaction, VtValue{false} });
+  _settingDescriptors.push_back(HdRenderSettingDescriptor{ "Exposure (stops)", HdGatlingSettingsTokens->exposure, VtValue{0.0f} });
+  _settingDescriptors.push_back(HdRenderSettingDescriptor{ "Tone mapping", HdGatlingSettingsTokens->toneMapping, VtValue{HdGatlingPostProcessTokens->none} });
+  _settingDescriptors.push_back(HdRenderSettingDescriptor{ "Display transform", HdGatlingSettingsTokens->displayTransform, VtValue{HdGatlingPostProcessTokens->linear} });
+  _settingDescriptors.push_back(HdRenderSettingDescriptor{ "Frame time budget (ms)", HdGatlingSettingsTokens->frameTimeBudget, VtValue{500.0f} });
 
   _debugSettingDescriptors.push_back(HdRenderSettingDescriptor{ "Progressive accumulation", HdGatlingSettingsTokens->progressiveAccumulation, VtValue{true} });
 
@@ -160,6 +167,21 @@ const HdCommandDescriptors COMMAND_DESCRIPTORS =
   HdCommandDescriptor{ HdGatlingCommandTokens->printLicenses, "Print Licenses" }
 };
 
+VtDictionary HdGatlingRenderDelegate::GetRenderStats() const
+{
+  uint32_t spp = VtValue::Cast<uint32_t>(GetRenderSetting(HdGatlingSettingsTokens->spp)).GetWithDefault<uint32_t>(1);
+  uint32_t sampleCount = giGetSampleCount(_giScene);
+
+  VtDictionary stats;
+  // Interactive rendering has no sample limit and therefore no meaningful progress.
+  if (!HdGatlingIsInteractive(_settingsMap))
+  {
+    stats[HdGatlingRenderStatsTokens->percentDone.GetString()] = std::min(100.0, 100.0 * sampleCount / std::max(spp, 1u));
+  }
+  stats[HdGatlingRenderStatsTokens->sampleCount.GetString()] = int(sampleCount);
+  return stats;
+}
+
 HdCommandDescriptors HdGatlingRenderDelegate::GetCommandDescriptors() const
 {
   return COMMAND_DESCRIPTORS;
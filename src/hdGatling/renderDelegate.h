@@ -44,6 +44,8 @@ public:
 
   void SetRenderSetting(const TfToken& key, const VtValue& value) override;
 
+  VtDictionary GetRenderStats() const override;
+
   HdCommandDescriptors GetCommandDescriptors() const override;
 
   bool InvokeCommand(const TfToken& command, const HdCommandArgs& args = HdCommandArgs()) override;
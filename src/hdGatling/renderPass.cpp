@@ -21,6 +21,7 @@
 #include "mesh.h"
 #include "instancer.h"
 #include "tokens.h"
+#include "utils.h"
 
 #include <pxr/imaging/hd/renderPassState.h>
 #include <pxr/imaging/hd/renderDelegate.h>
@@ -55,6 +56,40 @@ namespace
     { HdGatlingAovTokens->debugDoubleSided,  GiAovId::DoubleSided  },
   };
 
+  GiToneMapping _GetToneMapping(const VtValue& value)
+  {
+    TfToken token = VtValue::Cast<TfToken>(value).GetWithDefault<TfToken>();
+
+    if (token == HdGatlingPostProcessTokens->reinhard)
+    {
+      return GiToneMapping::Reinhard;
+    }
+    else if (token == HdGatlingPostProcessTokens->acesFilmic)
+    {
+      return GiToneMapping::AcesFilmic;
+    }
+    else if (token != HdGatlingPostProcessTokens->none)
+    {
+      TF_RUNTIME_ERROR(TfStringPrintf("Unsupported tone mapping %s", token.GetText()));
+    }
+    return GiToneMapping::None;
+  }
+
+  GiDisplayTransform _GetDisplayTransform(const VtValue& value)
+  {
+    TfToken token = VtValue::Cast<TfToken>(value).GetWithDefault<TfToken>();
+
+    if (token == HdGatlingPostProcessTokens->srgb)
+    {
+      return GiDisplayTransform::Srgb;
+    }
+    else if (token != HdGatlingPostProcessTokens->linear)
+    {
+      TF_RUNTIME_ERROR(TfStringPrintf("Unsupported display transform %s", token.GetText()));
+    }
+    return GiDisplayTransform::Linear;
+  }
+
   std::vector<GiAovBinding> _PrepareAovBindings(const HdRenderPassAovBindingVector& aovBindings)
   {
     std::vector<GiAovBinding> result;
@@ -86,44 +121,6 @@ namespace
 
     return result;
   }
-
-  bool _IsInteractive(const HdRenderSettingsMap& settings)
-  {
-    auto settingIt = settings.find(HdRenderSettingsTokens->enableInteractive);
-    if (settingIt != settings.end())
-    {
-      return settingIt->second.Get<bool>();
-    }
-
-    // https://www.sidefx.com/docs/hdk/_h_d_k__u_s_d_hydra.html#HDK_USDHydraCustomSettingsInteractive
-    const static TfToken houdiniInteractive("houdini:interactive", TfToken::Immortal);
-    settingIt = settings.find(houdiniInteractive);
-
-    if (settingIt != settings.end())
-    {
-      const VtValue& val = settingIt->second;
-
-      const char* str = nullptr;
-      if (val.IsHolding<std::string>())
-      {
-        str = val.UncheckedGet<std::string>().c_str();
-      }
-      else if (val.IsHolding<TfToken>())
-      {
-        str = val.UncheckedGet<TfToken>().GetText();
-      }
-      else
-      {
-        // FIXME: need to build against Houdini SDK and extract UT_StringHolder in this case
-        GB_ERROR("failed to get string from houdini:interactive setting");
-        return false;
-      }
-
-      return strcmp(str, "normal") != 0;
-    }
-
-    return true;
-  }
 }
 
 HdGatlingRenderPass::HdGatlingRenderPass(HdRenderIndex* index,
@@ -218,11 +215,20 @@ void HdGatlingRenderPass::_Execute(const HdRenderPassStateSharedPtr& renderPassS
   GiCameraDesc giCamera;
   _ConstructGiCamera(*camera, giCamera);
 
+  bool isInteractive = HdGatlingIsInteractive(_settings);
+  uint32_t spp = VtValue::Cast<uint32_t>(_settings.find(HdGatlingSettingsTokens->spp)->second).Get<uint32_t>();
+
   GiRenderParams renderParams = {
     .aovBindings = aovBindings,
     .camera = giCamera,
     .domeLight = renderParam->ActiveDomeLight(),
+    .postProcess = {
+      .displayTransform = _GetDisplayTransform(_settings.find(HdGatlingSettingsTokens->displayTransform)->second),
+      .exposure = VtValue::Cast<float>(_settings.find(HdGatlingSettingsTokens->exposure)->second).Get<float>(),
+      .toneMapping = _GetToneMapping(_settings.find(HdGatlingSettingsTokens->toneMapping)->second)
+    },
     .renderSettings = {
+      .bvhCompaction = _settings.find(HdGatlingSettingsTokens->bvhCompaction)->second.Get<bool>(),
       .clippingPlanes = clippingPlanes,
       .depthOfField = _settings.find(HdGatlingSettingsTokens->depthOfField)->second.Get<bool>(),
       .domeLightCameraVisible = (domeLightCameraVisibilityValueIt == _settings.end()) || domeLightCameraVisibilityValueIt->second.GetWithDefault<bool>(true),
@@ -238,7 +244,11 @@ void HdGatlingRenderPass::_Execute(const HdRenderPassStateSharedPtr& renderPassS
       .progressiveAccumulation = _settings.find(HdGatlingSettingsTokens->progressiveAccumulation)->second.Get<bool>(),
       .rrBounceOffset = VtValue::Cast<uint32_t>(_settings.find(HdGatlingSettingsTokens->rrBounceOffset)->second).Get<uint32_t>(),
       .rrInvMinTermProb = VtValue::Cast<float>(_settings.find(HdGatlingSettingsTokens->rrInvMinTermProb)->second).Get<float>(),
-      .spp = VtValue::Cast<uint32_t>(_settings.find(HdGatlingSettingsTokens->spp)->second).Get<uint32_t>()
+      .spp = spp,
+      .frameTimeBudget = VtValue::Cast<float>(_settings.find(HdGatlingSettingsTokens->frameTimeBudget)->second).Get<float>(),
+      // Offline renders are converged once all samples have accumulated, which can take multiple
+      // passes if they exceed the frame time budget. Interactive renders accumulate indefinitely.
+      .sampleLimit = isInteractive ? 0u : spp
     },
     .scene = _scene
   };
@@ -247,7 +257,7 @@ void HdGatlingRenderPass::_Execute(const HdRenderPassStateSharedPtr& renderPassS
 
   TF_VERIFY(result == GiStatus::Ok, "Unable to render scene.");
 
-  _isConverged = !_IsInteractive(_settings);
+  _isConverged = !isInteractive && giGetSampleCount(_scene) >= spp;
 
   for (const auto& aovBinding : hdAovBindings)
   {
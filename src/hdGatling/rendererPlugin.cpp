@@ -23,6 +23,9 @@
 #include <pxr/imaging/hd/rendererPluginRegistry.h>
 #include <pxr/base/plug/plugin.h>
 #include <pxr/base/plug/thisPlugin.h>
+#include <pxr/base/tf/diagnostic.h>
+#include <pxr/base/tf/getenv.h>
+#include <pxr/base/arch/fileSystem.h>
 #include <pxr/usd/ar/asset.h>
 #include <pxr/usd/ar/resolver.h>
 #include <pxr/usd/ar/resolvedPath.h>
@@ -35,6 +38,8 @@
 #include <gtl/gb/Fmt.h>
 #include <gtl/gi/Gi.h>
 
+#include <algorithm>
+
 using namespace gtl;
 namespace mx = MaterialX;
 
@@ -42,6 +47,30 @@ PXR_NAMESPACE_OPEN_SCOPE
 
 namespace
 {
+  constexpr static const char* _envvarPipelineCacheDir = "HDGATLING_PIPELINE_CACHE_DIR";
+  constexpr static const char* _envvarTextureCompression = "HDGATLING_TEXTURE_COMPRESSION";
+  constexpr static const char* _envvarMaxTextureResolution = "HDGATLING_MAX_TEXTURE_RESOLUTION";
+  constexpr static const char* _envvarFramesInFlight = "HDGATLING_FRAMES_IN_FLIGHT";
+
+  GiTextureCompression _GetTextureCompression()
+  {
+    std::string value = TfGetenv(_envvarTextureCompression, "none");
+
+    if (value == "fast")
+    {
+      return GiTextureCompression::Fast;
+    }
+    else if (value == "high")
+    {
+      return GiTextureCompression::HighQuality;
+    }
+    else if (value != "none")
+    {
+      TF_WARN("unknown %s value \"%s\"", _envvarTextureCompression, value.c_str());
+    }
+    return GiTextureCompression::None;
+  }
+
   bool _TryInitGi(const mx::DocumentPtr mtlxStdLib)
   {
     PlugPluginPtr plugin = PLUG_THIS_PLUGIN;
@@ -62,12 +91,19 @@ namespace
 
     std::string mtlxCustomNodesPath = GB_FMT("{}/mtlx", resourcePath);
 
+    // Render farms may want to point this to a location that persists across machines
+    std::string pipelineCacheDir = TfGetenv(_envvarPipelineCacheDir, GB_FMT("{}/gatling", ArchGetTmpDir()));
+
     GiInitParams params = {
       .shaderPath = shaderPath.c_str(),
       .mdlRuntimePath = resourcePath.c_str(),
       .mdlSearchPaths = mdlSearchPaths,
       .mtlxStdLib = mtlxStdLib,
-      .mtlxCustomNodesPath = mtlxCustomNodesPath
+      .mtlxCustomNodesPath = mtlxCustomNodesPath,
+      .pipelineCacheDir = pipelineCacheDir,
+      .textureCompression = _GetTextureCompression(),
+      .maxTextureResolution = uint32_t(std::max(TfGetenvInt(_envvarMaxTextureResolution, 0), 0)),
+      .framesInFlight = uint32_t(std::max(TfGetenvInt(_envvarFramesInFlight, 2), 1))
     };
     return giInitialize(params) == GiStatus::Ok;
   }
@@ -20,6 +20,7 @@
 PXR_NAMESPACE_OPEN_SCOPE
 
 TF_DEFINE_PUBLIC_TOKENS(HdGatlingSettingsTokens, HD_GATLING_SETTINGS_TOKENS);
+TF_DEFINE_PUBLIC_TOKENS(HdGatlingPostProcessTokens, HD_GATLING_POST_PROCESS_TOKENS);
 TF_DEFINE_PUBLIC_TOKENS(HdGatlingNodeIdentifiers, HD_GATLING_NODE_IDENTIFIER_TOKENS);
 TF_DEFINE_PUBLIC_TOKENS(HdGatlingSourceTypes, HD_GATLING_SOURCE_TYPE_TOKENS);
 TF_DEFINE_PUBLIC_TOKENS(HdGatlingDiscoveryTypes, HD_GATLING_DISCOVERY_TYPE_TOKENS);
@@ -28,5 +29,6 @@ TF_DEFINE_PUBLIC_TOKENS(HdGatlingNodeContexts, HD_GATLING_NODE_CONTEXT_TOKENS);
 TF_DEFINE_PUBLIC_TOKENS(HdGatlingNodeMetadata, HD_GATLING_NODE_METADATA_TOKENS);
 TF_DEFINE_PUBLIC_TOKENS(HdGatlingAovTokens, HD_GATLING_AOV_TOKENS);
 TF_DEFINE_PUBLIC_TOKENS(HdGatlingCommandTokens, HD_GATLING_COMMAND_TOKENS);
+TF_DEFINE_PUBLIC_TOKENS(HdGatlingRenderStatsTokens, HD_GATLING_RENDER_STATS_TOKENS);
 
 PXR_NAMESPACE_CLOSE_SCOPE
@@ -23,6 +23,7 @@ PXR_NAMESPACE_OPEN_SCOPE
 
 #define HD_GATLING_SETTINGS_TOKENS                           \
   ((spp, "spp"))                                             \
+  ((bvhCompaction, "bvh-compaction"))                        \
   ((maxBounces, "max-bounces"))                              \
   ((rrBounceOffset, "rr-bounce-offset"))                     \
   ((rrInvMinTermProb, "rr-inv-min-term-prob"))               \
@@ -36,7 +37,18 @@ PXR_NAMESPACE_OPEN_SCOPE
   ((maxVolumeWalkLength, "max-volume-walk-length"))          \
   ((jitteredSampling, "jittered-sampling"))                  \
   ((clippingPlanes, "clipping-planes"))                      \
-  ((stageMetersPerUnit, "stage-meters-per-unit"))
+  ((stageMetersPerUnit, "stage-meters-per-unit"))            \
+  ((exposure, "exposure"))                                   \
+  ((toneMapping, "tone-mapping"))                            \
+  ((displayTransform, "display-transform"))                  \
+  ((frameTimeBudget, "frame-time-budget"))
+
+#define HD_GATLING_POST_PROCESS_TOKENS               \
+  (none)                                             \
+  (reinhard)                                         \
+  ((acesFilmic, "aces-filmic"))                      \
+  (linear)                                           \
+  (srgb)
 
 // mtlx node identifier is given by UsdMtlx.
 #define HD_GATLING_NODE_IDENTIFIER_TOKENS            \
@@ -77,7 +89,12 @@ PXR_NAMESPACE_OPEN_SCOPE
 #define HD_GATLING_COMMAND_TOKENS                    \
   (printLicenses)
 
+#define HD_GATLING_RENDER_STATS_TOKENS               \
+  (percentDone)                                      \
+  (sampleCount)
+
 TF_DECLARE_PUBLIC_TOKENS(HdGatlingSettingsTokens, HD_GATLING_SETTINGS_TOKENS);
+TF_DECLARE_PUBLIC_TOKENS(HdGatlingPostProcessTokens, HD_GATLING_POST_PROCESS_TOKENS);
 TF_DECLARE_PUBLIC_TOKENS(HdGatlingNodeIdentifiers, HD_GATLING_NODE_IDENTIFIER_TOKENS);
 TF_DECLARE_PUBLIC_TOKENS(HdGatlingSourceTypes, HD_GATLING_SOURCE_TYPE_TOKENS);
 TF_DECLARE_PUBLIC_TOKENS(HdGatlingDiscoveryTypes, HD_GATLING_DISCOVERY_TYPE_TOKENS);
@@ -86,5 +103,6 @@ TF_DECLARE_PUBLIC_TOKENS(HdGatlingNodeContexts, HD_GATLING_NODE_CONTEXT_TOKENS);
 TF_DECLARE_PUBLIC_TOKENS(HdGatlingNodeMetadata, HD_GATLING_NODE_METADATA_TOKENS);
 TF_DECLARE_PUBLIC_TOKENS(HdGatlingAovTokens, HD_GATLING_AOV_TOKENS);
 TF_DECLARE_PUBLIC_TOKENS(HdGatlingCommandTokens, HD_GATLING_COMMAND_TOKENS);
+TF_DECLARE_PUBLIC_TOKENS(HdGatlingRenderStatsTokens, HD_GATLING_RENDER_STATS_TOKENS);
 
 PXR_NAMESPACE_CLOSE_SCOPE
@@ -19,6 +19,11 @@
 
 #include <pxr/base/vt/array.h>
 #include <pxr/base/vt/types.h>
+#include <pxr/imaging/hd/tokens.h>
+
+#include <gtl/gb/Log.h>
+
+#include <string.h>
 
 using namespace gtl;
 
@@ -76,4 +81,42 @@ void HdGatlingConvertVtBoolArrayToVtIntArray(VtValue& values)
   values = std::move(intArray);
 }
 
+bool HdGatlingIsInteractive(const HdRenderSettingsMap& settings)
+{
+  auto settingIt = settings.find(HdRenderSettingsTokens->enableInteractive);
+  if (settingIt != settings.end())
+  {
+    return settingIt->second.Get<bool>();
+  }
+
+  // https://www.sidefx.com/docs/hdk/_h_d_k__u_s_d_hydra.html#HDK_USDHydraCustomSettingsInteractive
+  const static TfToken houdiniInteractive("houdini:interactive", TfToken::Immortal);
+  settingIt = settings.find(houdiniInteractive);
+
+  if (settingIt != settings.end())
+  {
+    const VtValue& val = settingIt->second;
+
+    const char* str = nullptr;
+    if (val.IsHolding<std::string>())
+    {
+      str = val.UncheckedGet<std::string>().c_str();
+    }
+    else if (val.IsHolding<TfToken>())
+    {
+      str = val.UncheckedGet<TfToken>().GetText();
+    }
+    else
+    {
+      // FIXME: need to build against Houdini SDK and extract UT_StringHolder in this case
+      GB_ERROR("failed to get string from houdini:interactive setting");
+      return false;
+    }
+
+    return strcmp(str, "normal") != 0;
+  }
+
+  return true;
+}
+
 PXR_NAMESPACE_CLOSE_SCOPE
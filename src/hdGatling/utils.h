@@ -19,6 +19,7 @@
 
 #include <pxr/base/vt/value.h>
 #include <pxr/imaging/hd/types.h>
+#include <pxr/imaging/hd/renderDelegate.h>
 
 #include <gtl/gi/Gi.h>
 
@@ -30,4 +31,6 @@ gtl::GiPrimvarType HdGatlingGetGiPrimvarType(HdType type);
 
 void HdGatlingConvertVtBoolArrayToVtIntArray(VtValue& values);
 
+bool HdGatlingIsInteractive(const HdRenderSettingsMap& settings);
+
 PXR_NAMESPACE_CLOSE_SCOPE
@@ -24,10 +24,65 @@
 
 namespace gtl
 {
+  enum class ImgioFormat
+  {
+    R8,      // grayscale
+    RG8,     // grayscale + alpha
+    RGBA8,
+    RGBA16F,
+    RGBA32F
+  };
+
+  inline uint32_t ImgioGetFormatChannelCount(ImgioFormat format)
+  {
+    switch (format)
+    {
+    case ImgioFormat::R8: return 1;
+    case ImgioFormat::RG8: return 2;
+    default: return 4;
+    }
+  }
+
+  inline uint32_t ImgioGetFormatPixelSize(ImgioFormat format)
+  {
+    switch (format)
+    {
+    case ImgioFormat::R8: return 1;
+    case ImgioFormat::RG8: return 2;
+    case ImgioFormat::RGBA16F: return 8;
+    case ImgioFormat::RGBA32F: return 16;
+    default: return 4;
+    }
+  }
+
+  enum class ImgioCodec
+  {
+    Unknown,
+    Png,
+    Jpeg,
+    Exr,
+    Hdr,
+    Tiff,
+    Tga
+  };
+
+  struct ImgioImageInfo
+  {
+    ImgioCodec codec;
+    uint32_t width;
+    uint32_t height;
+    uint32_t channelCount; // as stored in the file
+    uint32_t bitDepth;     // per channel, as stored in the file
+    ImgioFormat format;    // of the decoded image
+    uint32_t levelCount;   // mip levels stored in the file
+    bool isTiled;
+  };
+
   struct ImgioImage
   {
     uint32_t width;
     uint32_t height;
+    ImgioFormat format = ImgioFormat::RGBA8;
     size_t size;
     std::vector<uint8_t> data;
   };
@@ -22,5 +22,17 @@
 
 namespace gtl
 {
-  ImgioError ImgioLoadImage(const void* data, size_t size, ImgioImage* img);
+  // Identifies the codec from magic bytes and reads the image header only.
+  ImgioError ImgioProbe(const void* data, size_t size, ImgioImageInfo* info);
+
+  // Decodes at the probed resolution into dst, which must hold info.height rows of rowPitch bytes.
+  // rowPitch must be a multiple of the pixel size. Rows are stored bottom-up, like ImgioLoadImage.
+  ImgioError ImgioDecodeImage(const void* data, size_t size, const ImgioImageInfo& info, void* dst, size_t rowPitch);
+
+  // Images larger than maxSize (if non-zero) are downscaled by powers of two during or after decoding.
+  ImgioError ImgioLoadImage(const void* data, size_t size, ImgioImage* img, uint32_t maxSize = 0);
+
+  // Halves the resolution of src using a 2x2 box filter. For odd sizes, the last row and column
+  // use a 3-tap box so that the odd edge is folded in rather than dropped.
+  void ImgioGenerateMipLevel(const ImgioImage& src, ImgioImage* dst);
 }
@@ -20,12 +20,20 @@
 #include "Image.h"
 
 #include <ImfRgbaFile.h>
+#include <ImfInputFile.h>
+#include <ImfFrameBuffer.h>
 #include <ImfIO.h>
-#include <ImfArray.h>
 #include <ImfRgba.h>
+#include <ImfHeader.h>
+#include <ImfChannelList.h>
+#include <ImfTileDescription.h>
+#include <ImfThreading.h>
 
 #include <algorithm>
+#include <mutex>
+#include <thread>
 #include <assert.h>
+#include <string.h>
 
 namespace
 {
@@ -68,19 +76,14 @@ namespace
     }
   };
 
-  uint8_t _FloatToByte(float value)
-  {
-    int result = (int) std::floor(255 * value);
-    return std::min(255, std::max(0, result));
-  }
 }
 
 namespace gtl
 {
-  ImgioError ImgioExrDecoder::decode(size_t size, const void* data, ImgioImage* img)
+  // Do the signature check manually because we can't detect
+  // a mismatch based on the exception-based API.
+  static ImgioError _CheckSignature(size_t size, const void* data)
   {
-    // Do the signature check manually because we can't detect
-    // a mismatch based on the exception-based API.
     if (size < 4)
     {
       return ImgioError::CorruptData;
@@ -92,39 +95,185 @@ namespace gtl
       return ImgioError::UnsupportedEncoding;
     }
 
+    return ImgioError::None;
+  }
+
+  // Lets OpenEXR decompress scanline blocks and tiles of a single image in parallel.
+  static void _InitThreadPool()
+  {
+    static std::once_flag flag;
+    std::call_once(flag, [] {
+      Imf::setGlobalThreadCount(int(std::max(std::thread::hardware_concurrency(), 1u)));
+    });
+  }
+
+  static uint32_t _CalcLevelCount(const Imf::TileDescription& td, uint32_t width, uint32_t height)
+  {
+    if (td.mode == Imf::ONE_LEVEL)
+    {
+      return 1;
+    }
+
+    // Ripmaps are counted along the diagonal, like mipmaps.
+    uint32_t size = std::max(width, height);
+    uint32_t levelCount = 1;
+    while (size > 1)
+    {
+      size = (td.roundingMode == Imf::ROUND_UP) ? (size + 1) / 2 : size / 2;
+      levelCount++;
+    }
+    return levelCount;
+  }
+
+  // Full precision is kept if any of the color channels is stored as 32-bit float,
+  // e.g. for displacement and height maps. Other images are read as half.
+  static bool _HasFloatColorChannels(const Imf::ChannelList& channels)
+  {
+    for (const char* name : { "R", "G", "B", "A", "Y" })
+    {
+      const Imf::Channel* channel = channels.findChannel(name);
+      if (channel && channel->type == Imf::FLOAT)
+      {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // RgbaInputFile only converts to half, so float images are read through the generic interface.
+  static void _ReadFloatPixels(Imf::IStream& stream, uint8_t* dst, size_t rowPitch)
+  {
+    Imf::InputFile file(stream);
+
+    const Imf::Header& header = file.header();
+    const Imath::Box2i& dw = header.dataWindow();
+
+    // Luminance-only images are expanded to RGB after reading.
+    bool isLuminance = !header.channels().findChannel("R") && header.channels().findChannel("Y");
+
+    size_t xStride = 4 * sizeof(float);
+    char* base = (char*) dst - ptrdiff_t(dw.min.x) * ptrdiff_t(xStride) - ptrdiff_t(dw.min.y) * ptrdiff_t(rowPitch);
+
+    Imf::FrameBuffer frameBuffer;
+    frameBuffer.insert(isLuminance ? "Y" : "R", Imf::Slice(Imf::FLOAT, base + 0 * sizeof(float), xStride, rowPitch, 1, 1, 0.0));
+    if (!isLuminance)
+    {
+      frameBuffer.insert("G", Imf::Slice(Imf::FLOAT, base + 1 * sizeof(float), xStride, rowPitch, 1, 1, 0.0));
+      frameBuffer.insert("B", Imf::Slice(Imf::FLOAT, base + 2 * sizeof(float), xStride, rowPitch, 1, 1, 0.0));
+    }
+    frameBuffer.insert("A", Imf::Slice(Imf::FLOAT, base + 3 * sizeof(float), xStride, rowPitch, 1, 1, 1.0));
+
+    file.setFrameBuffer(frameBuffer);
+    file.readPixels(dw.min.y, dw.max.y);
+
+    if (!isLuminance)
+    {
+      return;
+    }
+
+    uint32_t width = dw.max.x - dw.min.x + 1;
+    uint32_t height = dw.max.y - dw.min.y + 1;
+
+#pragma omp parallel for
+    for (int h = 0; h < int(height); h++)
+    {
+      float* row = (float*) &dst[h * rowPitch];
+      for (uint32_t w = 0; w < width; w++)
+      {
+        row[w * 4 + 1] = row[w * 4 + 0];
+        row[w * 4 + 2] = row[w * 4 + 0];
+      }
+    }
+  }
+
+  ImgioError ImgioExrDecoder::probe(size_t size, const void* data, ImgioImageInfo* info)
+  {
+    ImgioError r = _CheckSignature(size, data);
+    if (r != ImgioError::None)
+    {
+      return r;
+    }
+
     try
     {
       _MemStream stream((char*)data, size);
 
+      // Only parses the header; pixel data is not touched.
       Imf::RgbaInputFile file(stream);
 
+      const Imf::Header& header = file.header();
       const Imath::Box2i& dw = file.dataWindow();
-      img->width = (dw.max.x - dw.min.x + 1);
-      img->height = (dw.max.y - dw.min.y + 1);
-      img->size = img->width * img->height * 4;
-      img->data.resize(img->size);
 
-      Imf::Array2D<Imf::Rgba> tmpPixels(img->height, img->width); // values are 16-bit floats
-      file.setFrameBuffer(&tmpPixels[0][0] - dw.min.x - dw.min.y * img->width, 1, img->width);
-      file.readPixels(dw.min.y, dw.max.y);
+      info->width = (dw.max.x - dw.min.x + 1);
+      info->height = (dw.max.y - dw.min.y + 1);
+      info->channelCount = 0;
+      info->bitDepth = 0;
+      info->format = _HasFloatColorChannels(header.channels()) ? ImgioFormat::RGBA32F : ImgioFormat::RGBA16F;
+      info->isTiled = header.hasTileDescription();
+      info->levelCount = info->isTiled ? _CalcLevelCount(header.tileDescription(), info->width, info->height) : 1;
+
+      const Imf::ChannelList& channels = header.channels();
+      for (auto it = channels.begin(); it != channels.end(); ++it)
+      {
+        uint32_t bitDepth = (it.channel().type == Imf::HALF) ? 16 : 32;
+        info->bitDepth = std::max(info->bitDepth, bitDepth);
+        info->channelCount++;
+      }
+    }
+    catch (std::exception&)
+    {
+      return ImgioError::Decode;
+    }
+
+    return ImgioError::None;
+  }
+
+  ImgioError ImgioExrDecoder::decode(size_t size, const void* data, const ImgioImageInfo& info, uint8_t* dst, size_t rowPitch)
+  {
+    ImgioError r = _CheckSignature(size, data);
+    if (r != ImgioError::None)
+    {
+      return r;
+    }
+
+    static_assert(sizeof(Imf::Rgba) == 8);
+    assert(rowPitch % sizeof(Imf::Rgba) == 0);
+
+    _InitThreadPool();
+
+    try
+    {
+      _MemStream stream((char*)data, size);
+
+      // Read top-down in the probed precision, then flip rows in place.
+      if (info.format == ImgioFormat::RGBA32F)
+      {
+        _ReadFloatPixels(stream, dst, rowPitch);
+      }
+      else
+      {
+        Imf::RgbaInputFile file(stream);
+
+        const Imath::Box2i& dw = file.dataWindow();
+        size_t pitch = rowPitch / sizeof(Imf::Rgba);
+
+        Imf::Rgba* pixels = (Imf::Rgba*) dst;
+        file.setFrameBuffer(pixels - dw.min.x - ptrdiff_t(dw.min.y) * ptrdiff_t(pitch), 1, pitch);
+        file.readPixels(dw.min.y, dw.max.y);
+      }
+
+      size_t rowSize = info.width * ImgioGetFormatPixelSize(info.format);
 
-      for (long h = 0; h < tmpPixels.height(); h++)
+#pragma omp parallel for
+      for (int h = 0; h < int(info.height / 2); h++)
       {
-        for (long w = 0; w < tmpPixels.width(); w++)
-        {
-          const Imf::Rgba& value = tmpPixels[img->height - h - 1][w];
-
-          uint64_t offset = (w + h * img->width) * 4;
-          img->data[offset + 0] = _FloatToByte(value.r);
-          img->data[offset + 1] = _FloatToByte(value.g);
-          img->data[offset + 2] = _FloatToByte(value.b);
-          img->data[offset + 3] = _FloatToByte(value.a);
-        }
+        uint8_t* rowA = &dst[h * rowPitch];
+        uint8_t* rowB = &dst[(info.height - h - 1) * rowPitch];
+        std::swap_ranges(rowA, rowA + rowSize, rowB);
       }
     }
     catch (std::exception&)
     {
-      *img = {}; // free memory
       return ImgioError::Decode;
     }
 
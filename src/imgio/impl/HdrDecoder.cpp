@@ -25,13 +25,38 @@
 #define STBI_ONLY_HDR
 #include <stb_image.h>
 
+#include <half.h>
+
 #include <algorithm>
 #include <float.h>
 
 namespace gtl
 {
-  // FIXME: don't downcast to uint8_t; store as RGBA16F / E5B9G9R9_UFLOAT_PACK32 / ASTC_HDR
-  ImgioError ImgioHdrDecoder::decode(size_t size, const void* data, ImgioImage* img)
+  ImgioError ImgioHdrDecoder::probe(size_t size, const void* data, ImgioImageInfo* info)
+  {
+    if (!stbi_is_hdr_from_memory((const stbi_uc*) data, (int) size))
+    {
+      return ImgioError::UnsupportedEncoding;
+    }
+
+    int width, height, num_components;
+    if (!stbi_info_from_memory((const stbi_uc*) data, (int) size, &width, &height, &num_components))
+    {
+      return ImgioError::CorruptData;
+    }
+
+    info->width = (uint32_t) width;
+    info->height = (uint32_t) height;
+    info->channelCount = 3; // RGBE
+    info->bitDepth = 8;
+    info->format = ImgioFormat::RGBA16F;
+    info->levelCount = 1;
+    info->isTiled = false;
+
+    return ImgioError::None;
+  }
+
+  ImgioError ImgioHdrDecoder::decode(size_t size, const void* data, const ImgioImageInfo& info, uint8_t* dst, size_t rowPitch)
   {
     if (!stbi_is_hdr_from_memory((const stbi_uc*) data, (int) size))
     {
@@ -40,25 +65,26 @@ namespace gtl
 
     stbi_set_flip_vertically_on_load(1);
 
-    int num_components;
-    float* hdrData = stbi_loadf_from_memory((const stbi_uc*) data, (int) size, (int*) &img->width, (int*) &img->height, &num_components, 4);
+    int width, height, num_components;
+    float* hdrData = stbi_loadf_from_memory((const stbi_uc*) data, (int) size, &width, &height, &num_components, 4);
     if (!hdrData)
     {
       return ImgioError::Decode;
     }
 
-    img->size = img->width * img->height * 4;
-    img->data.resize(img->size);
+    // RGBE has an 8 bit mantissa, so half floats retain the precision. Values
+    // are clamped to the largest finite half to prevent infinities.
+    uint64_t rowValueCount = uint64_t(info.width) * 4;
 
-    for (uint32_t i = 0; i < img->width; i++)
+#pragma omp parallel for
+    for (int h = 0; h < int(info.height); h++)
     {
-      for (uint32_t j = 0; j < img->height; j++)
+      const float* srcRow = &hdrData[h * rowValueCount];
+      half* dstRow = (half*) &dst[h * rowPitch];
+
+      for (uint64_t i = 0; i < rowValueCount; i++)
       {
-        for (uint32_t k = 0; k < 4; k++)
-        {
-          uint32_t cIndex = (i + j * img->width) * 4 + k;
-          img->data[cIndex] = uint8_t(std::min(int(hdrData[cIndex] * 255.0f), 255));
-        }
+        dstRow[i] = half(std::min(srcRow[i], float(HALF_MAX)));
       }
     }
 
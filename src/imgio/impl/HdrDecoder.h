@@ -18,16 +18,19 @@
 #pragma once
 
 #include <stddef.h>
+#include <stdint.h>
 
 #include "ErrorCodes.h"
 
 namespace gtl
 {
-  struct ImgioImage;
+  struct ImgioImageInfo;
 
   class ImgioHdrDecoder
   {
   public:
-    static ImgioError decode(size_t size, const void* data, ImgioImage* img);
+    static ImgioError probe(size_t size, const void* data, ImgioImageInfo* info);
+
+    static ImgioError decode(size_t size, const void* data, const ImgioImageInfo& info, uint8_t* dst, size_t rowPitch);
   };
 }
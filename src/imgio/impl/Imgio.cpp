@@ -23,39 +23,121 @@
 #include "TiffDecoder.h"
 #include "TgaDecoder.h"
 
+#include <algorithm>
+
 #include <stdlib.h>
+#include <string.h>
 
 namespace gtl
 {
-  ImgioError ImgioLoadImage(const void* data, size_t size, ImgioImage* img)
+  static bool _HasPrefix(const void* data, size_t size, const char* prefix, size_t prefixSize)
   {
-    ImgioError r = ImgioPngDecoder::decode(size, data, img);
+    return size >= prefixSize && memcmp(data, prefix, prefixSize) == 0;
+  }
 
-    if (r == ImgioError::UnsupportedEncoding)
+  // TGA has no signature and serves as the fallback.
+  static ImgioCodec _DetectCodec(const void* data, size_t size)
+  {
+    if (_HasPrefix(data, size, "\x89PNG\r\n\x1A\n", 8))
+    {
+      return ImgioCodec::Png;
+    }
+    if (_HasPrefix(data, size, "\xFF\xD8\xFF", 3))
+    {
+      return ImgioCodec::Jpeg;
+    }
+    if (_HasPrefix(data, size, "\x76\x2F\x31\x01", 4))
+    {
+      return ImgioCodec::Exr;
+    }
+    if (_HasPrefix(data, size, "#?RADIANCE", 10) || _HasPrefix(data, size, "#?RGBE", 6))
+    {
+      return ImgioCodec::Hdr;
+    }
+    if (_HasPrefix(data, size, "II*\0", 4) || _HasPrefix(data, size, "MM\0*", 4) || // classic
+        _HasPrefix(data, size, "II+\0", 4) || _HasPrefix(data, size, "MM\0+", 4))   // BigTIFF
     {
-      r = ImgioJpegDecoder::decode(size, data, img);
+      return ImgioCodec::Tiff;
     }
+    return ImgioCodec::Tga;
+  }
 
-    if (r == ImgioError::UnsupportedEncoding)
+  ImgioError ImgioProbe(const void* data, size_t size, ImgioImageInfo* info)
+  {
+    ImgioCodec codec = _DetectCodec(data, size);
+
+    ImgioError r;
+    switch (codec)
     {
-      r = ImgioExrDecoder::decode(size, data, img);
+    case ImgioCodec::Png: r = ImgioPngDecoder::probe(size, data, info); break;
+    case ImgioCodec::Jpeg: r = ImgioJpegDecoder::probe(size, data, info); break;
+    case ImgioCodec::Exr: r = ImgioExrDecoder::probe(size, data, info); break;
+    case ImgioCodec::Hdr: r = ImgioHdrDecoder::probe(size, data, info); break;
+    case ImgioCodec::Tiff: r = ImgioTiffDecoder::probe(size, data, info); break;
+    default: r = ImgioTgaDecoder::probe(size, data, info); break;
     }
 
-    if (r == ImgioError::UnsupportedEncoding)
+    info->codec = (r == ImgioError::None) ? codec : ImgioCodec::Unknown;
+
+    return r;
+  }
+
+  ImgioError ImgioDecodeImage(const void* data, size_t size, const ImgioImageInfo& info, void* dst, size_t rowPitch)
+  {
+    uint8_t* dstBytes = (uint8_t*) dst;
+
+    switch (info.codec)
     {
-      r = ImgioHdrDecoder::decode(size, data, img);
+    case ImgioCodec::Png: return ImgioPngDecoder::decode(size, data, info, dstBytes, rowPitch);
+    case ImgioCodec::Jpeg: return ImgioJpegDecoder::decode(size, data, info, dstBytes, rowPitch);
+    case ImgioCodec::Exr: return ImgioExrDecoder::decode(size, data, info, dstBytes, rowPitch);
+    case ImgioCodec::Hdr: return ImgioHdrDecoder::decode(size, data, info, dstBytes, rowPitch);
+    case ImgioCodec::Tiff: return ImgioTiffDecoder::decode(size, data, info, dstBytes, rowPitch);
+    case ImgioCodec::Tga: return ImgioTgaDecoder::decode(size, data, info, dstBytes, rowPitch);
+    default: return ImgioError::UnsupportedEncoding;
     }
+  }
 
-    if (r == ImgioError::UnsupportedEncoding)
+  ImgioError ImgioLoadImage(const void* data, size_t size, ImgioImage* img, uint32_t maxSize)
+  {
+    ImgioImageInfo info;
+    ImgioError r = ImgioProbe(data, size, &info);
+    if (r != ImgioError::None)
     {
-      r = ImgioTiffDecoder::decode(size, data, img);
+      return r;
     }
 
-    if (r == ImgioError::UnsupportedEncoding)
+    if (info.codec == ImgioCodec::Jpeg && maxSize > 0)
     {
-      r = ImgioTgaDecoder::decode(size, data, img);
+      ImgioJpegDecoder::scale(&info, maxSize);
     }
 
-    return r;
+    img->width = info.width;
+    img->height = info.height;
+    img->format = info.format;
+
+    size_t rowPitch = info.width * ImgioGetFormatPixelSize(info.format);
+    img->size = rowPitch * info.height;
+    img->data.resize(img->size);
+
+    r = ImgioDecodeImage(data, size, info, img->data.data(), rowPitch);
+    if (r != ImgioError::None)
+    {
+      *img = {}; // free memory
+      return r;
+    }
+
+    // Generic fallback for decoders without native reduced-resolution decoding
+    if (maxSize > 0)
+    {
+      ImgioImage downscaledImg;
+      while (std::max(img->width, img->height) > maxSize)
+      {
+        ImgioGenerateMipLevel(*img, &downscaledImg);
+        std::swap(*img, downscaledImg);
+      }
+    }
+
+    return ImgioError::None;
   }
 }
@@ -19,12 +19,14 @@
 #include "ErrorCodes.h"
 #include "Image.h"
 
+#include <algorithm>
+
 #include <stdlib.h>
 #include <turbojpeg.h>
 
 namespace gtl
 {
-  ImgioError ImgioJpegDecoder::decode(size_t size, const void* data, ImgioImage* img)
+  ImgioError ImgioJpegDecoder::probe(size_t size, const void* data, ImgioImageInfo* info)
   {
     tjhandle instance = tjInitDecompress();
     if (!instance)
@@ -32,31 +34,79 @@ namespace gtl
       return ImgioError::Unknown;
     }
 
+    int width, height;
     int subsamp;
     int colorspace;
-    if (tjDecompressHeader3(instance, (const unsigned char*) data, (unsigned long) size,
-                            (int*) &img->width, (int*) &img->height,
-                            &subsamp, &colorspace) < 0)
+    int result = tjDecompressHeader3(instance, (const unsigned char*) data, (unsigned long) size,
+                                     &width, &height, &subsamp, &colorspace);
+    tjDestroy(instance);
+
+    if (result < 0)
     {
-      tjDestroy(instance);
       return ImgioError::UnsupportedEncoding;
     }
 
-    int pixelFormat = TJPF_RGBA;
-    img->size = img->width * img->height * tjPixelSize[pixelFormat];
-    img->data.resize(img->size);
+    bool isGray = (colorspace == TJCS_GRAY);
+    bool isCmyk = (colorspace == TJCS_CMYK || colorspace == TJCS_YCCK);
 
-    int result = tjDecompress2(instance, (const unsigned char*) data, (unsigned long) size,
-                               (unsigned char*) &img->data[0], (int) img->width, 0,
-                               (int) img->height, pixelFormat, TJFLAG_ACCURATEDCT | TJFLAG_BOTTOMUP);
-    tjDestroy(instance);
+    info->width = (uint32_t) width;
+    info->height = (uint32_t) height;
+    info->channelCount = isGray ? 1 : (isCmyk ? 4 : 3);
+    info->bitDepth = 8;
+    info->format = isGray ? ImgioFormat::R8 : ImgioFormat::RGBA8;
+    info->levelCount = 1;
+    info->isTiled = false;
 
-    if (result < 0)
+    return ImgioError::None;
+  }
+
+  void ImgioJpegDecoder::scale(ImgioImageInfo* info, uint32_t maxSize)
+  {
+    if (std::max(info->width, info->height) <= maxSize)
     {
-      *img = {}; // free memory
-      return ImgioError::Decode;
+      return;
     }
 
-    return ImgioError::None;
+    // Use DCT scaling to decode at the largest supported size within the limit.
+    int scalingFactorCount;
+    tjscalingfactor* scalingFactors = tjGetScalingFactors(&scalingFactorCount);
+
+    uint32_t bestWidth = info->width;
+    uint32_t bestHeight = info->height;
+    for (int i = 0; scalingFactors && i < scalingFactorCount; i++)
+    {
+      uint32_t width = TJSCALED(info->width, scalingFactors[i]);
+      uint32_t height = TJSCALED(info->height, scalingFactors[i]);
+
+      bool fitsLimit = std::max(width, height) <= maxSize;
+      bool bestFitsLimit = std::max(bestWidth, bestHeight) <= maxSize;
+
+      if ((fitsLimit && (!bestFitsLimit || width > bestWidth)) || (!bestFitsLimit && width < bestWidth))
+      {
+        bestWidth = width;
+        bestHeight = height;
+      }
+    }
+
+    info->width = bestWidth;
+    info->height = bestHeight;
+  }
+
+  ImgioError ImgioJpegDecoder::decode(size_t size, const void* data, const ImgioImageInfo& info, uint8_t* dst, size_t rowPitch)
+  {
+    tjhandle instance = tjInitDecompress();
+    if (!instance)
+    {
+      return ImgioError::Unknown;
+    }
+
+    int pixelFormat = (info.format == ImgioFormat::R8) ? TJPF_GRAY : TJPF_RGBA;
+
+    int result = tjDecompress2(instance, (const unsigned char*) data, (unsigned long) size,
+                               dst, (int) info.width, (int) rowPitch,
+                               (int) info.height, pixelFormat, TJFLAG_ACCURATEDCT | TJFLAG_BOTTOMUP);
+    tjDestroy(instance);
+
+    return (result < 0) ? ImgioError::Decode : ImgioError::None;
   }
 }
@@ -18,16 +18,22 @@
 #pragma once
 
 #include <stddef.h>
+#include <stdint.h>
 
 #include "ErrorCodes.h"
 
 namespace gtl
 {
-  struct ImgioImage;
+  struct ImgioImageInfo;
 
   class ImgioJpegDecoder
   {
   public:
-    static ImgioError decode(size_t size, const void* data, ImgioImage* img);
+    static ImgioError probe(size_t size, const void* data, ImgioImageInfo* info);
+
+    // Reduces the dimensions to the largest size reachable by DCT scaling within maxSize.
+    static void scale(ImgioImageInfo* info, uint32_t maxSize);
+
+    static ImgioError decode(size_t size, const void* data, const ImgioImageInfo& info, uint8_t* dst, size_t rowPitch);
   };
 }
@@ -0,0 +1,120 @@
+//
+// Copyright (C) 2019 Pablo Delgado Krämer
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "Imgio.h"
+
+#include <half.h>
+
+#include <algorithm>
+
+namespace
+{
+  using namespace gtl;
+
+  template<typename T>
+  T _FromFloat(float value)
+  {
+    return T(value);
+  }
+
+  template<>
+  uint8_t _FromFloat<uint8_t>(float value)
+  {
+    return uint8_t(std::clamp(value + 0.5f, 0.0f, 255.0f));
+  }
+
+  struct _Taps
+  {
+    uint32_t indices[3];
+    uint32_t count;
+  };
+
+  // The last texel of an odd-sized level also covers the source texel that would otherwise be dropped.
+  _Taps _GetTaps(uint32_t dstIndex, uint32_t dstSize, uint32_t srcSize)
+  {
+    uint32_t i0 = std::min(dstIndex * 2, srcSize - 1);
+    uint32_t i1 = std::min(dstIndex * 2 + 1, srcSize - 1);
+
+    if (srcSize > 1 && (srcSize % 2) == 1 && dstIndex == dstSize - 1)
+    {
+      return _Taps{ .indices = { i0, i1, i1 + 1 }, .count = 3 };
+    }
+
+    return _Taps{ .indices = { i0, i1, i1 }, .count = 2 };
+  }
+
+  template<typename T>
+  void _Downsample(const ImgioImage& src, ImgioImage* dst, uint32_t channelCount)
+  {
+    const T* srcData = (const T*) src.data.data();
+    T* dstData = (T*) dst->data.data();
+
+    for (uint32_t y = 0; y < dst->height; y++)
+    {
+      _Taps yTaps = _GetTaps(y, dst->height, src.height);
+
+      for (uint32_t x = 0; x < dst->width; x++)
+      {
+        _Taps xTaps = _GetTaps(x, dst->width, src.width);
+
+        float weight = 1.0f / float(xTaps.count * yTaps.count);
+
+        T* out = &dstData[(y * dst->width + x) * channelCount];
+
+        for (uint32_t c = 0; c < channelCount; c++)
+        {
+          float sum = 0.0f;
+          for (uint32_t ty = 0; ty < yTaps.count; ty++)
+          {
+            for (uint32_t tx = 0; tx < xTaps.count; tx++)
+            {
+              sum += float(srcData[(yTaps.indices[ty] * src.width + xTaps.indices[tx]) * channelCount + c]);
+            }
+          }
+          out[c] = _FromFloat<T>(sum * weight);
+        }
+      }
+    }
+  }
+}
+
+namespace gtl
+{
+  void ImgioGenerateMipLevel(const ImgioImage& src, ImgioImage* dst)
+  {
+    dst->width = std::max(src.width / 2, 1u);
+    dst->height = std::max(src.height / 2, 1u);
+    dst->format = src.format;
+    dst->size = size_t(dst->width) * dst->height * ImgioGetFormatPixelSize(src.format);
+    dst->data.resize(dst->size);
+
+    uint32_t channelCount = ImgioGetFormatChannelCount(src.format);
+
+    switch (src.format)
+    {
+    case ImgioFormat::RGBA16F:
+      _Downsample<half>(src, dst, channelCount);
+      break;
+    case ImgioFormat::RGBA32F:
+      _Downsample<float>(src, dst, channelCount);
+      break;
+    default:
+      _Downsample<uint8_t>(src, dst, channelCount);
+      break;
+    }
+  }
+}
@@ -24,77 +24,138 @@
 
 namespace gtl
 {
-  static void _FlipImage(ImgioImage* img)
+  static ImgioFormat _SelectFormat(spng_ctx* ctx, const spng_ihdr& ihdr, int* fmt)
   {
-    for (uint32_t i = 0; i < img->height / 2; i++)
-    for (uint32_t j = 0; j < img->width; j++)
-    for (uint32_t k = 0; k < 4; k++)
+    // Keep single- and dual-channel images compact. Grayscale images with a
+    // tRNS chunk or other bit depths are expanded to RGBA8 for simplicity.
+    spng_trns trns;
+    bool hasTrns = spng_get_trns(ctx, &trns) == SPNG_OK;
+
+    if (ihdr.color_type == SPNG_COLOR_TYPE_GRAYSCALE && ihdr.bit_depth == 8 && !hasTrns)
+    {
+      *fmt = SPNG_FMT_G8;
+      return ImgioFormat::R8;
+    }
+    else if (ihdr.color_type == SPNG_COLOR_TYPE_GRAYSCALE_ALPHA && ihdr.bit_depth == 8)
     {
-      uint32_t ipix = (i * img->width + j) * 4;
-      uint32_t opix = ((img->height - i - 1) * img->width + j) * 4;
+      *fmt = SPNG_FMT_GA8;
+      return ImgioFormat::RG8;
+    }
 
-      std::swap(img->data[ipix + k], img->data[opix + k]);
+    *fmt = SPNG_FMT_RGBA8;
+    return ImgioFormat::RGBA8;
+  }
+
+  static uint32_t _GetChannelCount(uint8_t colorType)
+  {
+    switch (colorType)
+    {
+    case SPNG_COLOR_TYPE_GRAYSCALE_ALPHA: return 2;
+    case SPNG_COLOR_TYPE_TRUECOLOR: return 3;
+    case SPNG_COLOR_TYPE_TRUECOLOR_ALPHA: return 4;
+    default: return 1; // grayscale or palette indices
+    }
+  }
+
+  static ImgioError _TranslateError(int err)
+  {
+    if (err == SPNG_ESIGNATURE)
+    {
+      return ImgioError::UnsupportedEncoding;
+    }
+    else if (err == SPNG_IO_ERROR || err == SPNG_IO_EOF)
+    {
+      return ImgioError::CorruptData;
+    }
+    else
+    {
+      return ImgioError::Decode;
     }
   }
 
-  ImgioError ImgioPngDecoder::decode(size_t size, const void* data, ImgioImage* img)
+  ImgioError ImgioPngDecoder::probe(size_t size, const void* data, ImgioImageInfo* info)
   {
-    int err;
+    spng_ctx* ctx = spng_ctx_new(0);
+
+    int err = spng_set_png_buffer(ctx, data, size);
+
+    spng_ihdr ihdr;
+    if (err == SPNG_OK)
+    {
+      err = spng_get_ihdr(ctx, &ihdr);
+    }
+
+    if (err == SPNG_OK)
+    {
+      int fmt;
+      info->width = ihdr.width;
+      info->height = ihdr.height;
+      info->channelCount = _GetChannelCount(ihdr.color_type);
+      info->bitDepth = ihdr.bit_depth;
+      info->format = _SelectFormat(ctx, ihdr, &fmt);
+      info->levelCount = 1;
+      info->isTiled = false;
+    }
+
+    spng_ctx_free(ctx);
 
+    return (err == SPNG_OK) ? ImgioError::None : _TranslateError(err);
+  }
+
+  ImgioError ImgioPngDecoder::decode(size_t size, const void* data, const ImgioImageInfo& info, uint8_t* dst, size_t rowPitch)
+  {
     spng_ctx* ctx = spng_ctx_new(0);
+    spng_ihdr ihdr;
+    int fmt;
+    size_t rowSize = info.width * ImgioGetFormatPixelSize(info.format);
 
-    err = spng_set_png_buffer(ctx, data, size);
+    int err = spng_set_png_buffer(ctx, data, size);
     if (err != SPNG_OK)
     {
       goto fail;
     }
 
-    err = spng_decoded_image_size(ctx, SPNG_FMT_RGBA8, &img->size);
+    err = spng_get_ihdr(ctx, &ihdr);
     if (err != SPNG_OK)
     {
       goto fail;
     }
 
-    img->data.resize(img->size);
+    _SelectFormat(ctx, ihdr, &fmt);
 
-    err = spng_decode_image(ctx, &img->data[0], img->size, SPNG_FMT_RGBA8, 0);
+    err = spng_decode_image(ctx, nullptr, 0, fmt, SPNG_DECODE_PROGRESSIVE);
     if (err != SPNG_OK)
     {
       goto fail;
     }
 
-    spng_ihdr ihdr;
-    err = spng_get_ihdr(ctx, &ihdr);
-    if (err != SPNG_OK)
+    // Decode rows straight to their bottom-up destination. Interlaced
+    // images visit rows multiple times, filling in the pixels of each pass.
+    do
     {
-      goto fail;
+      spng_row_info rowInfo;
+      err = spng_get_row_info(ctx, &rowInfo);
+      if (err != SPNG_OK)
+      {
+        break;
+      }
+
+      err = spng_decode_row(ctx, &dst[(info.height - rowInfo.row_num - 1) * rowPitch], rowSize);
     }
+    while (err == SPNG_OK);
 
-    img->width = ihdr.width;
-    img->height = ihdr.height;
+    if (err != SPNG_EOI)
+    {
+      goto fail;
+    }
 
     spng_ctx_free(ctx);
 
-    _FlipImage(img);
-
     return ImgioError::None;
 
   fail:
-    *img = {}; // free memory
-
     spng_ctx_free(ctx);
 
-    if (err == SPNG_ESIGNATURE)
-    {
-      return ImgioError::UnsupportedEncoding;
-    }
-    else if (err == SPNG_IO_ERROR || err == SPNG_IO_EOF)
-    {
-      return ImgioError::CorruptData;
-    }
-    else
-    {
-      return ImgioError::Decode;
-    }
+    return _TranslateError(err);
   }
 }
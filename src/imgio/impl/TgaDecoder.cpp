@@ -30,23 +30,56 @@
 
 namespace gtl
 {
-  ImgioError ImgioTgaDecoder::decode(size_t size, const void* data, ImgioImage* img)
+  static int _GetRequiredComponents(int num_components)
+  {
+    // RGB is expanded because three-component formats are poorly supported by GPUs.
+    return (num_components == 3) ? 4 : num_components;
+  }
+
+  static ImgioFormat _GetFormat(int req_components)
+  {
+    return (req_components == 1) ? ImgioFormat::R8 : (req_components == 2) ? ImgioFormat::RG8 : ImgioFormat::RGBA8;
+  }
+
+  ImgioError ImgioTgaDecoder::probe(size_t size, const void* data, ImgioImageInfo* info)
+  {
+    int width, height, num_components;
+    if (!stbi_info_from_memory((const stbi_uc*) data, (int) size, &width, &height, &num_components))
+    {
+      return ImgioError::UnsupportedEncoding;
+    }
+
+    info->width = (uint32_t) width;
+    info->height = (uint32_t) height;
+    info->channelCount = (uint32_t) num_components;
+    info->bitDepth = 8;
+    info->format = _GetFormat(_GetRequiredComponents(num_components));
+    info->levelCount = 1;
+    info->isTiled = false;
+
+    return ImgioError::None;
+  }
+
+  ImgioError ImgioTgaDecoder::decode(size_t size, const void* data, const ImgioImageInfo& info, uint8_t* dst, size_t rowPitch)
   {
     stbi_set_flip_vertically_on_load(1);
 
-    int num_components;
-    uint8_t* rgbaData = stbi_load_from_memory((const stbi_uc*) data, (int) size, (int*) &img->width, (int*) &img->height, &num_components, 4);
-    if (!rgbaData)
+    int req_components = (int) ImgioGetFormatChannelCount(info.format);
+
+    int width, height, num_components;
+    uint8_t* pixelData = stbi_load_from_memory((const stbi_uc*) data, (int) size, &width, &height, &num_components, req_components);
+    if (!pixelData)
     {
       return ImgioError::Unknown;
     }
 
-    img->size = img->width * img->height * 4;
-    img->data.resize(img->size);
-    memcpy(&img->data[0], rgbaData, img->size);
+    size_t rowSize = info.width * req_components;
+    for (uint32_t h = 0; h < info.height; h++)
+    {
+      memcpy(&dst[h * rowPitch], &pixelData[h * rowSize], rowSize);
+    }
 
-    stbi_image_free(rgbaData);
+    stbi_image_free(pixelData);
     return ImgioError::None;
   }
 }
-
@@ -20,33 +20,259 @@
 #include "Image.h"
 
 #include <tiffio.h>
-#include <tiffio.hxx>
 
-#include <sstream>
+#include <algorithm>
+#include <vector>
+
+#include <string.h>
+
+namespace
+{
+  // In-memory client for libtiff. Mapping the buffer lets libtiff read
+  // directly from it, and separate handles can decode blocks concurrently.
+  struct _MemFile
+  {
+    const uint8_t* data;
+    uint64_t size;
+    uint64_t pos;
+  };
+
+  tmsize_t _ReadProc(thandle_t handle, void* buf, tmsize_t size)
+  {
+    _MemFile* file = (_MemFile*) handle;
+    uint64_t count = std::min(uint64_t(size), file->size - std::min(file->pos, file->size));
+    memcpy(buf, &file->data[file->pos], count);
+    file->pos += count;
+    return tmsize_t(count);
+  }
+
+  tmsize_t _WriteProc(thandle_t handle, void* buf, tmsize_t size)
+  {
+    return 0;
+  }
+
+  toff_t _SeekProc(thandle_t handle, toff_t offset, int whence)
+  {
+    _MemFile* file = (_MemFile*) handle;
+    switch (whence)
+    {
+    case SEEK_CUR: file->pos += offset; break;
+    case SEEK_END: file->pos = file->size + offset; break;
+    default: file->pos = offset; break;
+    }
+    return file->pos;
+  }
+
+  int _CloseProc(thandle_t handle)
+  {
+    return 0;
+  }
+
+  toff_t _SizeProc(thandle_t handle)
+  {
+    return ((_MemFile*) handle)->size;
+  }
+
+  int _MapProc(thandle_t handle, void** base, toff_t* size)
+  {
+    _MemFile* file = (_MemFile*) handle;
+    *base = (void*) file->data;
+    *size = file->size;
+    return 1;
+  }
+
+  void _UnmapProc(thandle_t handle, void* base, toff_t size)
+  {
+  }
+
+  TIFF* _OpenTiff(_MemFile& file)
+  {
+    return TIFFClientOpen("MemTIFF", "r", (thandle_t) &file, _ReadProc, _WriteProc, _SeekProc,
+                          _CloseProc, _SizeProc, _MapProc, _UnmapProc);
+  }
+}
 
 namespace gtl
 {
-  ImgioError ImgioTiffDecoder::decode(size_t size, const void* data, ImgioImage* img)
+  // Strips are grouped so that per-block setup is amortized over enough rows.
+  constexpr static const uint32_t MIN_ROWS_PER_BLOCK = 64;
+
+  ImgioError ImgioTiffDecoder::probe(size_t size, const void* data, ImgioImageInfo* info)
   {
-    const auto cData = (char*) data;
-    std::istringstream stream(std::string(cData, cData + size)); // FIXME: don't copy; use custom istream
+    _MemFile file{ (const uint8_t*) data, size, 0 };
 
-    TIFF* tiff = TIFFStreamOpen("MemTIFF", &stream);
+    TIFF* tiff = _OpenTiff(file);
     if (!tiff)
     {
       return ImgioError::UnsupportedEncoding;
     }
 
-    TIFFGetField(tiff, TIFFTAG_IMAGEWIDTH, &img->width);
-    TIFFGetField(tiff, TIFFTAG_IMAGELENGTH, &img->height);
+    uint16_t samplesPerPixel;
+    uint16_t bitsPerSample;
+    TIFFGetField(tiff, TIFFTAG_IMAGEWIDTH, &info->width);
+    TIFFGetField(tiff, TIFFTAG_IMAGELENGTH, &info->height);
+    TIFFGetFieldDefaulted(tiff, TIFFTAG_SAMPLESPERPIXEL, &samplesPerPixel);
+    TIFFGetFieldDefaulted(tiff, TIFFTAG_BITSPERSAMPLE, &bitsPerSample);
 
-    img->size = img->width * img->height * 4;
-    img->data.resize(img->size);
+    info->channelCount = samplesPerPixel;
+    info->bitDepth = bitsPerSample;
+    info->format = ImgioFormat::RGBA8;
+    info->isTiled = TIFFIsTiled(tiff);
 
-    int result = TIFFReadRGBAImageOriented(tiff, img->width, img->height, (uint32_t*) &img->data[0], ORIENTATION_BOTLEFT, 1);
+    // Reduced-resolution subfiles following the main image form its mip chain.
+    info->levelCount = 1;
+    while (TIFFReadDirectory(tiff))
+    {
+      uint32_t subfileType;
+      if (TIFFGetFieldDefaulted(tiff, TIFFTAG_SUBFILETYPE, &subfileType) && (subfileType & FILETYPE_REDUCEDIMAGE))
+      {
+        info->levelCount++;
+      }
+    }
 
     TIFFClose(tiff);
 
+    return ImgioError::None;
+  }
+
+  static ImgioError _DecodeWhole(TIFF* tiff, const ImgioImageInfo& info, uint8_t* dst, size_t rowPitch)
+  {
+    // libtiff requires a contiguous raster; go through a temporary one for padded rows.
+    size_t rowSize = info.width * 4;
+    std::vector<uint32_t> tmpRaster;
+    uint32_t* raster = (uint32_t*) dst;
+
+    if (rowPitch != rowSize)
+    {
+      tmpRaster.resize(size_t(info.width) * info.height);
+      raster = tmpRaster.data();
+    }
+
+    int result = TIFFReadRGBAImageOriented(tiff, info.width, info.height, raster, ORIENTATION_BOTLEFT, 1);
+
+    if (!tmpRaster.empty())
+    {
+      for (uint32_t h = 0; h < info.height; h++)
+      {
+        memcpy(&dst[h * rowPitch], &tmpRaster[h * info.width], rowSize);
+      }
+    }
+
     return result ? ImgioError::None : ImgioError::Decode;
   }
+
+  // Decodes rowCount rows starting at row into a raster with a lower-left origin.
+  static bool _ReadRows(TIFF* tiff, uint32_t row, uint32_t rowCount, uint32_t width, uint32_t* raster)
+  {
+    char emsg[1024];
+    TIFFRGBAImage img;
+    if (!TIFFRGBAImageOK(tiff, emsg) || !TIFFRGBAImageBegin(&img, tiff, 0, emsg))
+    {
+      return false;
+    }
+
+    img.row_offset = int(row);
+    img.col_offset = 0;
+
+    bool result = TIFFRGBAImageGet(&img, raster, width, rowCount);
+
+    TIFFRGBAImageEnd(&img);
+
+    return result;
+  }
+
+  ImgioError ImgioTiffDecoder::decode(size_t size, const void* data, const ImgioImageInfo& info, uint8_t* dst, size_t rowPitch)
+  {
+    _MemFile file{ (const uint8_t*) data, size, 0 };
+
+    TIFF* tiff = _OpenTiff(file);
+    if (!tiff)
+    {
+      return ImgioError::UnsupportedEncoding;
+    }
+
+    bool isTiled = TIFFIsTiled(tiff);
+
+    uint32_t blockWidth = info.width;
+    uint32_t blockHeight = info.height;
+    if (isTiled)
+    {
+      TIFFGetField(tiff, TIFFTAG_TILEWIDTH, &blockWidth);
+      TIFFGetField(tiff, TIFFTAG_TILELENGTH, &blockHeight);
+    }
+    else
+    {
+      uint32_t rowsPerStrip;
+      TIFFGetFieldDefaulted(tiff, TIFFTAG_ROWSPERSTRIP, &rowsPerStrip);
+      rowsPerStrip = std::clamp(rowsPerStrip, 1u, std::max(info.height, 1u));
+
+      uint32_t stripsPerBlock = (MIN_ROWS_PER_BLOCK + rowsPerStrip - 1) / rowsPerStrip;
+      blockHeight = std::min(stripsPerBlock * rowsPerStrip, info.height);
+    }
+
+    uint16_t orientation;
+    TIFFGetFieldDefaulted(tiff, TIFFTAG_ORIENTATION, &orientation);
+
+    uint32_t blockCountX = (info.width + blockWidth - 1) / blockWidth;
+    uint32_t blockCountY = (info.height + blockHeight - 1) / blockHeight;
+    int blockCount = int(blockCountX * blockCountY);
+
+    // Block positions assume top-down storage; other orientations and single-block
+    // images are decoded as a whole.
+    if (blockCount <= 1 || orientation != ORIENTATION_TOPLEFT || blockWidth == 0 || blockHeight == 0)
+    {
+      ImgioError r = _DecodeWhole(tiff, info, dst, rowPitch);
+      TIFFClose(tiff);
+      return r;
+    }
+
+    TIFFClose(tiff);
+
+    // libtiff handles are not thread-safe, so every thread opens its own.
+    int failedBlockCount = 0;
+
+#pragma omp parallel reduction(+:failedBlockCount)
+    {
+      _MemFile threadFile = file;
+      TIFF* threadTiff = _OpenTiff(threadFile);
+
+      std::vector<uint32_t> raster(size_t(blockWidth) * blockHeight);
+
+#pragma omp for schedule(dynamic)
+      for (int b = 0; b < blockCount; b++)
+      {
+        uint32_t x = (b % blockCountX) * blockWidth;
+        uint32_t y = (b / blockCountX) * blockHeight;
+
+        uint32_t readWidth = std::min(blockWidth, info.width - x);
+        uint32_t readHeight = std::min(blockHeight, info.height - y);
+
+        bool result = threadTiff && (isTiled ? TIFFReadRGBATile(threadTiff, x, y, raster.data())
+                                             : _ReadRows(threadTiff, y, readHeight, info.width, raster.data()));
+        if (!result)
+        {
+          failedBlockCount++;
+          continue;
+        }
+
+        // Rasters have a lower-left origin. Partial tiles are aligned to the top of the
+        // raster, while row ranges only contain the rows that were read.
+        uint32_t rasterHeight = isTiled ? blockHeight : readHeight;
+
+        for (uint32_t i = 0; i < readHeight; i++)
+        {
+          const uint32_t* srcRow = &raster[size_t(rasterHeight - i - 1) * blockWidth];
+          uint8_t* dstRow = &dst[size_t(info.height - (y + i) - 1) * rowPitch + x * 4];
+          memcpy(dstRow, srcRow, readWidth * 4);
+        }
+      }
+
+      if (threadTiff)
+      {
+        TIFFClose(threadTiff);
+      }
+    }
+
+    return (failedBlockCount == 0) ? ImgioError::None : ImgioError::Decode;
+  }
 }
@@ -19,7 +19,9 @@
 #include <doctest/doctest.h>
 
 #include <filesystem>
+#include <fstream>
 #include <array>
+#include <string.h>
 
 #include "Imgio.h"
 
@@ -40,16 +42,32 @@ bool _ReadFile(const fs::path& filePath, std::vector<uint8_t>& data)
   return file.good() && data.size() > 0;
 }
 
-void _LoadOriented(const char* fileName, const std::vector<uint8_t>& ref)
+void _LoadOriented(const char* fileName, const std::vector<uint8_t>& ref, ImgioFormat format = ImgioFormat::RGBA8)
 {
   ImgioImage img;
   std::vector<uint8_t> fileData;
 
   REQUIRE(_ReadFile(fs::path(IMGIO_TESTENV_DIR) / fileName, fileData));
   CHECK_EQ(ImgioLoadImage(&fileData[0], fileData.size(), &img), ImgioError::None);
+  CHECK_EQ(img.format, format);
+  CHECK_EQ(img.size, img.width * img.height * ImgioGetFormatPixelSize(format));
   CHECK_EQ(img.data, ref);
 }
 
+std::vector<uint8_t> _MakeHalfRef(const std::vector<uint16_t>& values)
+{
+  std::vector<uint8_t> ref(values.size() * sizeof(uint16_t));
+  memcpy(ref.data(), values.data(), ref.size());
+  return ref;
+}
+
+std::vector<uint8_t> _MakeFloatRef(const std::vector<float>& values)
+{
+  std::vector<uint8_t> ref(values.size() * sizeof(float));
+  memcpy(ref.data(), values.data(), ref.size());
+  return ref;
+}
+
 static const std::vector<uint8_t> REF_4C = {255,   0,   0, 255,  // red
                                               0,   0, 255, 255,  // blue
                                             255, 255, 255, 255,  // white
@@ -60,6 +78,16 @@ static const std::vector<uint8_t> REF_4C_JPG = {254,   0,   0, 255,  // red
                                                 255, 255, 255, 255,  // white
                                                   1, 255,   1, 255}; // green
 
+static const std::vector<uint8_t> REF_4C_F16 = _MakeHalfRef({0x3C00, 0x0000, 0x0000, 0x3C00,  // red
+                                                              0x0000, 0x0000, 0x3C00, 0x3C00,  // blue
+                                                              0x3C00, 0x3C00, 0x3C00, 0x3C00,  // white
+                                                              0x0000, 0x3C00, 0x0000, 0x3C00}); // green
+
+static const std::vector<uint8_t> REF_4C_F32 = _MakeFloatRef({1.0f, 0.0f, 0.0f, 1.0f,  // red
+                                                               0.0f, 0.0f, 1.0f, 1.0f,  // blue
+                                                               1.0f, 1.0f, 1.0f, 1.0f,  // white
+                                                               0.0f, 1.0f, 0.0f, 1.0f}); // green
+
 TEST_CASE("LoadOriented.Png")
 {
   _LoadOriented("4c.png", REF_4C);
@@ -72,12 +100,17 @@ TEST_CASE("LoadOriented.Tiff")
 
 TEST_CASE("LoadOriented.Exr")
 {
-  _LoadOriented("4c.exr", REF_4C);
+  _LoadOriented("4c.exr", REF_4C_F32, ImgioFormat::RGBA32F);
+}
+
+TEST_CASE("LoadOriented.ExrHalf")
+{
+  _LoadOriented("4c_f16.exr", REF_4C_F16, ImgioFormat::RGBA16F);
 }
 
 TEST_CASE("LoadOriented.Hdr")
 {
-  _LoadOriented("4c.hdr", REF_4C);
+  _LoadOriented("4c.hdr", REF_4C_F16, ImgioFormat::RGBA16F);
 }
 
 TEST_CASE("LoadOriented.Jpg")
@@ -89,3 +122,163 @@ TEST_CASE("LoadOriented.Tga")
 {
   _LoadOriented("4c.tga", REF_4C);
 }
+
+TEST_CASE("GenerateMipLevel")
+{
+  ImgioImage src;
+  src.width = 2;
+  src.height = 2;
+  src.format = ImgioFormat::RGBA8;
+  src.size = REF_4C.size();
+  src.data = REF_4C;
+
+  ImgioImage dst;
+  ImgioGenerateMipLevel(src, &dst);
+
+  CHECK_EQ(dst.width, 1);
+  CHECK_EQ(dst.height, 1);
+  CHECK_EQ(dst.format, ImgioFormat::RGBA8);
+  CHECK_EQ(dst.data, std::vector<uint8_t>{128, 128, 128, 255});
+}
+
+TEST_CASE("GenerateMipLevel.OddEdge")
+{
+  // The last column of an odd-sized level is folded into the last texel.
+  ImgioImage src;
+  src.width = 3;
+  src.height = 1;
+  src.format = ImgioFormat::R8;
+  src.size = 3;
+  src.data = { 0, 30, 90 };
+
+  ImgioImage dst;
+  ImgioGenerateMipLevel(src, &dst);
+
+  CHECK_EQ(dst.width, 1);
+  CHECK_EQ(dst.height, 1);
+  CHECK_EQ(dst.data, std::vector<uint8_t>{40});
+}
+
+TEST_CASE("LoadDownscaled.Png")
+{
+  ImgioImage img;
+  std::vector<uint8_t> fileData;
+
+  REQUIRE(_ReadFile(fs::path(IMGIO_TESTENV_DIR) / "4c.png", fileData));
+  CHECK_EQ(ImgioLoadImage(&fileData[0], fileData.size(), &img, 1), ImgioError::None);
+  CHECK_EQ(img.width, 1);
+  CHECK_EQ(img.height, 1);
+  CHECK_EQ(img.data, std::vector<uint8_t>{128, 128, 128, 255});
+}
+
+TEST_CASE("LoadDownscaled.Jpg")
+{
+  ImgioImage img;
+  std::vector<uint8_t> fileData;
+
+  REQUIRE(_ReadFile(fs::path(IMGIO_TESTENV_DIR) / "4c.jpg", fileData));
+  CHECK_EQ(ImgioLoadImage(&fileData[0], fileData.size(), &img, 1), ImgioError::None);
+  CHECK_EQ(img.width, 1);
+  CHECK_EQ(img.height, 1);
+  CHECK_EQ(img.size, 4);
+}
+
+void _Probe(const char* fileName, ImgioCodec codec, ImgioFormat format)
+{
+  ImgioImageInfo info;
+  std::vector<uint8_t> fileData;
+
+  REQUIRE(_ReadFile(fs::path(IMGIO_TESTENV_DIR) / fileName, fileData));
+  CHECK_EQ(ImgioProbe(&fileData[0], fileData.size(), &info), ImgioError::None);
+  CHECK_EQ(info.codec, codec);
+  CHECK_EQ(info.width, 2);
+  CHECK_EQ(info.height, 2);
+  CHECK_EQ(info.format, format);
+  CHECK_EQ(info.levelCount, 1);
+}
+
+TEST_CASE("Probe.Png")
+{
+  _Probe("4c.png", ImgioCodec::Png, ImgioFormat::RGBA8);
+}
+
+TEST_CASE("Probe.Tiff")
+{
+  _Probe("4c.tiff", ImgioCodec::Tiff, ImgioFormat::RGBA8);
+}
+
+TEST_CASE("Probe.Exr")
+{
+  _Probe("4c.exr", ImgioCodec::Exr, ImgioFormat::RGBA32F);
+}
+
+TEST_CASE("Probe.ExrHalf")
+{
+  _Probe("4c_f16.exr", ImgioCodec::Exr, ImgioFormat::RGBA16F);
+}
+
+TEST_CASE("Probe.Hdr")
+{
+  _Probe("4c.hdr", ImgioCodec::Hdr, ImgioFormat::RGBA16F);
+}
+
+TEST_CASE("Probe.Jpg")
+{
+  _Probe("4c.jpg", ImgioCodec::Jpeg, ImgioFormat::RGBA8);
+}
+
+TEST_CASE("Probe.Tga")
+{
+  _Probe("4c.tga", ImgioCodec::Tga, ImgioFormat::RGBA8);
+}
+
+void _DecodePitched(const char* fileName, const std::vector<uint8_t>& ref, ImgioFormat format = ImgioFormat::RGBA8)
+{
+  ImgioImageInfo info;
+  std::vector<uint8_t> fileData;
+
+  REQUIRE(_ReadFile(fs::path(IMGIO_TESTENV_DIR) / fileName, fileData));
+  REQUIRE_EQ(ImgioProbe(&fileData[0], fileData.size(), &info), ImgioError::None);
+
+  // Pad each row by one pixel and check that the padding is left untouched.
+  size_t pixelSize = ImgioGetFormatPixelSize(format);
+  size_t rowSize = info.width * pixelSize;
+  size_t rowPitch = rowSize + pixelSize;
+  std::vector<uint8_t> data(rowPitch * info.height, 0xCD);
+
+  CHECK_EQ(ImgioDecodeImage(&fileData[0], fileData.size(), info, data.data(), rowPitch), ImgioError::None);
+
+  std::vector<uint8_t> tightData;
+  for (uint32_t h = 0; h < info.height; h++)
+  {
+    const uint8_t* row = &data[h * rowPitch];
+    tightData.insert(tightData.end(), row, row + rowSize);
+    CHECK_EQ(std::vector<uint8_t>(row + rowSize, row + rowPitch), std::vector<uint8_t>(pixelSize, 0xCD));
+  }
+  CHECK_EQ(tightData, ref);
+}
+
+TEST_CASE("DecodePitched.Png")
+{
+  _DecodePitched("4c.png", REF_4C);
+}
+
+TEST_CASE("DecodePitched.Tiff")
+{
+  _DecodePitched("4c.tiff", REF_4C);
+}
+
+TEST_CASE("DecodePitched.Exr")
+{
+  _DecodePitched("4c.exr", REF_4C_F32, ImgioFormat::RGBA32F);
+}
+
+TEST_CASE("DecodePitched.ExrHalf")
+{
+  _DecodePitched("4c_f16.exr", REF_4C_F16, ImgioFormat::RGBA16F);
+}
+
+TEST_CASE("DecodePitched.Jpg")
+{
+  _DecodePitched("4c.jpg", REF_4C_JPG);
+}